@@ -0,0 +1,82 @@
+// Standard libraries
+#include <cstring>
+#include <iostream>
+
+// Included libraries
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Headers
+#include "bench.h"
+
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)();
+};
+
+constexpr Benchmark benchmarks[] = {
+    {"uniforms", benchUniforms},
+    {"vertex_formats", benchVertexFormats},
+    {"instancing", benchInstancing},
+    {"multi_draw", benchMultiDraw},
+    {"streaming", benchStreaming},
+    {"import", benchImport},
+    {"mesh_cache", benchMeshCache},
+    {"lod", benchLod},
+    {"meshlets", benchMeshlets},
+    {"transforms", benchTransforms},
+    {"frustum", benchFrustum},
+    {"bvh", benchBvh},
+    {"occlusion", benchOcclusion},
+    {"hiz", benchHiz},
+};
+
+bool benchContext()
+{
+    static GLFWwindow *window = nullptr;
+    if (window != nullptr)
+        return true;
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    window = glfwCreateWindow(64, 64, "bench", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        return false;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Usage: OpenGLBench [name...]  (runs every benchmark when no name is given)
+int main(const int argc, char **argv) {
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            selected |= std::strcmp(argv[i], benchmark.name) == 0;
+
+        if (!selected)
+            continue;
+
+        std::cout << "== " << benchmark.name << std::endl;
+        benchmark.run();
+    }
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef OPENGL_BENCH_H
+#define OPENGL_BENCH_H
+
+#include <chrono>
+#include <string>
+#include "glm/glm.hpp"
+#include "mesh_builder.h"
+#include "vertex_layout.h"
+#include "shader_blocks.h"
+#include "uniform_block.h"
+
+// Creates (once) a hidden window with a current GL context for the GPU benchmarks
+bool benchContext();
+
+// Wall-clock timer for the benchmark loops
+class BenchTimer
+{
+public:
+    BenchTimer() : start(std::chrono::steady_clock::now()) {}
+    double elapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// The offscreen color + depth target the GPU benchmarks render into (bound while it lives), and the uniform
+// blocks of the lighting shaders set up like main.cpp does
+class BenchScene
+{
+public:
+    BenchScene(int size, const glm::mat4 &viewProj);
+    void release();
+
+private:
+    unsigned int FBO = 0;
+    unsigned int targets[2] = {};
+    UniformBlockBuffer<PerFrameBlock> perFrameBuffer;
+    UniformBlockBuffer<LightingBlock> lightingBuffer;
+    UniformBlockBuffer<MaterialBlock> materialBuffer;
+};
+
+// main.cpp's camera at its start position, for a square target
+glm::mat4 benchCamera();
+// a unit cube as 8 corners, positions quantized like main.cpp's cube
+const VertexLayout& benchCubeLayout();
+Mesh benchCube();
+// a smooth UV sphere of radius 0.5, rings x segments quads, with the poles and the seam welded (positions only)
+Mesh benchSphere(int rings, int segments);
+// a size x size quad grid as an .obj with positions, texcoords and normals, the way DCC tools export it
+void writeBenchGridObj(const std::string &path, int size);
+
+// Benchmarks, one per subsystem
+void benchUniforms();
+void benchVertexFormats();
+void benchInstancing();
+void benchMultiDraw();
+void benchStreaming();
+void benchImport();
+void benchMeshCache();
+void benchLod();
+void benchMeshlets();
+void benchTransforms();
+void benchFrustum();
+void benchBvh();
+void benchOcclusion();
+void benchHiz();
+
+#endif //OPENGL_BENCH_H
@@ -0,0 +1,157 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "bvh.h"
+#include "frustum_culler.h"
+
+
+namespace {
+    // Boxes a unit or so across, about one per unit of volume: build, refits after small and large moves, and
+    // frustum, box, sphere and ray queries against testing every box
+    void benchBvhObjects(const size_t count)
+    {
+        constexpr int QUERIES = 200;
+        constexpr int RAYS = 100000;
+
+        const float side = 2.0f * std::cbrt((float)count);
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> across(-side * 0.5f, side * 0.5f), size(0.25f, 1.0f), unit(-1.0f, 1.0f);
+        std::vector<Aabb> boxes(count);
+        for (Aabb &box : boxes)
+        {
+            box.min = glm::vec3(across(random), across(random), across(random));
+            box.max = box.min + glm::vec3(size(random), size(random), size(random));
+        }
+
+        Bvh bvh;
+        const BenchTimer buildTimer;
+        bvh.build(boxes);
+        const double buildMs = buildTimer.elapsedMs();
+        const float builtCost = bvh.cost();
+
+        // every object a little, mostly inside its loose box, then every object a few units away
+        const auto moveAll = [&](const float distance) {
+            const size_t refits = bvh.refits();
+            const BenchTimer timer;
+            for (size_t i = 0; i < count; i++)
+            {
+                const glm::vec3 offset = glm::vec3(unit(random), unit(random), unit(random)) * distance;
+                boxes[i] = {boxes[i].min + offset, boxes[i].max + offset};
+                bvh.update((uint32_t)i, boxes[i]);
+            }
+            const double ms = timer.elapsedMs();
+            std::cout << "  moved every box up to " << distance << " units: " << bvh.refits() - refits << " refits in "
+                      << ms << " ms, cost " << builtCost << " -> " << bvh.cost() << std::endl;
+        };
+        std::cout << count << " boxes: built in " << buildMs << " ms, " << bvh.nodeCount() << " nodes, cost "
+                  << builtCost << std::endl;
+        moveAll(0.05f);
+        moveAll(3.0f);
+        const BenchTimer rebuildTimer;
+        const bool rebuilt = bvh.rebuildIfDegraded();
+        std::cout << "  " << (rebuilt ? "rebuilt" : "kept") << " in " << rebuildTimer.elapsedMs() << " ms, cost "
+                  << bvh.cost() << std::endl;
+
+        // frustums looking every way from random points, against the FrustumCuller's linear scan
+        FrustumCuller culler;
+        for (const Aabb &box : boxes)
+            culler.addBox(box.min, box.max);
+        const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, side * 0.25f);
+        std::vector<glm::mat4> views(QUERIES);
+        for (glm::mat4 &view : views)
+        {
+            const glm::vec3 eye(across(random), across(random), across(random));
+            view = projection * glm::lookAt(eye, eye + glm::vec3(unit(random), unit(random), unit(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        std::vector<uint32_t> found;
+        found.reserve(count);
+        size_t bvhVisible = 0, scanVisible = 0;
+        const BenchTimer frustumTimer;
+        for (const glm::mat4 &view : views)
+        {
+            glm::vec4 planes[6];
+            frustumPlanes(view, planes);
+            found.clear();
+            bvh.queryFrustum(planes, found);
+            bvhVisible += found.size();
+        }
+        const double frustumMs = frustumTimer.elapsedMs();
+        const BenchTimer scanTimer;
+        for (const glm::mat4 &view : views)
+        {
+            culler.setView(view);
+            scanVisible += culler.cullBoxes().size();
+        }
+        const double scanMs = scanTimer.elapsedMs();
+        std::cout << "  frustum: " << frustumMs * 1000.0 / QUERIES << " us a query, " << bvhVisible / QUERIES
+                  << " found; linear scan " << scanMs * 1000.0 / QUERIES << " us, " << scanVisible / QUERIES << " found"
+                  << (bvhVisible == scanVisible ? "" : " (MISMATCH)") << std::endl;
+
+        // boxes and spheres 10 units across
+        size_t boxFound = 0, sphereFound = 0;
+        const BenchTimer boxTimer;
+        for (int i = 0; i < QUERIES; i++)
+        {
+            const glm::vec3 center(across(random), across(random), across(random));
+            found.clear();
+            bvh.queryBox({center - 5.0f, center + 5.0f}, found);
+            boxFound += found.size();
+        }
+        const double boxMs = boxTimer.elapsedMs();
+        const BenchTimer sphereTimer;
+        for (int i = 0; i < QUERIES; i++)
+        {
+            found.clear();
+            bvh.querySphere(glm::vec3(across(random), across(random), across(random)), 5.0f, found);
+            sphereFound += found.size();
+        }
+        const double sphereMs = sphereTimer.elapsedMs();
+        std::cout << "  box: " << boxMs * 1000.0 / QUERIES << " us a query, " << boxFound / QUERIES
+                  << " found; sphere: " << sphereMs * 1000.0 / QUERIES << " us, " << sphereFound / QUERIES << " found"
+                  << std::endl;
+
+        // rays from random points every way, the first few checked against every box
+        std::vector<glm::vec3> origins(RAYS), directions(RAYS);
+        for (int i = 0; i < RAYS; i++)
+        {
+            origins[i] = glm::vec3(across(random), across(random), across(random));
+            directions[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+        }
+        size_t hits = 0;
+        const BenchTimer rayTimer;
+        for (int i = 0; i < RAYS; i++)
+            hits += bvh.raycast(origins[i], directions[i]).object != Bvh::NONE;
+        const double rayMs = rayTimer.elapsedMs();
+        int mismatches = 0;
+        for (int i = 0; i < 20; i++)
+        {
+            float nearest = FLT_MAX;
+            for (const Aabb &box : boxes)
+            {
+                const glm::vec3 t1 = (box.min - origins[i]) / directions[i], t2 = (box.max - origins[i]) / directions[i];
+                const glm::vec3 near = glm::min(t1, t2), far = glm::max(t1, t2);
+                const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+                if (entry <= std::min(std::min(far.x, far.y), far.z))
+                    nearest = std::min(nearest, entry);
+            }
+            mismatches += std::abs(bvh.raycast(origins[i], directions[i]).distance - nearest) > 1e-4f * nearest;
+        }
+        std::cout << "  rays: " << RAYS / rayMs / 1000.0 << " M/s, " << hits << " of " << RAYS << " hit"
+                  << (mismatches == 0 ? "" : " (MISMATCH)") << std::endl;
+    }
+}
+
+void benchBvh()
+{
+    benchBvhObjects(100000);
+    benchBvhObjects(1000000);
+}
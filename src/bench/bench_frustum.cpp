@@ -0,0 +1,155 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "frustum_culler.h"
+#include "simd.h"
+#include "parallel.h"
+
+
+// Frustum culling: a million spheres and a million boxes scattered around a camera, tested one at a time with glm
+// and by the FrustumCuller, in objects culled and time; then against the camera, four shadow cascades and the six
+// faces of a reflection probe, a pass per view and all of them in one sweep
+void benchFrustum()
+{
+    constexpr size_t COUNT = 1000000;
+    constexpr int RUNS = 5;
+    constexpr float SIDE = 200.0f;
+
+    // the bounds, a unit or so across, and main.cpp's projection looking down -Z from the middle
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> across(-SIDE * 0.5f, SIDE * 0.5f), size(0.25f, 1.0f);
+    std::vector<glm::vec4> spheres(COUNT);
+    std::vector<glm::vec3> boxMin(COUNT), boxMax(COUNT);
+    FrustumCuller culler;
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        spheres[i] = glm::vec4(across(random), across(random), across(random), size(random));
+        culler.addSphere(glm::vec3(spheres[i]), spheres[i].w);
+        boxMin[i] = glm::vec3(across(random), across(random), across(random));
+        boxMax[i] = boxMin[i] + glm::vec3(size(random), size(random), size(random));
+        culler.addBox(boxMin[i], boxMax[i]);
+    }
+    const glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    culler.setView(viewProj);
+    glm::vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+
+    const auto median = [&](const auto &run) {
+        std::vector<double> runMs;
+        for (int i = 0; i < RUNS; i++)
+        {
+            const BenchTimer timer;
+            run();
+            runMs.push_back(timer.elapsedMs());
+        }
+        std::sort(runMs.begin(), runMs.end());
+        return runMs[RUNS / 2];
+    };
+    std::vector<uint32_t> visible;
+    visible.reserve(COUNT);
+
+    // one object at a time
+    const double glmSpheresMs = median([&] {
+        visible.clear();
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            bool inside = true;
+            for (const glm::vec4 &plane : planes)
+                inside = inside && glm::dot(glm::vec3(plane), glm::vec3(spheres[i])) + plane.w >= -spheres[i].w;
+            if (inside)
+                visible.push_back((uint32_t)i);
+        }
+    });
+    const size_t glmSpheres = visible.size();
+    const double glmBoxesMs = median([&] {
+        visible.clear();
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            const glm::vec3 center = (boxMin[i] + boxMax[i]) * 0.5f, extent = (boxMax[i] - boxMin[i]) * 0.5f;
+            bool inside = true;
+            for (const glm::vec4 &plane : planes)
+                inside = inside && glm::dot(glm::vec3(plane), center) + plane.w >= -glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if (inside)
+                visible.push_back((uint32_t)i);
+        }
+    });
+    const size_t glmBoxes = visible.size();
+
+    size_t culledSpheres = 0, culledBoxes = 0;
+    const double spheresMs = median([&] { culledSpheres = COUNT - culler.cullSpheres().size(); });
+    const double boxesMs = median([&] { culledBoxes = COUNT - culler.cullBoxes().size(); });
+
+    std::cout << "Frustum culling with " << simd::Lanes::NAME << " on " << workerCount() << " threads" << std::endl;
+    std::cout << COUNT << " spheres: " << culledSpheres << " culled in " << spheresMs << " ms, one by one with glm "
+              << COUNT - glmSpheres << " culled in " << glmSpheresMs << " ms" << std::endl;
+    std::cout << COUNT << " boxes:   " << culledBoxes << " culled in " << boxesMs << " ms, one by one with glm "
+              << COUNT - glmBoxes << " culled in " << glmBoxesMs << " ms" << std::endl;
+
+    // the cascades split the camera's depth range, each an orthographic box along the light; the probe looks
+    // every way from a point in front of the camera
+    std::vector<glm::mat4> views = {viewProj};
+    const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), glm::normalize(glm::vec3(-1.0f, -2.0f, -1.0f)),
+                                            glm::vec3(0.0f, 1.0f, 0.0f));
+    for (int cascade = 0; cascade < 4; cascade++)
+    {
+        const float half = 5.0f * (float)(1 << (2 * cascade));
+        views.push_back(glm::ortho(-half, half, -half, half, -100.0f, 100.0f)
+                        * glm::translate(lightView, glm::vec3(0.0f, 0.0f, half)));
+    }
+    const glm::vec3 probe(0.0f, 0.0f, -20.0f);
+    const glm::vec3 faces[6][2] = {{{1, 0, 0}, {0, -1, 0}}, {{-1, 0, 0}, {0, -1, 0}}, {{0, 1, 0}, {0, 0, 1}},
+                                   {{0, -1, 0}, {0, 0, -1}}, {{0, 0, 1}, {0, -1, 0}}, {{0, 0, -1}, {0, -1, 0}}};
+    for (const auto &face : faces)
+        views.push_back(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 30.0f) * glm::lookAt(probe, probe + face[0], face[1]));
+    culler.setViews(views.data(), views.size());
+
+    // a pass per view, timed on its own; the masks to compare are gathered by an untimed run after
+    std::vector<uint32_t> passMasks(COUNT);
+    const auto passes = [&](const auto &cull) {
+        const double ms = median([&] {
+            for (const glm::mat4 &view : views)
+            {
+                culler.setView(view);
+                cull();
+            }
+        });
+        std::fill(passMasks.begin(), passMasks.end(), 0u);
+        for (size_t view = 0; view < views.size(); view++)
+        {
+            culler.setView(views[view]);
+            for (const uint32_t i : cull())
+                passMasks[i] |= 1u << view;
+        }
+        return ms;
+    };
+    const auto report = [&](const char *label, const double passesMs, const double sweepMs,
+                            const std::vector<uint32_t> &masks) {
+        // the sweep also drops the few objects past the corners of a frustum, which its planes alone let through
+        size_t seen = 0, tighter = 0, extra = 0;
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            seen += masks[i] != 0;
+            for (uint32_t bits = passMasks[i] & ~masks[i]; bits != 0; bits &= bits - 1)
+                tighter++;
+            extra += (masks[i] & ~passMasks[i]) != 0;
+        }
+        std::cout << COUNT << " " << label << " in " << views.size() << " views: " << seen << " seen by some view; a pass per view "
+                  << passesMs << " ms, one sweep " << sweepMs << " ms, " << tighter << " fewer past frustum corners"
+                  << (extra == 0 ? "" : " (MISMATCH)") << std::endl;
+    };
+    const double sphereViewsMs = median([&] { culler.cullSphereViews(); });
+    const double spherePassesMs = passes([&]() -> const std::vector<uint32_t>& { return culler.cullSpheres(); });
+    report("spheres", spherePassesMs, sphereViewsMs, culler.cullSphereViews());
+    const double boxViewsMs = median([&] { culler.cullBoxViews(); });
+    const double boxPassesMs = passes([&]() -> const std::vector<uint32_t>& { return culler.cullBoxes(); });
+    report("boxes  ", boxPassesMs, boxViewsMs, culler.cullBoxViews());
+}
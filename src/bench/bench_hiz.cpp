@@ -0,0 +1,175 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "mesh_registry.h"
+#include "hiz_culler.h"
+#include "streaming_ring_buffer.h"
+#include "cube_field.h"
+
+
+// GPU occlusion culling: a wall of large cubes with gaps between them in front of 100000 small cubes, drawn whole
+// and with the two phases of the HizCuller, in frame time and cubes drawn; then the camera pans across the field and
+// every frame's image is compared to the one drawn whole, which should be the same pixel for pixel
+void benchHiz()
+{
+    if (!benchContext())
+        return;
+
+    constexpr size_t COUNT = 100000;
+    constexpr int WALL = 6;             // cubes each way, 2 units apart
+    constexpr float WALL_Z = -10.0f;
+    constexpr int FRAMES = 10;
+    constexpr int PAN_FRAMES = 20;
+    constexpr int TARGET_SIZE = 512;
+
+    // 1. the wall first, then the field behind it, wider than the view
+    std::vector<CubeInstance> instances;
+    for (int y = 0; y < WALL; y++)
+        for (int x = 0; x < WALL; x++)
+            instances.push_back({glm::vec4(2.0f * (float)x - (float)WALL + 1.0f, 2.0f * (float)y - (float)WALL + 1.0f,
+                                           WALL_Z, 1.6f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 1.0f});
+    std::mt19937 random(17);
+    std::uniform_real_distribution<float> across(-30.0f, 30.0f), deep(-80.0f, -15.0f);
+    while (instances.size() < COUNT)
+        instances.push_back({glm::vec4(across(random), across(random), deep(random), 0.3f),
+                             glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 1.0f});
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle program = variants.variant(2);
+    const ShaderHandle buildProgram = compiler.submitCompute(HizCuller::BUILD_PATH);
+    const ShaderHandle cullProgram = compiler.submitCompute(HizCuller::CULL_PATH);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    BenchScene scene(TARGET_SIZE, projection);
+    // phase 2 reads the depth phase 1 drew, so it goes to a texture
+    unsigned int depthTexture;
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, TARGET_SIZE, TARGET_SIZE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+    MeshRegistry registry(benchCubeLayout());
+    const int cube = registry.add(benchCube());
+    Pipeline pipeline({"hiz", program, benchCubeLayout(), DepthState{}, BlendState{}, CullState{},
+                       CubeField::instanceLayout()}, fallback);
+    const Uniform<glm::mat4> model = pipeline.program().uniform<glm::mat4>("model");
+
+    const size_t instanceOffset = StreamingRingBuffer::storageAlignment();
+    unsigned int instanceBuffer;
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(instanceOffset + COUNT * sizeof(CubeInstance)), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)instanceOffset, (GLsizeiptr)(COUNT * sizeof(CubeInstance)), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    HizCuller culler(registry, buildProgram, cullProgram);
+    culler.setLevels({cube}, {0.0f}, std::sqrt(3.0f) * 0.5f);
+    culler.setDepth(depthTexture, TARGET_SIZE, TARGET_SIZE);
+    if (!culler.ready())
+    {
+        std::cout << "ERROR::BENCH::HIZ: the culling shaders did not link" << std::endl;
+        return;
+    }
+    // the camera moves below, so the PerFrame block is written every frame, in place of the scene's
+    UniformBlockBuffer<PerFrameBlock> perFrameBuffer;
+    const float pixelsPerUnit = (float)TARGET_SIZE / (2.0f * std::tan(glm::radians(45.0f) * 0.5f));
+
+    // every cube, in one draw
+    const auto drawAll = [&](const glm::mat4 &viewProj) {
+        PerFrameBlock perFrame{};
+        perFrame.viewProj = viewProj;
+        perFrameBuffer.write(perFrame);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        pipeline.bind();
+        registry.bind(pipeline);
+        pipeline.setInstanceBuffer(instanceBuffer, instanceOffset);
+        model.set(registry.range(cube).positionTransform);
+        registry.draw(cube, (unsigned int)COUNT);
+    };
+    // the two phases
+    const auto drawCulled = [&](const glm::mat4 &viewProj, const glm::vec3 &eye) {
+        PerFrameBlock perFrame{};
+        perFrame.viewProj = viewProj;
+        perFrameBuffer.write(perFrame);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        culler.begin(viewProj, eye, pixelsPerUnit, instanceBuffer, (GLintptr)instanceOffset, COUNT);
+        culler.cullFirst();
+        pipeline.bind();
+        registry.bind(pipeline);
+        pipeline.setInstanceBuffer(culler.instanceBuffer(), 0);
+        model.set(registry.range(cube).positionTransform);
+        culler.drawFirst();
+        culler.cullSecond();
+        pipeline.bind();
+        culler.drawSecond();
+    };
+    const auto median = [&](const auto &draw) {
+        std::vector<double> frameMs;
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glFinish();
+            const BenchTimer timer;
+            draw();
+            glFinish();
+            frameMs.push_back(timer.elapsedMs());
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        return frameMs[FRAMES / 2];
+    };
+
+    // 2. the field seen through the wall
+    const double allMs = median([&] { drawAll(projection); });
+    const double culledMs = median([&] { drawCulled(projection, glm::vec3(0.0f)); });
+    const HizCullStats stats = culler.readStats();
+    std::cout << COUNT << " cubes behind a wall of " << WALL * WALL << ": " << allMs << " ms drawn whole, " << culledMs
+              << " ms culled" << std::endl;
+    std::cout << "  " << stats.frustumCulled << " outside the frustum, " << stats.occluded << " occluded, "
+              << stats.drawnFirst << " drawn in phase 1, " << stats.drawnSecond << " in phase 2" << std::endl;
+
+    // 3. panning to the side, so cubes come out from behind the wall every frame: the same image as drawn whole
+    std::vector<unsigned char> expected(TARGET_SIZE * TARGET_SIZE * 4), culled(expected.size());
+    size_t differing = 0, drawnSecond = 0;
+    for (int frame = 0; frame < PAN_FRAMES; frame++)
+    {
+        const glm::vec3 eye(0.15f * (float)frame, 0.05f * (float)frame, 0.0f);
+        const glm::mat4 viewProj = projection * glm::lookAt(eye, eye - glm::vec3(0.0f, 0.0f, 1.0f),
+                                                            glm::vec3(0.0f, 1.0f, 0.0f));
+        drawAll(viewProj);
+        glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, expected.data());
+        drawCulled(viewProj, eye);
+        glReadPixels(0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, culled.data());
+        for (size_t i = 0; i < expected.size(); i += 4)
+            differing += !std::equal(expected.begin() + i, expected.begin() + i + 4, culled.begin() + i);
+        drawnSecond += culler.readStats().drawnSecond;
+    }
+    std::cout << "  panning " << PAN_FRAMES << " frames: " << drawnSecond << " cubes drawn as they came into view, "
+              << differing << " pixels differing from drawing every cube" << std::endl;
+
+    glBindVertexArray(0);
+    pipeline.release();
+    registry.release();
+    culler.release();
+    scene.release();
+    perFrameBuffer.release();
+    glDeleteTextures(1, &depthTexture);
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteProgram(program.get().ID);
+    glDeleteProgram(buildProgram.get().ID);
+    glDeleteProgram(cullProgram.get().ID);
+}
@@ -0,0 +1,110 @@
+// Standard libraries
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Headers
+#include "bench.h"
+#include "mapped_file.h"
+#include "mesh_importer.h"
+#include "parallel.h"
+
+namespace {
+    // the mesh as a .glb: one interleaved vertex buffer view, one 32-bit index buffer view
+    void writeGlb(const std::string &path, const Mesh &mesh)
+    {
+        std::vector<uint32_t> indices(mesh.indexCount);
+        for (size_t i = 0; i < indices.size(); i++)
+            if (mesh.indexType == GL_UNSIGNED_SHORT)
+                indices[i] = reinterpret_cast<const uint16_t*>(mesh.indices.data())[i];
+            else
+                indices[i] = reinterpret_cast<const uint32_t*>(mesh.indices.data())[i];
+        const size_t vertexBytes = mesh.vertices.size(), indexBytes = indices.size() * sizeof(uint32_t);
+        const size_t count = mesh.vertexCount();
+
+        std::string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" + std::to_string(vertexBytes + indexBytes)
+            + "}],\"bufferViews\":[{\"buffer\":0,\"byteLength\":" + std::to_string(vertexBytes) + ",\"byteStride\":32},"
+            + "{\"buffer\":0,\"byteOffset\":" + std::to_string(vertexBytes) + ",\"byteLength\":" + std::to_string(indexBytes) + "}],"
+            + "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(count) + ",\"type\":\"VEC3\"},"
+            + "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" + std::to_string(count) + ",\"type\":\"VEC3\"},"
+            + "{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":" + std::to_string(count) + ",\"type\":\"VEC2\"},"
+            + "{\"bufferView\":1,\"componentType\":5125,\"count\":" + std::to_string(indices.size()) + ",\"type\":\"SCALAR\"}],"
+            + "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}";
+        json.resize((json.size() + 3) / 4 * 4, ' ');
+
+        const uint32_t header[5] = {0x46546C67, 2, (uint32_t)(28 + json.size() + vertexBytes + indexBytes),
+                                    (uint32_t)json.size(), 0x4E4F534A};
+        const uint32_t binHeader[2] = {(uint32_t)(vertexBytes + indexBytes), 0x004E4942};
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(json.data(), (std::streamsize)json.size());
+        file.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+        file.write(reinterpret_cast<const char*>(mesh.vertices.data()), (std::streamsize)vertexBytes);
+        file.write(reinterpret_cast<const char*>(indices.data()), (std::streamsize)indexBytes);
+    }
+
+    double megabytes(const std::string &path)
+    {
+        return (double)std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    }
+}
+
+
+// Import throughput of the parallel .obj parser and of the in-place .glb reader, next to how fast the same
+// mapping can merely be read (the files are in the page cache after the first run, so that is the ceiling)
+void benchImport()
+{
+    constexpr int GRID = 700;  // about 1M triangles
+    constexpr int RUNS = 3;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string objPath = (directory / "bench_import.obj").string();
+    const std::string glbPath = (directory / "bench_import.glb").string();
+    writeBenchGridObj(objPath, GRID);
+
+    const auto best = [](auto &&run) {
+        double bestMs = 1e30;
+        for (int i = 0; i < RUNS; i++)
+        {
+            const BenchTimer timer;
+            run();
+            bestMs = std::min(bestMs, timer.elapsedMs());
+        }
+        return bestMs;
+    };
+
+    volatile unsigned long long checksum = 0;
+    const double readMs = best([&]() {
+        const MappedFile file(objPath);
+        unsigned long long sum = 0;
+        for (size_t i = 0; i + sizeof(sum) <= file.size(); i += sizeof(sum))
+        {
+            unsigned long long word;
+            std::memcpy(&word, file.data() + i, sizeof(word));
+            sum += word;
+        }
+        checksum = sum;
+    });
+    std::cout << "mapped read: " << megabytes(objPath) / (readMs / 1000.0) << " MB/s" << std::endl;
+
+    ImportedMesh mesh;
+    for (const unsigned int threads : {1u, 0u})
+    {
+        const double ms = best([&]() { importMesh(objPath, mesh, threads); });
+        std::cout << ".obj, " << (threads == 0 ? workerCount() : threads) << " thread(s): " << megabytes(objPath) << " MB in "
+                  << ms << " ms, " << megabytes(objPath) / (ms / 1000.0) << " MB/s (" << mesh.mesh.indexCount / 3
+                  << " triangles, " << mesh.mesh.vertexCount() << " vertices)" << std::endl;
+    }
+
+    writeGlb(glbPath, mesh.mesh);
+    const double ms = best([&]() { importMesh(glbPath, mesh); });
+    std::cout << ".glb, " << workerCount() << " thread(s): " << megabytes(glbPath) << " MB in " << ms << " ms, "
+              << megabytes(glbPath) / (ms / 1000.0) << " MB/s" << std::endl;
+
+    std::filesystem::remove(objPath);
+    std::filesystem::remove(glbPath);
+}
@@ -0,0 +1,110 @@
+// Standard libraries
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "cube_field.h"
+
+
+// Frame time of the cube field drawn one cube per draw call and as a single instanced draw, from 10 to 1M cubes
+void benchInstancing()
+{
+    if (!benchContext())
+        return;
+
+    constexpr size_t COUNTS[] = {10, 1000, 100000, 1000000};
+    constexpr int TARGET_SIZE = 256;
+
+    const Mesh cube = benchCube();
+    const VertexLayout &layout = benchCubeLayout();
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle perDrawProgram = variants.variant(0);
+    const ShaderHandle instancedProgram = variants.variant(2);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    // small target, so that rasterization does not hide the submission cost
+    BenchScene scene(TARGET_SIZE, benchCamera());
+
+    unsigned int buffers[3];
+    glGenBuffers(3, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cube.vertices.size(), cube.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)cube.indices.size(), cube.indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Pipeline perDraw({"per draw", perDrawProgram, layout, DepthState{}, BlendState{}, CullState{}}, fallback);
+    Pipeline instanced({"instanced", instancedProgram, layout, DepthState{}, BlendState{}, CullState{},
+                        CubeField::instanceLayout()}, fallback);
+
+    for (const size_t count : COUNTS)
+    {
+        const CubeField cubes(count);
+        const int frames = count >= 100000 ? 3 : 20;
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(count * sizeof(CubeInstance)), nullptr, GL_STREAM_DRAW);
+
+        // median CPU time to submit a frame, and median time until the GPU is done with it
+        const auto measure = [&](const char *label, auto &&drawFrame) {
+            std::vector<double> submitMs, frameMs;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glFinish();
+                const BenchTimer timer;
+                drawFrame((float)frame / 60.0f);
+                submitMs.push_back(timer.elapsedMs());
+                glFinish();
+                frameMs.push_back(timer.elapsedMs());
+            }
+            std::sort(submitMs.begin(), submitMs.end());
+            std::sort(frameMs.begin(), frameMs.end());
+            std::cout << count << " cubes, " << label << ": " << submitMs[submitMs.size() / 2] << " ms CPU, "
+                      << frameMs[frameMs.size() / 2] << " ms frame" << std::endl;
+        };
+
+        measure("per draw ", [&](const float time) {
+            perDraw.bind();
+            perDraw.setVertexBuffer(buffers[0]);
+            perDraw.setIndexBuffer(buffers[1]);
+            const Uniform<glm::mat4> model = perDraw.program().uniform<glm::mat4>("model");
+            for (size_t i = 0; i < cubes.size(); i++)
+            {
+                model.set(cubes.model(i, time) * cube.positionTransform);
+                glDrawElements(GL_TRIANGLES, (int)cube.indexCount, cube.indexType, nullptr);
+            }
+        });
+
+        measure("instanced", [&](const float time) {
+            instanced.bind();
+            instanced.setVertexBuffer(buffers[0]);
+            instanced.setIndexBuffer(buffers[1]);
+            instanced.setInstanceBuffer(buffers[2]);
+            instanced.program().uniform<glm::mat4>("model").set(cube.positionTransform);
+
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+            void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(count * sizeof(CubeInstance)),
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            cubes.instances(time, static_cast<CubeInstance*>(mapped));
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glDrawElementsInstanced(GL_TRIANGLES, (int)cube.indexCount, cube.indexType, nullptr, (int)cubes.size());
+        });
+    }
+
+    glBindVertexArray(0);
+    perDraw.release();
+    instanced.release();
+    scene.release();
+    glDeleteBuffers(3, buffers);
+    glDeleteProgram(perDrawProgram.get().ID);
+    glDeleteProgram(instancedProgram.get().ID);
+}
@@ -0,0 +1,158 @@
+// Standard libraries
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "mesh_builder.h"
+#include "mesh_registry.h"
+#include "mesh_simplifier.h"
+#include "lod_selector.h"
+#include "cube_field.h"
+
+// Levels of detail: generating the chains of a few meshes one after the other and in parallel, then a field of
+// spheres receding from the camera drawn at full detail against each sphere at the level LodSelector picks, in
+// triangles and frame time
+void benchLod()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int CHAIN_MESHES = 8;
+    constexpr int ROWS = 64, COLUMNS = 16;
+    constexpr int FRAMES = 10;
+    constexpr int TARGET_SIZE = 512;
+    constexpr float FOV = 60.0f;
+
+    // 1. LOD generation, about 20k triangles per mesh
+    std::vector<Mesh> meshes;
+    for (int i = 0; i < CHAIN_MESHES; i++)
+        meshes.push_back(benchSphere(100 + i, 100 - i));
+    std::vector<const Mesh*> meshPointers;
+    for (const Mesh &mesh : meshes)
+        meshPointers.push_back(&mesh);
+
+    BenchTimer sequentialTimer;
+    for (const Mesh &mesh : meshes)
+        generateLods(mesh, 0);
+    const double sequentialMs = sequentialTimer.elapsedMs();
+    BenchTimer parallelTimer;
+    const std::vector<std::vector<MeshLod>> chains = generateLodChains(meshPointers, 0);
+    const double parallelMs = parallelTimer.elapsedMs();
+    std::cout << CHAIN_MESHES << " LOD chains of " << meshes[0].indexCount / 3 << " triangles: " << sequentialMs
+              << " ms one by one, " << parallelMs << " ms in parallel" << std::endl;
+    const std::vector<MeshLod> &chain = chains[0];
+    for (size_t level = 0; level < chain.size(); level++)
+        std::cout << "  LOD " << level << ": " << chain[level].indices.size() / 3 << " triangles, error "
+                  << chain[level].error << std::endl;
+
+    // 2. the chain of the first mesh in the registry, and the field of spheres (one unit apart) as instances
+    const VertexLayout layout = {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3}};
+    MeshRegistry registry(layout);
+    std::vector<int> lods;
+    std::vector<float> errors;
+    const std::vector<glm::vec3> vertexPositions = meshPositions(meshes[0], 0);
+    for (size_t level = 0; level < chain.size(); level++)
+    {
+        lods.push_back(registry.add(level == 0 ? meshes[0] : extractLod(meshes[0], chain[level].indices, vertexPositions)));
+        errors.push_back(chain[level].error);
+    }
+    std::vector<glm::vec3> positions;
+    for (int row = 0; row < ROWS; row++)
+        for (int column = 0; column < COLUMNS; column++)
+            positions.emplace_back((float)column - 7.5f, -1.5f, -2.0f - (float)row);
+    const size_t count = positions.size();
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle program = variants.variant(2);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    BenchScene scene(TARGET_SIZE, glm::perspective(glm::radians(FOV), 1.0f, 0.1f, 100.0f));
+    Pipeline pipeline({"lod", program, layout, DepthState{}, BlendState{}, CullState{}, CubeField::instanceLayout()},
+                      fallback);
+    IndirectDrawList drawList;
+    unsigned int instanceBuffer;
+    glGenBuffers(1, &instanceBuffer);
+
+    LodSelector selector;
+    selector.resize(count);
+    selector.setView(glm::vec3(0.0f), FOV, TARGET_SIZE);
+
+    // the instances grouped by level, one draw per level; everything at level 0 without the selector
+    std::vector<unsigned int> levelCounts(lods.size()), levelFirst(lods.size());
+    std::vector<CubeInstance> instances(count);
+    const auto upload = [&](const bool select) {
+        std::fill(levelCounts.begin(), levelCounts.end(), 0u);
+        std::vector<unsigned int> levels(count, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            if (select)
+                levels[i] = selector.select(i, positions[i], 0.5f, errors.data(), (unsigned int)lods.size());
+            levelCounts[levels[i]]++;
+        }
+        for (size_t level = 1; level < lods.size(); level++)
+            levelFirst[level] = levelFirst[level - 1] + levelCounts[level - 1];
+        std::vector<unsigned int> next = levelFirst;
+        for (size_t i = 0; i < count; i++)
+            instances[next[levels[i]]++] = {glm::vec4(positions[i], 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 1.0f};
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(count * sizeof(CubeInstance)), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        size_t triangles = 0;
+        drawList.clear();
+        for (size_t level = 0; level < lods.size(); level++)
+            if (levelCounts[level] > 0)
+            {
+                drawList.add(registry.command(lods[level], levelCounts[level], levelFirst[level]));
+                triangles += (size_t)levelCounts[level] * registry.range(lods[level]).indexCount / 3;
+            }
+        return triangles;
+    };
+
+    // median time until the GPU is done with a frame
+    const auto measure = [&](const char *label, const bool select) {
+        const size_t triangles = upload(select);
+        std::vector<double> frameMs;
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            const BenchTimer timer;
+            pipeline.bind();
+            registry.bind(pipeline);
+            pipeline.setInstanceBuffer(instanceBuffer);
+            pipeline.program().uniform<glm::mat4>("model").set(glm::mat4(1.0f));
+            drawList.submit(registry);
+            glFinish();
+            frameMs.push_back(timer.elapsedMs());
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        std::cout << count << " spheres, " << label << ": " << triangles << " triangles, " << frameMs[FRAMES / 2]
+                  << " ms frame" << std::endl;
+    };
+
+    measure("full detail", false);
+    measure("LOD        ", true);
+    std::cout << "  spheres per level:";
+    for (const unsigned int levelCount : levelCounts)
+        std::cout << " " << levelCount;
+    std::cout << std::endl;
+
+    glBindVertexArray(0);
+    pipeline.release();
+    registry.release();
+    drawList.release();
+    scene.release();
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteProgram(program.get().ID);
+}
@@ -0,0 +1,131 @@
+// Standard libraries
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Included libraries
+#include <fcntl.h>
+#include <unistd.h>
+
+// Headers
+#include "bench.h"
+#include "mesh_file.h"
+#include "mesh_importer.h"
+#include "mesh_registry.h"
+
+namespace {
+    // drops the file from the page cache, so that the next load reads it from disk
+    void evict(const std::string &path)
+    {
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return;
+        fdatasync(file);
+        posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+        close(file);
+    }
+
+    double megabytes(const std::string &path)
+    {
+        return (double)std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    }
+}
+
+
+// Launch-time load of a large mesh into GL buffers: the .obj through the text importer and quantization (what
+// main.cpp does with --mesh file.obj), against its .mesh cache mapped into a MeshRegistry, and into two immutable
+// buffers created straight from the mapping. Cold loads drop the file from the page cache first; warm loads are
+// the best of a few repeats.
+void benchMeshCache()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int GRID = 700;  // about 1M triangles
+    constexpr int RUNS = 3;
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string objPath = (directory / "bench_mesh_cache.obj").string();
+    const std::string meshPath = (directory / "bench_mesh_cache.mesh").string();
+    writeBenchGridObj(objPath, GRID);
+
+    // main.cpp's layout for meshes, and the cache meshc writes for it
+    const VertexLayout layout = {
+        {VertexSemantic::POSITION, 0, VertexFormat::SNORM16_4},
+        {VertexSemantic::TEXCOORD, 2, VertexFormat::UNORM16_2}
+    };
+    {
+        ImportedMesh imported;
+        importMesh(objPath, imported);
+        const Mesh mesh = convertMesh(imported.mesh, imported.layout, layout);
+        writeMeshFile(meshPath, {mesh}, layout, {MeshFileSubmesh{}});
+    }
+
+    const auto fromText = [&]() {
+        ImportedMesh imported;
+        importMesh(objPath, imported);
+        MeshRegistry registry(layout, GL_UNSIGNED_INT);
+        registry.add(convertMesh(imported.mesh, imported.layout, layout));
+        glFinish();
+        registry.release();
+    };
+    const auto fromCache = [&]() {
+        const MeshFile file(meshPath);
+        MeshRegistry registry(layout, GL_UNSIGNED_INT);
+        registry.reserve(file.info().vertexCount, file.info().indexCount);
+        registry.add(file.view(0));
+        glFinish();
+        registry.release();
+    };
+    const auto fromCacheStorage = [&]() {
+        const MeshFile file(meshPath);
+        const MeshView view = file.view(0);
+        unsigned int buffers[2];
+        glGenBuffers(2, buffers);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(view.vertexCount * view.vertexSize), view.vertices, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)file.info().indexBytes, view.indices, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glFinish();
+        glDeleteBuffers(2, buffers);
+    };
+
+    struct Path
+    {
+        const char *name;
+        const std::string &file;
+        std::function<void()> load;
+    };
+    const Path paths[] = {
+        {".obj import + quantize + upload", objPath, fromText},
+        {".mesh into MeshRegistry", meshPath, fromCache},
+        {".mesh into glBufferStorage", meshPath, fromCacheStorage},
+    };
+    for (const Path &path : paths)
+    {
+        double coldMs = 0.0;
+        for (int i = 0; i < RUNS; i++)
+        {
+            evict(path.file);
+            const BenchTimer timer;
+            path.load();
+            coldMs += timer.elapsedMs() / RUNS;
+        }
+        double warmMs = 1e30;
+        for (int i = 0; i < RUNS; i++)
+        {
+            const BenchTimer timer;
+            path.load();
+            warmMs = std::min(warmMs, timer.elapsedMs());
+        }
+        std::cout << path.name << " (" << megabytes(path.file) << " MB): cold " << coldMs << " ms, warm " << warmMs
+                  << " ms" << std::endl;
+    }
+
+    std::filesystem::remove(objPath);
+    std::filesystem::remove(meshPath);
+}
@@ -0,0 +1,146 @@
+// Standard libraries
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "mesh_builder.h"
+#include "mesh_registry.h"
+#include "meshlet_culler.h"
+#include "streaming_ring_buffer.h"
+#include "cube_field.h"
+
+
+// Meshlet culling: a field of spheres, wider than the view and turned every which way, drawn whole, with their
+// meshlets culled on the CPU (the culling timed on its own) and with them culled by the compute shader, in meshlets
+// and triangles culled and frame time
+void benchMeshlets()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int ROWS = 32, COLUMNS = 32;
+    constexpr int FRAMES = 10;
+    constexpr int TARGET_SIZE = 512;
+
+    // 1. one sphere of about 13k triangles, as meshlets
+    const VertexLayout layout = {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3}};
+    MeshRegistry registry(layout);
+    const int sphere = registry.add(benchSphere(80, 80));
+    const MeshRange &range = registry.range(sphere);
+    std::cout << "Sphere: " << range.indexCount / 3 << " triangles in " << range.meshletCount << " meshlets" << std::endl;
+
+    // 2. the field, two units apart, twice as wide as the view
+    std::vector<CubeInstance> instances;
+    std::vector<glm::mat4> models;
+    for (int row = 0; row < ROWS; row++)
+        for (int column = 0; column < COLUMNS; column++)
+        {
+            const glm::vec3 position(2.0f * (float)column - (float)COLUMNS, 0.0f, -2.0f - 2.0f * (float)row);
+            const glm::quat rotation = glm::angleAxis((float)(row * COLUMNS + column), glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
+            instances.push_back({glm::vec4(position, 1.0f), glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w), 1.0f});
+            models.push_back(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation));
+        }
+    const size_t count = instances.size();
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle program = variants.variant(2);
+    const ShaderHandle cullProgram = compiler.submitCompute(GpuMeshletCuller::PROGRAM_PATH);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    const glm::mat4 viewProj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    BenchScene scene(TARGET_SIZE, viewProj);
+    Pipeline pipeline({"meshlets", program, layout, DepthState{}, BlendState{}, CullState{}, CubeField::instanceLayout()},
+                      fallback);
+    IndirectDrawList drawList;
+
+    // the instances at an offset the culling shader can bind them at
+    const size_t instanceOffset = StreamingRingBuffer::storageAlignment();
+    unsigned int instanceBuffer;
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(instanceOffset + count * sizeof(CubeInstance)), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)instanceOffset, (GLsizeiptr)(count * sizeof(CubeInstance)), instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    MeshletCuller culler(registry);
+    GpuMeshletCuller gpuCuller(registry, cullProgram);
+
+    // median time until the GPU is done with a frame, and of the CPU work before its draws
+    const auto measure = [&](const char *label, const auto &prepare, const auto &submit) {
+        std::vector<double> frameMs, prepareMs;
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            const BenchTimer timer;
+            prepare();
+            prepareMs.push_back(timer.elapsedMs());
+            pipeline.bind();
+            registry.bind(pipeline);
+            pipeline.setInstanceBuffer(instanceBuffer, instanceOffset);
+            pipeline.program().uniform<glm::mat4>("model").set(glm::mat4(1.0f));
+            submit();
+            glFinish();
+            frameMs.push_back(timer.elapsedMs());
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        std::sort(prepareMs.begin(), prepareMs.end());
+        std::cout << count << " spheres, " << label << ": " << prepareMs[FRAMES / 2] << " ms culling, "
+                  << frameMs[FRAMES / 2] << " ms frame" << std::endl;
+    };
+    const auto report = [](const MeshletCullStats &stats) {
+        std::cout << "  " << stats.culled() << " of " << stats.meshlets << " meshlets culled (frustum "
+                  << stats.frustumCulled << ", backface " << stats.backfaceCulled << "), " << stats.trianglesCulled
+                  << " of " << stats.triangles << " triangles" << std::endl;
+    };
+
+    // 3. every sphere whole, in one draw
+    measure("no culling ", [&] {
+        drawList.clear();
+        drawList.add(registry.command(sphere, (unsigned int)count, 0));
+    }, [&] { drawList.submit(registry); });
+
+    // 4. the runs of meshlets each sphere keeps, one draw each
+    culler.setView(viewProj, glm::vec3(0.0f));
+    measure("CPU culling", [&] {
+        drawList.clear();
+        culler.endFrame();
+        for (size_t i = 0; i < count; i++)
+            if (culler.cull(sphere, models[i]) != MeshletCoverage::NONE)
+                culler.addVisible(drawList, (unsigned int)i);
+    }, [&] { drawList.submit(registry); });
+    report(culler.stats());
+
+    // 5. the same on the GPU, nothing read back before the draws
+    if (gpuCuller.ready())
+    {
+        measure("GPU culling", [&] {
+            gpuCuller.begin(viewProj, glm::vec3(0.0f), count * range.meshletCount);
+            gpuCuller.cull(sphere, instanceBuffer, (GLintptr)instanceOffset, 0, (unsigned int)count, glm::mat4(1.0f));
+        }, [&] { gpuCuller.draw(); });
+        report(gpuCuller.readStats());
+    }
+    else
+        std::cout << "ERROR::BENCH::MESHLETS: the culling shader did not link" << std::endl;
+
+    glBindVertexArray(0);
+    pipeline.release();
+    registry.release();
+    drawList.release();
+    gpuCuller.release();
+    scene.release();
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteProgram(program.get().ID);
+    glDeleteProgram(cullProgram.get().ID);
+}
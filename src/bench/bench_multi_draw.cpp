@@ -0,0 +1,184 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "mesh_builder.h"
+#include "mesh_registry.h"
+#include "vertex_layout.h"
+#include "cube_field.h"
+
+namespace {
+    // a lumpy sphere, different for every seed: rings x segments quads of a UV sphere with a jittered radius
+    Mesh lumpySphere(std::mt19937 &random)
+    {
+        std::uniform_int_distribution<int> tessellation(2, 6);
+        std::uniform_real_distribution<float> jitter(0.8f, 1.0f);
+        const int rings = tessellation(random), segments = tessellation(random) + 1;
+
+        std::vector<glm::vec3> vertices;
+        for (int ring = 0; ring <= rings; ring++)
+            for (int segment = 0; segment <= segments; segment++)
+            {
+                const float theta = glm::pi<float>() * (float)ring / (float)rings;
+                const float phi = glm::two_pi<float>() * (float)segment / (float)segments;
+                const float radius = 0.5f * (ring == 0 || ring == rings || segment == segments ? 1.0f : jitter(random));
+                vertices.emplace_back(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta),
+                                      radius * std::sin(theta) * std::sin(phi));
+            }
+        std::vector<uint32_t> indices;
+        for (int ring = 0; ring < rings; ring++)
+            for (int segment = 0; segment < segments; segment++)
+            {
+                const uint32_t a = (uint32_t)(ring * (segments + 1) + segment), b = a + (uint32_t)segments + 1;
+                indices.insert(indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+            }
+
+        MeshBuilder builder(sizeof(glm::vec3));
+        builder.addIndexed(vertices.data(), vertices.size(), indices.data(), indices.size());
+        return builder.build();
+    }
+}
+
+
+// Thousands of distinct meshes: one VAO and buffer pair per mesh, versus shared buffers drawn one call per mesh,
+// versus shared buffers drawn with a single glMultiDrawElementsIndirect
+void benchMultiDraw()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int MESH_COUNT = 4096;
+    constexpr int FRAMES = 20;
+    constexpr int TARGET_SIZE = 256;
+
+    const VertexLayout layout = {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3}};
+    std::mt19937 random(7);
+    std::vector<Mesh> meshes;
+    for (int i = 0; i < MESH_COUNT; i++)
+        meshes.push_back(lumpySphere(random));
+
+    // a 64 x 64 grid of them in front of the camera, as per-draw data (read at baseInstance) and as model matrices
+    std::vector<CubeInstance> perDraw;
+    std::vector<glm::mat4> models;
+    for (int i = 0; i < MESH_COUNT; i++)
+    {
+        const glm::vec3 position((float)(i % 64) - 31.5f, (float)(i / 64) - 31.5f, -60.0f);
+        perDraw.push_back({glm::vec4(position, 0.9f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 1.0f});
+        models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.9f)));
+    }
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle uniformProgram = variants.variant(0);
+    const ShaderHandle perDrawProgram = variants.variant(2);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    BenchScene scene(TARGET_SIZE, glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f));
+
+    // 1. every mesh with its own VAO, vertex buffer and index buffer
+    std::vector<unsigned int> VAOs(MESH_COUNT), buffers(2 * MESH_COUNT);
+    glGenVertexArrays(MESH_COUNT, VAOs.data());
+    glGenBuffers(2 * MESH_COUNT, buffers.data());
+    for (int i = 0; i < MESH_COUNT; i++)
+    {
+        const Mesh &mesh = meshes[(size_t)i];
+        glBindVertexArray(VAOs[(size_t)i]);
+        layout.setup(0);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[2 * (size_t)i]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)mesh.vertices.size(), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBindVertexBuffer(0, buffers[2 * (size_t)i], 0, (int)layout.stride());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2 * (size_t)i + 1]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)mesh.indices.size(), mesh.indices.data(), GL_STATIC_DRAW);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 2. and 3. every mesh in the registry, the per-draw data in an instance buffer
+    MeshRegistry registry(layout);
+    for (const Mesh &mesh : meshes)
+        registry.add(mesh);
+    unsigned int perDrawBuffer;
+    glGenBuffers(1, &perDrawBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, perDrawBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(perDraw.size() * sizeof(CubeInstance)), perDraw.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    Pipeline uniformPipeline({"per mesh", uniformProgram, layout, DepthState{}, BlendState{}, CullState{}}, fallback);
+    Pipeline perDrawPipeline({"registry", perDrawProgram, layout, DepthState{}, BlendState{}, CullState{},
+                              CubeField::instanceLayout()}, fallback);
+    IndirectDrawList drawList;
+
+    // median CPU time to submit a frame, and median time until the GPU is done with it
+    const auto measure = [&](const char *label, auto &&drawFrame) {
+        std::vector<double> submitMs, frameMs;
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            const BenchTimer timer;
+            drawFrame();
+            submitMs.push_back(timer.elapsedMs());
+            glFinish();
+            frameMs.push_back(timer.elapsedMs());
+        }
+        std::sort(submitMs.begin(), submitMs.end());
+        std::sort(frameMs.begin(), frameMs.end());
+        std::cout << MESH_COUNT << " meshes, " << label << ": " << submitMs[FRAMES / 2] << " ms CPU, "
+                  << frameMs[FRAMES / 2] << " ms frame" << std::endl;
+    };
+
+    measure("VAO per mesh         ", [&]() {
+        uniformPipeline.bind();
+        const Uniform<glm::mat4> model = uniformPipeline.program().uniform<glm::mat4>("model");
+        for (int i = 0; i < MESH_COUNT; i++)
+        {
+            glBindVertexArray(VAOs[(size_t)i]);
+            model.set(models[(size_t)i]);
+            glDrawElements(GL_TRIANGLES, (int)meshes[(size_t)i].indexCount, meshes[(size_t)i].indexType, nullptr);
+        }
+    });
+
+    measure("shared, draw per mesh", [&]() {
+        perDrawPipeline.bind();
+        registry.bind(perDrawPipeline);
+        perDrawPipeline.setInstanceBuffer(perDrawBuffer);
+        perDrawPipeline.program().uniform<glm::mat4>("model").set(glm::mat4(1.0f));
+        for (int i = 0; i < MESH_COUNT; i++)
+            registry.draw(i, 1, (unsigned int)i);
+    });
+
+    measure("shared, multi-draw   ", [&]() {
+        perDrawPipeline.bind();
+        registry.bind(perDrawPipeline);
+        perDrawPipeline.setInstanceBuffer(perDrawBuffer);
+        perDrawPipeline.program().uniform<glm::mat4>("model").set(glm::mat4(1.0f));
+        drawList.clear();
+        for (int i = 0; i < MESH_COUNT; i++)
+            drawList.add(registry.command(i, 1, (unsigned int)i));
+        drawList.submit(registry);
+    });
+
+    glBindVertexArray(0);
+    uniformPipeline.release();
+    perDrawPipeline.release();
+    registry.release();
+    drawList.release();
+    scene.release();
+    glDeleteBuffers(1, &perDrawBuffer);
+    glDeleteBuffers(2 * MESH_COUNT, buffers.data());
+    glDeleteVertexArrays(MESH_COUNT, VAOs.data());
+    glDeleteProgram(uniformProgram.get().ID);
+    glDeleteProgram(perDrawProgram.get().ID);
+}
@@ -0,0 +1,142 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "occlusion_culler.h"
+#include "simd.h"
+#include "parallel.h"
+
+
+namespace {
+    // the 12 triangles of the box from -1 to 1, counter-clockwise seen from outside
+    void boxTriangles(std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices)
+    {
+        positions.clear();
+        for (int corner = 0; corner < 8; corner++)
+            positions.emplace_back(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f);
+        const uint32_t faces[6][4] = {{0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+        indices.clear();
+        for (const auto &face : faces)
+        {
+            const glm::vec3 center = (positions[face[0]] + positions[face[2]]) * 0.5f;
+            const glm::vec3 normal = glm::cross(positions[face[1]] - positions[face[0]], positions[face[2]] - positions[face[0]]);
+            const bool outwards = glm::dot(normal, center) > 0.0f;
+            const uint32_t quad[6] = {face[0], face[1], face[2], face[0], face[2], face[3]};
+            for (int i = 0; i < 6; i++)
+                indices.push_back(outwards ? quad[i] : quad[i % 3 == 1 ? i + 1 : i % 3 == 2 ? i - 1 : i]);
+        }
+    }
+}
+
+// Software occlusion culling: a wall of 16 boxes in front of the camera hides part of 100000 boxes scattered behind
+// and around it. Every box truly hidden (all its corners behind the wall's front face, seen through it) should be
+// occluded, and none that is not; then the rasterizer alone, with a thousand boxes as occluders
+void benchOcclusion()
+{
+    constexpr size_t COUNT = 100000;
+    constexpr int RUNS = 9;
+    constexpr float WALL_Z = -20.0f;    // the middle of the wall, a unit thick
+    constexpr float WALL_HALF = 8.0f;
+
+    const glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    boxTriangles(positions, indices);
+
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> across(-30.0f, 30.0f), deep(-90.0f, -2.0f), size(0.1f, 1.0f);
+    std::vector<Aabb> boxes(COUNT);
+    for (Aabb &box : boxes)
+    {
+        box.min = glm::vec3(across(random), across(random), deep(random));
+        box.max = box.min + glm::vec3(size(random), size(random), size(random));
+    }
+    // hidden when every corner is behind the wall's front face and seen through it
+    const auto hidden = [&](const Aabb &box) {
+        if (box.max.z >= WALL_Z + 0.5f)
+            return false;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            const glm::vec3 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                                     corner & 4 ? box.max.z : box.min.z);
+            const glm::vec2 onFace = glm::vec2(position) * ((WALL_Z + 0.5f) / position.z);
+            if (std::abs(onFace.x) >= WALL_HALF || std::abs(onFace.y) >= WALL_HALF)
+                return false;
+        }
+        return true;
+    };
+
+    const auto median = [&](const auto &run) {
+        std::vector<double> runUs;
+        for (int i = 0; i < RUNS; i++)
+        {
+            const BenchTimer timer;
+            run();
+            runUs.push_back(timer.elapsedMs() * 1000.0);
+        }
+        std::sort(runUs.begin(), runUs.end());
+        return runUs[RUNS / 2];
+    };
+
+    OcclusionCuller culler;
+    const auto drawWall = [&] {
+        culler.begin(viewProj);
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+            {
+                const glm::vec3 center(-WALL_HALF + 2.0f + 4.0f * (float)x, -WALL_HALF + 2.0f + 4.0f * (float)y, WALL_Z);
+                culler.addOccluder(positions, indices, glm::scale(glm::translate(glm::mat4(1.0f), center),
+                                                                  glm::vec3(2.0f, 2.0f, 0.5f)));
+            }
+        culler.rasterize();
+    };
+    const double wallUs = median(drawWall);
+    std::vector<uint32_t> all(COUNT);
+    for (size_t i = 0; i < COUNT; i++)
+        all[i] = (uint32_t)i;
+    size_t visible = 0;
+    const double testUs = median([&] { visible = culler.cull(all, [&](const uint32_t i) { return boxes[i]; }).size(); });
+
+    std::vector<bool> kept(COUNT, false);
+    for (const uint32_t i : culler.cull(all, [&](const uint32_t i) { return boxes[i]; }))
+        kept[i] = true;
+    size_t hiddenCount = 0, hiddenOccluded = 0, wronglyOccluded = 0;
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        const bool isHidden = hidden(boxes[i]);
+        hiddenCount += isHidden;
+        hiddenOccluded += isHidden && !kept[i];
+        wronglyOccluded += !isHidden && !kept[i];
+    }
+
+    // a thousand boxes a few units across, all over the view
+    std::vector<glm::mat4> occluders(1000);
+    for (glm::mat4 &model : occluders)
+        model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(across(random), across(random), deep(random))),
+                           glm::vec3(size(random) * 4.0f));
+    culler.endFrame();
+    const double manyUs = median([&] {
+        culler.begin(viewProj);
+        for (const glm::mat4 &model : occluders)
+            culler.addOccluder(positions, indices, model);
+        culler.rasterize();
+    });
+    const size_t manyTriangles = culler.stats().triangles / RUNS;
+
+    std::cout << "Occlusion culling into " << OcclusionCuller::WIDTH << "x" << OcclusionCuller::HEIGHT << " with "
+              << simd::Lanes::NAME << " on " << workerCount() << " threads" << std::endl;
+    std::cout << "wall of 16 boxes drawn in " << wallUs << " us; " << COUNT << " boxes tested in " << testUs << " us, "
+              << COUNT - visible << " occluded" << std::endl;
+    std::cout << "  " << hiddenOccluded << " of " << hiddenCount << " hidden boxes occluded, " << wronglyOccluded
+              << " visible ones occluded" << std::endl;
+    std::cout << "1000 boxes (" << manyTriangles << " triangles facing the camera) drawn in " << manyUs << " us"
+              << std::endl;
+}
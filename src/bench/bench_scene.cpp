@@ -0,0 +1,121 @@
+// Standard libraries
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+
+
+BenchScene::BenchScene(const int size, const glm::mat4 &viewProj)
+{
+    glGenFramebuffers(1, &FBO);
+    glGenRenderbuffers(2, targets);
+    glBindRenderbuffer(GL_RENDERBUFFER, targets[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, targets[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, targets[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targets[1]);
+    glViewport(0, 0, size, size);
+
+    // the lighting of main.cpp
+    PerFrameBlock perFrame{};
+    perFrame.viewProj = viewProj;
+    perFrameBuffer.write(perFrame);
+    LightingBlock lighting{};
+    lighting.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    lightingBuffer.write(lighting);
+    MaterialBlock material{};
+    material.objectColor = glm::vec3(1.0f, 0.5f, 0.31f);
+    materialBuffer.write(material);
+}
+
+void BenchScene::release()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(2, targets);
+    perFrameBuffer.release();
+    lightingBuffer.release();
+    materialBuffer.release();
+}
+
+glm::mat4 benchCamera()
+{
+    return glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f)
+           * glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+const VertexLayout& benchCubeLayout()
+{
+    static const VertexLayout layout = {{VertexSemantic::POSITION, 0, VertexFormat::SNORM16_4}};
+    return layout;
+}
+
+Mesh benchCube()
+{
+    const VertexLayout sourceLayout = {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3}};
+    constexpr float corners[8][3] = {
+        {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}
+    };
+    constexpr uint32_t faces[36] = {
+        0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+        3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5
+    };
+    MeshBuilder builder(sourceLayout.stride());
+    builder.addIndexed(corners, 8, faces, 36);
+    return convertMesh(builder.build(), sourceLayout, benchCubeLayout());
+}
+
+Mesh benchSphere(const int rings, const int segments)
+{
+    std::vector<glm::vec3> vertices;
+    for (int ring = 0; ring <= rings; ring++)
+        for (int segment = 0; segment <= segments; segment++)
+        {
+            const float theta = glm::pi<float>() * (float)ring / (float)rings;
+            const float phi = glm::two_pi<float>() * (float)(segment % segments) / (float)segments;
+            // sin(pi) is not quite 0: the poles must be one position to weld
+            const float ringRadius = ring == 0 || ring == rings ? 0.0f : 0.5f * std::sin(theta);
+            vertices.emplace_back(ringRadius * std::cos(phi), 0.5f * std::cos(theta), ringRadius * std::sin(phi));
+        }
+    std::vector<uint32_t> indices;
+    for (int ring = 0; ring < rings; ring++)
+        for (int segment = 0; segment < segments; segment++)
+        {
+            const uint32_t a = (uint32_t)(ring * (segments + 1) + segment), b = a + (uint32_t)segments + 1;
+            indices.insert(indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+        }
+
+    MeshBuilder builder(sizeof(glm::vec3));
+    builder.addIndexed(vertices.data(), vertices.size(), indices.data(), indices.size());
+    return builder.build();
+}
+
+void writeBenchGridObj(const std::string &path, const int size)
+{
+    std::ofstream file(path, std::ios::binary);
+    char line[128];
+    for (int y = 0; y <= size; y++)
+        for (int x = 0; x <= size; x++)
+            file.write(line, std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x * 0.01f, y * 0.01f,
+                                           (float)((x * 7 + y * 13) % 100) * 0.001f));
+    for (int y = 0; y <= size; y++)
+        for (int x = 0; x <= size; x++)
+            file.write(line, std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)x / (float)size, (float)y / (float)size));
+    file << "vn 0.000000 0.000000 1.000000\n";
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+        {
+            const int a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 2, d = a + size + 1;
+            file.write(line, std::snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, c, c, d, d));
+        }
+}
@@ -0,0 +1,103 @@
+// Standard libraries
+#include <iostream>
+#include <vector>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "mesh_registry.h"
+#include "streaming_ring_buffer.h"
+#include "cube_field.h"
+
+
+// Per-frame instance data of the cube field reaching the GPU: re-specified buffer, mapped with invalidation,
+// and persistently mapped ring (with enough regions, and with a single one so that every frame waits)
+void benchStreaming()
+{
+    if (!benchContext())
+        return;
+
+    constexpr size_t CUBES = 100000;
+    constexpr int FRAMES = 60;
+    constexpr int TARGET_SIZE = 64;
+    constexpr size_t INSTANCE_BYTES = CUBES * sizeof(CubeInstance);
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/light/lighting.vert", "src/shaders/light/lighting.frag",
+                            {"LIGHT_SOURCE", "INSTANCED"});
+    const ShaderHandle program = variants.variant(2);
+    compiler.wait();
+
+    BenchScene scene(TARGET_SIZE, benchCamera());
+    MeshRegistry registry(benchCubeLayout());
+    const int cube = registry.add(benchCube());
+    Pipeline pipeline({"instanced", program, benchCubeLayout(), DepthState{}, BlendState{}, CullState{},
+                       CubeField::instanceLayout()}, compiler.fallback());
+    pipeline.bind();
+    registry.bind(pipeline);
+    pipeline.program().uniform<glm::mat4>("model").set(registry.range(cube).positionTransform);
+
+    const CubeField cubes(CUBES);
+    std::vector<CubeInstance> staging(CUBES);
+
+    // frames are not waited for, so the upload time includes whatever the upload makes the CPU wait for
+    const auto measure = [&](const char *label, auto &&upload, auto &&endFrame) {
+        glFinish();
+        double uploadMs = 0.0;
+        const BenchTimer timer;
+        for (int frame = 0; frame < FRAMES; frame++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            const BenchTimer uploadTimer;
+            upload((float)frame / 60.0f);
+            uploadMs += uploadTimer.elapsedMs();
+            registry.draw(cube, (unsigned int)CUBES);
+            endFrame();
+        }
+        glFinish();
+        std::cout << label << ": " << uploadMs / FRAMES << " ms upload, " << timer.elapsedMs() / FRAMES
+                  << " ms frame" << std::endl;
+    };
+
+    unsigned int instanceBuffer;
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, INSTANCE_BYTES, nullptr, GL_STREAM_DRAW);
+    pipeline.setInstanceBuffer(instanceBuffer);
+
+    measure("glBufferData + glBufferSubData", [&](const float time) {
+        cubes.instances(time, staging.data());
+        glBufferData(GL_ARRAY_BUFFER, INSTANCE_BYTES, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, INSTANCE_BYTES, staging.data());
+    }, []() {});
+
+    measure("map with invalidate            ", [&](const float time) {
+        void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, INSTANCE_BYTES, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        cubes.instances(time, static_cast<CubeInstance*>(mapped));
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }, []() {});
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &instanceBuffer);
+
+    for (const unsigned int regions : {3u, 1u})
+    {
+        StreamingRingBuffer ring(INSTANCE_BYTES, regions);
+        const auto upload = [&](const float time) {
+            ring.beginFrame();
+            const RingAllocation instances = ring.allocate(INSTANCE_BYTES);
+            cubes.instances(time, static_cast<CubeInstance*>(instances.data));
+            pipeline.setInstanceBuffer(ring.buffer(), instances.offset);
+        };
+        measure(regions == 3 ? "persistent ring, 3 frames      " : "persistent ring, 1 frame       ", upload,
+                [&]() { ring.endFrame(); });
+        ring.report();
+        ring.release();
+    }
+
+    glBindVertexArray(0);
+    pipeline.release();
+    registry.release();
+    scene.release();
+    glDeleteProgram(program.get().ID);
+}
@@ -0,0 +1,82 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "transform_system.h"
+#include "cube_field.h"
+#include "parallel.h"
+
+
+// World matrices: the per-object glm path of CubeField::model() (a translate, three rotates and a scale per cube)
+// against the TransformSystem with every transform changed, a tenth of them, and none, at 10k, 100k and 1M cubes
+void benchTransforms()
+{
+    constexpr size_t COUNTS[] = {10000, 100000, 1000000};
+    constexpr int RUNS = 5;
+
+    std::cout << "Transforms with " << TransformSystem::kernel() << ", " << TransformSystem::BLOCK
+              << " per iteration, on " << workerCount() << " threads" << std::endl;
+    for (const size_t count : COUNTS)
+    {
+        const CubeField cubes(count);
+        TransformSystem transforms;
+        cubes.addTransforms(transforms);
+        std::vector<glm::mat4> models(count);
+
+        // median of RUNS, each at a new time so that every cube changes
+        float time = 0.0f;
+        const auto median = [&](const auto &run) {
+            std::vector<double> runMs;
+            for (int i = 0; i < RUNS; i++)
+            {
+                time += 0.1f;
+                const BenchTimer timer;
+                run();
+                runMs.push_back(timer.elapsedMs());
+            }
+            std::sort(runMs.begin(), runMs.end());
+            return runMs[RUNS / 2];
+        };
+
+        const double glmMs = median([&] {
+            for (size_t i = 0; i < count; i++)
+                models[i] = cubes.model(i, time);
+        });
+        double animateMs = 0.0;
+        const double allMs = median([&] {
+            const BenchTimer animateTimer;
+            cubes.animate(time, transforms, 0);
+            animateMs = animateTimer.elapsedMs();
+            transforms.update();
+        });
+        const double tenthMs = median([&] {
+            for (size_t i = 0; i < count; i += 10)
+                transforms.setRotation(i, cubes.rotation(i, time));
+            transforms.update();
+        });
+        const double noneMs = median([&] { transforms.update(); });
+
+        // the two paths agree, to rounding
+        cubes.animate(time, transforms, 0);
+        transforms.update();
+        float error = 0.0f;
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::mat4 model = cubes.model(i, time);
+            for (int column = 0; column < 4; column++)
+                for (int row = 0; row < 4; row++)
+                    error = std::max(error, std::abs(model[column][row] - transforms.world(i)[column][row]));
+        }
+
+        std::cout << count << " transforms: glm " << glmMs << " ms, TransformSystem all changed " << allMs
+                  << " ms (" << animateMs << " ms of it setting the rotations), a tenth " << tenthMs << " ms, none "
+                  << noneMs << " ms; largest difference " << error << std::endl;
+    }
+}
@@ -0,0 +1,99 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Headers
+#include "bench.h"
+#include "shader.h"
+
+
+// Per-draw CPU cost of setting the cube uniforms, before (string + glGetUniformLocation on every call)
+// and after (handles resolved once)
+void benchUniforms()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int DRAWS = 10000;
+    constexpr int RUNS = 15;
+
+    const Shader shader(
+        "src/shaders/default/default.vert",
+        "src/shaders/default/default.frag"
+    );
+    shader.use();
+
+    // A single triangle is enough, we are measuring the CPU side of the submission
+    constexpr float vertices[] = {
+        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,
+        0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.5f, 0.0f, 0.5f, 1.0f
+    };
+    unsigned int VAO, VBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)nullptr);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    const glm::mat4 model(1.0f);
+
+    const auto measure = [&](const char *label, auto &&setUniforms) {
+        std::vector<double> runs;
+        for (int run = 0; run < RUNS; run++)
+        {
+            glFinish();
+            const BenchTimer timer;
+            for (int i = 0; i < DRAWS; i++)
+            {
+                setUniforms(i);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            runs.push_back(timer.elapsedMs());
+            glFinish();
+        }
+        std::sort(runs.begin(), runs.end());
+        const double median = runs[runs.size() / 2];
+        std::cout << label << ": " << median << " ms / " << DRAWS << " draws, "
+                  << median * 1.0e6 / DRAWS << " ns per draw" << std::endl;
+    };
+
+    measure("glGetUniformLocation per call", [&](const int i) {
+        const std::string alpha = "alpha", modelName = "model";
+        glUniform1f(glGetUniformLocation(shader.ID, alpha.c_str()), std::sin((float)i));
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, modelName.c_str()), 1, GL_FALSE, glm::value_ptr(model));
+    });
+
+    measure("reflected table, by name   ", [&](const int i) {
+        shader.setFloat("alpha", std::sin((float)i));
+        glUniformMatrix4fv(shader.findUniform("model")->location, 1, GL_FALSE, glm::value_ptr(model));
+    });
+
+    const Uniform<float> alpha = shader.uniform<float>("alpha");
+    const Uniform<glm::mat4> modelMat = shader.uniform<glm::mat4>("model");
+    measure("resolved handles           ", [&](const int i) {
+        alpha.set(std::sin((float)i));
+        modelMat.set(model);
+    });
+
+    // Most material uniforms never change between draws: the shadow copies skip those uploads
+    UniformUploadStats &stats = UniformUploadStats::get();
+    stats.endFrame();
+    measure("handles, constant values   ", [&](const int) {
+        alpha.set(0.5f);
+        modelMat.set(model);
+    });
+    stats.endFrame();
+    std::cout << "constant values: " << stats.lastFrame.issued << " uploads issued, "
+              << stats.lastFrame.elided << " elided" << std::endl;
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteProgram(shader.ID);
+}
@@ -0,0 +1,152 @@
+// Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bench.h"
+#include "shader_compiler.h"
+#include "pipeline.h"
+#include "vertex_layout.h"
+
+
+namespace {
+    // a wavy grid of about 1M triangles, authored as floats
+    Mesh makeTerrain(const VertexLayout &layout, const int cells)
+    {
+        Mesh mesh;
+        mesh.vertexSize = layout.stride();
+        const int side = cells + 1;
+        mesh.vertices.resize((size_t)side * side * layout.stride());
+        for (int y = 0; y < side; y++)
+            for (int x = 0; x < side; x++)
+            {
+                const float u = (float)x / (float)cells, v = (float)y / (float)cells;
+                const float height = 0.05f * std::sin(u * 40.0f) * std::cos(v * 40.0f);
+                const glm::vec3 position(u * 2.0f - 1.0f, v * 2.0f - 1.0f, height);
+                const glm::vec3 normal = glm::normalize(glm::vec3(-2.0f * std::cos(u * 40.0f) * std::cos(v * 40.0f),
+                                                                  2.0f * std::sin(u * 40.0f) * std::sin(v * 40.0f), 1.0f));
+                const glm::vec4 tangent(glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), normal)), 1.0f);
+                const glm::vec2 texCoord(u, v);
+
+                float *vertex = reinterpret_cast<float*>(mesh.vertices.data() + ((size_t)y * side + x) * layout.stride());
+                std::copy(&position.x, &position.x + 3, vertex);
+                std::copy(&normal.x, &normal.x + 3, vertex + 3);
+                std::copy(&texCoord.x, &texCoord.x + 2, vertex + 6);
+                std::copy(&tangent.x, &tangent.x + 4, vertex + 8);
+            }
+
+        // rows of quads: already cache-friendly, MeshBuilder would only add a second of build time here
+        std::vector<uint32_t> indices;
+        indices.reserve((size_t)cells * cells * 6);
+        for (int y = 0; y < cells; y++)
+            for (int x = 0; x < cells; x++)
+            {
+                const uint32_t a = y * side + x, b = a + 1, c = a + side, d = c + 1;
+                indices.insert(indices.end(), {a, b, d, a, d, c});
+            }
+        mesh.indexType = GL_UNSIGNED_INT;
+        mesh.indexCount = (unsigned int)indices.size();
+        mesh.indices.resize(indices.size() * sizeof(uint32_t));
+        std::copy_n(reinterpret_cast<const unsigned char*>(indices.data()), mesh.indices.size(), mesh.indices.data());
+        return mesh;
+    }
+}
+
+// Draw throughput of a 1M-triangle mesh stored with float attributes and with quantized ones
+void benchVertexFormats()
+{
+    if (!benchContext())
+        return;
+
+    constexpr int CELLS = 708;  // 708 * 708 * 2 = 1 002 528 triangles
+    constexpr int RUNS = 9;
+    constexpr int TARGET_SIZE = 1024;
+
+    const VertexLayout floatLayout = {
+        {VertexSemantic::POSITION, 0, VertexFormat::FLOAT3},
+        {VertexSemantic::NORMAL, 1, VertexFormat::FLOAT3},
+        {VertexSemantic::TEXCOORD, 2, VertexFormat::FLOAT2},
+        {VertexSemantic::TANGENT, 3, VertexFormat::FLOAT4}
+    };
+    const VertexLayout quantizedLayout = {
+        {VertexSemantic::POSITION, 0, VertexFormat::SNORM16_4},
+        {VertexSemantic::NORMAL, 1, VertexFormat::OCT_10_10_10_2},
+        {VertexSemantic::TEXCOORD, 2, VertexFormat::UNORM16_2},
+        {VertexSemantic::TANGENT, 3, VertexFormat::OCT_10_10_10_2}
+    };
+
+    const Mesh floatMesh = makeTerrain(floatLayout, CELLS);
+    const Mesh quantizedMesh = convertMesh(floatMesh, floatLayout, quantizedLayout);
+
+    ShaderCompiler compiler;
+    ShaderVariants variants(compiler, "src/shaders/bench/mesh.vert", "src/shaders/bench/mesh.frag", {"QUANTIZED"});
+    const ShaderHandle floatProgram = variants.variant(0);
+    const ShaderHandle quantizedProgram = variants.variant(1);
+    compiler.wait();
+    const Shader &fallback = compiler.fallback();
+
+    // offscreen target, so the window size does not matter
+    unsigned int FBO, targets[2];
+    glGenFramebuffers(1, &FBO);
+    glGenRenderbuffers(2, targets);
+    glBindRenderbuffer(GL_RENDERBUFFER, targets[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, targets[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, TARGET_SIZE, TARGET_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, targets[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, targets[1]);
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+
+    const glm::mat4 viewProj = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 10.0f)
+                               * glm::lookAt(glm::vec3(0.0f, -1.5f, 1.2f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+    const auto measure = [&](const char *label, const Mesh &mesh, const VertexLayout &layout, const ShaderHandle &program) {
+        unsigned int buffers[2];
+        glGenBuffers(2, buffers);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)mesh.vertices.size(), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)mesh.indices.size(), mesh.indices.data(), GL_STATIC_DRAW);
+
+        Pipeline pipeline({label, program, layout, DepthState{}, BlendState{}, CullState{}}, fallback);
+        pipeline.bind();
+        pipeline.setVertexBuffer(buffers[0]);
+        pipeline.setIndexBuffer(buffers[1]);
+        pipeline.program().uniform<glm::mat4>("mvp").set(viewProj * mesh.positionTransform);
+
+        std::vector<double> runs;
+        for (int run = 0; run < RUNS; run++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glFinish();
+            const BenchTimer timer;
+            glDrawElements(GL_TRIANGLES, (int)mesh.indexCount, mesh.indexType, nullptr);
+            glFinish();
+            runs.push_back(timer.elapsedMs());
+        }
+        std::sort(runs.begin(), runs.end());
+        const double median = runs[runs.size() / 2];
+        std::cout << label << ": " << layout.stride() << " bytes/vertex, " << mesh.vertices.size() / (1024 * 1024)
+                  << " MiB of vertices, " << median << " ms per draw, "
+                  << (double)mesh.indexCount / 3.0 / median / 1000.0 << " Mtri/s" << std::endl;
+
+        glBindVertexArray(0);
+        pipeline.release();
+        glDeleteBuffers(2, buffers);
+    };
+
+    measure("float    ", floatMesh, floatLayout, floatProgram);
+    measure("quantized", quantizedMesh, quantizedLayout, quantizedProgram);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(2, targets);
+    glDeleteProgram(floatProgram.get().ID);
+    glDeleteProgram(quantizedProgram.get().ID);
+}
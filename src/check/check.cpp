@@ -0,0 +1,500 @@
+// Standard libraries
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Included libraries
+#include <glm/gtc/matrix_transform.hpp>
+
+// Headers
+#include "bvh.h"
+#include "frustum_culler.h"
+#include "mesh_builder.h"
+#include "mesh_importer.h"
+#include "shader_preprocessor.h"
+
+
+// Correctness checks of the CPU-side code, none of which needs a GL context. Each prints what it found wrong and
+// returns false; the errors the importers and the preprocessor print along the way are expected.
+namespace {
+    bool fail(const char *check, const std::string &what)
+    {
+        std::cout << "ERROR::CHECK::" << check << ": " << what << std::endl;
+        return false;
+    }
+
+    // ---- OBJ
+
+    // A corner as the importer should have read it
+    struct ObjVertex
+    {
+        float position[3];
+        float texcoord[2];
+    };
+
+    // Blocks of 4 vertices and 4 texcoords, each followed by a face: a quad by absolute indices, or a triangle by
+    // negative ones reaching two blocks back. The file is a few MB, so it is split into chunks and some of the
+    // negative indices point into the chunk before theirs.
+    bool checkObjRelativeIndices()
+    {
+        constexpr int BLOCKS = 30000;
+        std::string text;
+        std::vector<ObjVertex> expected;
+        std::vector<ObjVertex> vertices;
+        for (int block = 0; block < BLOCKS; block++)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                const ObjVertex vertex = {{(float)block, (float)k, 0.25f * (float)k}, {0.5f * (float)block, (float)k}};
+                vertices.push_back(vertex);
+                text += "v " + std::to_string(block) + " " + std::to_string(k) + " " + std::to_string(0.25f * (float)k) + "\n";
+                text += "vt " + std::to_string(0.5f * (float)block) + " " + std::to_string(k) + "\n";
+            }
+            const int last = (int)vertices.size();     // 1-based index of the block's last vertex
+            if (block % 2 == 0 || block < 2)
+            {
+                const int first = last - 3;
+                text += "f " + std::to_string(first) + "/" + std::to_string(first);
+                for (int k = 1; k < 4; k++)
+                    text += " " + std::to_string(first + k) + "/" + std::to_string(first + k);
+                text += "\n";
+                for (const int corner : {first, first + 1, first + 2, first, first + 2, first + 3})
+                    expected.push_back(vertices[(size_t)corner - 1]);
+            }
+            else
+            {
+                text += "f -12/-12 -7/-7 -1/-1\n";
+                for (const int back : {12, 7, 1})
+                    expected.push_back(vertices[(size_t)(last - back)]);
+            }
+        }
+
+        for (const unsigned int threads : {1u, 4u})
+        {
+            ImportedMesh imported;
+            if (!importObj(text.data(), text.size(), imported, threads))
+                return fail("OBJ", "valid file rejected with " + std::to_string(threads) + " thread(s)");
+            const Mesh &mesh = imported.mesh;
+            const std::vector<uint32_t> indices = unpackIndices(mesh);
+            const VertexAttribute *texcoord = imported.layout.find(VertexSemantic::TEXCOORD);
+            if (indices.size() != expected.size() || texcoord == nullptr)
+                return fail("OBJ", std::to_string(indices.size()) + " corners read, " + std::to_string(expected.size()) + " written");
+            for (size_t c = 0; c < indices.size(); c++)
+            {
+                const unsigned char *vertex = mesh.vertices.data() + (size_t)indices[c] * mesh.vertexSize;
+                if (std::memcmp(vertex, expected[c].position, sizeof(expected[c].position)) != 0
+                    || std::memcmp(vertex + texcoord->offset, expected[c].texcoord, sizeof(expected[c].texcoord)) != 0)
+                    return fail("OBJ", "corner " + std::to_string(c) + " differs with " + std::to_string(threads) + " thread(s)");
+            }
+        }
+
+        // counting back past the first vertex
+        const std::string before = "v 0 0 0\nv 1 0 0\nf -1 -2 -3\n";
+        ImportedMesh imported;
+        if (importObj(before.data(), before.size(), imported))
+            return fail("OBJ", "negative index before the first vertex accepted");
+        return true;
+    }
+
+    // ---- glTF
+
+    // a .glb of one JSON chunk and one binary chunk
+    std::vector<unsigned char> makeGlb(std::string json, const std::vector<unsigned char> &bin)
+    {
+        while (json.size() % 4 != 0)
+            json += ' ';
+        std::vector<unsigned char> paddedBin = bin;
+        paddedBin.resize((bin.size() + 3) / 4 * 4, 0);
+
+        std::vector<unsigned char> glb;
+        const auto word = [&](const uint32_t value) {
+            const unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16),
+                                            (unsigned char)(value >> 24)};
+            glb.insert(glb.end(), bytes, bytes + 4);
+        };
+        word(0x46546C67);
+        word(2);
+        word((uint32_t)(12 + 8 + json.size() + 8 + paddedBin.size()));
+        word((uint32_t)json.size());
+        word(0x4E4F534A);
+        glb.insert(glb.end(), json.begin(), json.end());
+        word((uint32_t)paddedBin.size());
+        word(0x004E4942);
+        glb.insert(glb.end(), paddedBin.begin(), paddedBin.end());
+        return glb;
+    }
+
+    // One triangle: 3 float positions in view 0, 3 unsigned short indices in view 1. Every case but the first
+    // breaks one field and must be rejected.
+    bool checkGltfAccessors()
+    {
+        std::vector<unsigned char> bin(42);
+        const float positions[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+        const uint16_t indices[3] = {0, 1, 2};
+        std::memcpy(bin.data(), positions, sizeof(positions));
+        std::memcpy(bin.data() + 36, indices, sizeof(indices));
+
+        struct Case
+        {
+            const char *name;
+            std::string positionView, indexView, positionAccessor, indexAccessor;
+        };
+        const std::string positionView = R"({"buffer":0,"byteOffset":0,"byteLength":36})";
+        const std::string indexView = R"({"buffer":0,"byteOffset":36,"byteLength":6})";
+        const std::string positionAccessor = R"({"bufferView":0,"componentType":5126,"count":3,"type":"VEC3"})";
+        const std::string indexAccessor = R"({"bufferView":1,"componentType":5123,"count":3,"type":"SCALAR"})";
+        const std::vector<Case> cases = {
+            {"valid", positionView, indexView, positionAccessor, indexAccessor},
+            {"count past the view", positionView, indexView,
+             R"({"bufferView":0,"componentType":5126,"count":4,"type":"VEC3"})", indexAccessor},
+            {"count past the binary chunk", R"({"buffer":0,"byteOffset":0,"byteLength":1000})", indexView,
+             R"({"bufferView":0,"componentType":5126,"count":4,"type":"VEC3"})", indexAccessor},
+            {"negative count", positionView, indexView,
+             R"({"bufferView":0,"componentType":5126,"count":-1,"type":"VEC3"})", indexAccessor},
+            {"fractional count", positionView, indexView,
+             R"({"bufferView":0,"componentType":5126,"count":2.5,"type":"VEC3"})", indexAccessor},
+            {"count of 2^32", positionView, indexView,
+             R"({"bufferView":0,"componentType":5126,"count":4294967296,"type":"VEC3"})", indexAccessor},
+            {"negative byte offset", positionView, indexView,
+             R"({"bufferView":0,"byteOffset":-12,"componentType":5126,"count":3,"type":"VEC3"})", indexAccessor},
+            {"byte offset near 2^32", positionView, indexView,
+             R"({"bufferView":0,"byteOffset":4294967290,"componentType":5126,"count":3,"type":"VEC3"})", indexAccessor},
+            {"huge stride", R"({"buffer":0,"byteOffset":0,"byteLength":36,"byteStride":4294967294})", indexView,
+             positionAccessor, indexAccessor},
+            {"missing buffer view", positionView, indexView,
+             R"({"bufferView":7,"componentType":5126,"count":3,"type":"VEC3"})", indexAccessor},
+            {"string buffer view", positionView, indexView,
+             R"({"bufferView":"0","componentType":5126,"count":3,"type":"VEC3"})", indexAccessor},
+            {"float indices", positionView, indexView, positionAccessor,
+             R"({"bufferView":1,"componentType":5126,"count":1,"type":"SCALAR"})"},
+            {"signed indices", positionView, indexView, positionAccessor,
+             R"({"bufferView":1,"componentType":5122,"count":3,"type":"SCALAR"})"},
+            {"index past the vertices", positionView, R"({"buffer":0,"byteOffset":38,"byteLength":6})", positionAccessor,
+             R"({"bufferView":1,"componentType":5123,"count":3,"type":"SCALAR"})"},
+        };
+
+        bool passed = true;
+        for (size_t i = 0; i < cases.size(); i++)
+        {
+            const Case &test = cases[i];
+            std::vector<unsigned char> caseBin = bin;
+            if (i + 1 == cases.size())
+            {
+                // indices 1, 2, 3 of 3 vertices
+                const uint16_t shifted[3] = {1, 2, 3};
+                caseBin.resize(44);
+                std::memcpy(caseBin.data() + 38, shifted, sizeof(shifted));
+            }
+            const std::string json = R"({"asset":{"version":"2.0"},"buffers":[{"byteLength":)" + std::to_string(caseBin.size())
+                                     + R"(}],"bufferViews":[)" + test.positionView + "," + test.indexView
+                                     + R"(],"accessors":[)" + test.positionAccessor + "," + test.indexAccessor
+                                     + R"(],"meshes":[{"primitives":[{"attributes":{"POSITION":0},"indices":1}]}]})";
+            const std::vector<unsigned char> glb = makeGlb(json, caseBin);
+            ImportedMesh imported;
+            const bool accepted = importGlb(glb.data(), glb.size(), imported);
+            if (i == 0 && (!accepted || imported.mesh.vertexCount() != 3 || imported.mesh.indexCount != 3))
+                passed = fail("GLTF", "valid file not read back");
+            if (i != 0 && accepted)
+                passed = fail("GLTF", std::string(test.name) + " accepted");
+        }
+        return passed;
+    }
+
+    // ---- shader preprocessor
+
+    bool writeFile(const std::filesystem::path &path, const std::string &text)
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+        return file.good();
+    }
+
+    std::vector<std::string> lines(const std::string &text)
+    {
+        std::vector<std::string> result;
+        std::istringstream stream(text);
+        for (std::string line; std::getline(stream, line); )
+            result.push_back(line);
+        return result;
+    }
+
+    // #if expressions and nesting, #include with #pragma once, and the #line of every run of lines kept
+    bool checkPreprocessor()
+    {
+        const std::filesystem::path directory = std::filesystem::temp_directory_path() / "opengl_check";
+        std::filesystem::create_directories(directory);
+        const bool written =
+            writeFile(directory / "inc.glsl", "#pragma once\nint included;\n")
+            && writeFile(directory / "main.frag",
+                         "#version 450 core\n"
+                         "#include \"inc.glsl\"\n"
+                         "#include \"inc.glsl\"\n"
+                         "#if defined(A) && (B + 1) * 2 == 4\n"
+                         "int taken1;\n"
+                         "#elif defined(A)\n"
+                         "int wrong1;\n"
+                         "#else\n"
+                         "int wrong2;\n"
+                         "#endif\n"
+                         "#ifndef C\n"
+                         "int taken2;\n"
+                         "#  if 0 /* dead */\n"
+                         "int wrong3;\n"
+                         "#  endif\n"
+                         "#endif\n"
+                         "int last;\n")
+            && writeFile(directory / "broken.frag", "#version 450 core\n#include \"missing.glsl\"\nint never;\n");
+        if (!written)
+            return fail("PREPROCESSOR", "cannot write to " + directory.generic_string());
+
+        bool passed = true;
+        const std::vector<std::string> output = lines(ShaderPreprocessor::process((directory / "main.frag").generic_string(),
+                                                                                  {{"A", "1"}, {"B", "1"}}));
+        std::vector<std::string> code;
+        for (const std::string &line : output)
+            if (!line.empty() && line[0] != '#' && line.compare(0, 2, "//") != 0)
+                code.push_back(line);
+        const std::vector<std::string> expectedCode = {"int included;", "int taken1;", "int taken2;", "int last;"};
+        if (output.empty() || output[0] != "#version 450 core" || code != expectedCode)
+            passed = fail("PREPROCESSOR", "#if/#include output differs");
+
+        // the line before each kept one puts the driver back in step: file 0 is main.frag, file 1 inc.glsl
+        const std::pair<const char*, const char*> lineDirectives[] = {
+            {"int included;", "#line 2 1"}, {"int taken1;", "#line 5 0"}, {"int taken2;", "#line 12 0"}, {"int last;", "#line 17 0"}};
+        for (const auto &expected : lineDirectives)
+        {
+            const auto found = std::find(output.begin(), output.end(), expected.first);
+            if (found == output.begin() || found == output.end() || *(found - 1) != expected.second)
+                passed = fail("PREPROCESSOR", std::string(expected.first) + " not preceded by " + expected.second);
+        }
+
+        if (!ShaderPreprocessor::process((directory / "broken.frag").generic_string()).empty())
+            passed = fail("PREPROCESSOR", "missing include accepted");
+
+        std::filesystem::remove_all(directory);
+        return passed;
+    }
+
+    // ---- MeshBuilder
+
+    // a triangle as its 3 vertices' bytes, starting from the smallest vertex so that the winding is kept
+    using Triangle = std::array<std::vector<unsigned char>, 3>;
+
+    std::vector<Triangle> triangleSet(const unsigned char *vertices, const unsigned int vertexSize,
+                                      const std::vector<uint32_t> &indices)
+    {
+        std::vector<Triangle> triangles(indices.size() / 3);
+        for (size_t t = 0; t < triangles.size(); t++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                const unsigned char *vertex = vertices + (size_t)indices[t * 3 + c] * vertexSize;
+                triangles[t][c].assign(vertex, vertex + vertexSize);
+            }
+            std::rotate(triangles[t].begin(), std::min_element(triangles[t].begin(), triangles[t].end()), triangles[t].end());
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    // A bumpy grid as a triangle soup, every vertex repeated by the quads around it: welding, the cache, overdraw
+    // and fetch orders and the meshlets must keep exactly the same triangles
+    bool checkMeshBuilder()
+    {
+        constexpr int SIDE = 40;
+        constexpr unsigned int VERTEX_SIZE = 5 * sizeof(float);
+        std::vector<float> soup;
+        std::vector<uint32_t> soupIndices;
+        const auto vertex = [&](const int x, const int y) {
+            soup.insert(soup.end(), {(float)x, (float)y, std::sin((float)(x * y) * 0.1f), (float)x / SIDE, (float)y / SIDE});
+            soupIndices.push_back((uint32_t)soupIndices.size());
+        };
+        for (int y = 0; y < SIDE; y++)
+            for (int x = 0; x < SIDE; x++)
+            {
+                vertex(x, y), vertex(x + 1, y), vertex(x + 1, y + 1);
+                vertex(x, y), vertex(x + 1, y + 1), vertex(x, y + 1);
+            }
+
+        MeshBuilder builder(VERTEX_SIZE);
+        builder.addTriangles(soup.data(), soupIndices.size());
+        const Mesh mesh = builder.build();
+        const std::vector<uint32_t> indices = unpackIndices(mesh);
+
+        bool passed = true;
+        if (mesh.vertexCount() != (SIDE + 1) * (SIDE + 1))
+            passed = fail("MESH_BUILDER", std::to_string(mesh.vertexCount()) + " vertices after welding");
+        if (triangleSet(reinterpret_cast<const unsigned char*>(soup.data()), VERTEX_SIZE, soupIndices)
+            != triangleSet(mesh.vertices.data(), mesh.vertexSize, indices))
+            passed = fail("MESH_BUILDER", "triangle set changed");
+
+        uint32_t next = 0;
+        for (const Meshlet &meshlet : mesh.meshlets)
+        {
+            if (meshlet.firstIndex != next || meshlet.triangleCount > MESHLET_MAX_TRIANGLES
+                || meshlet.vertexCount > MESHLET_MAX_VERTICES)
+                passed = fail("MESH_BUILDER", "meshlet at index " + std::to_string(meshlet.firstIndex) + " out of place or too large");
+            next = meshlet.firstIndex + meshlet.triangleCount * 3;
+        }
+        if (!mesh.meshlets.empty() && next != mesh.indexCount)
+            passed = fail("MESH_BUILDER", "meshlets do not cover every index");
+        return passed;
+    }
+
+    // ---- BVH
+
+    // Random boxes, some moved a little and some far after the build, then every query against testing each box.
+    // A box within a hair of a frustum plane may go either way.
+    bool checkBvhQueries()
+    {
+        constexpr size_t COUNT = 4000;
+        constexpr float SIDE = 40.0f;
+        std::mt19937 random(5);
+        std::uniform_real_distribution<float> across(-SIDE * 0.5f, SIDE * 0.5f), size(0.1f, 2.0f), unit(-1.0f, 1.0f);
+        const auto randomBox = [&] {
+            Aabb box;
+            box.min = glm::vec3(across(random), across(random), across(random));
+            box.max = box.min + glm::vec3(size(random), size(random), size(random));
+            return box;
+        };
+        std::vector<Aabb> boxes(COUNT);
+        for (Aabb &box : boxes)
+            box = randomBox();
+
+        Bvh bvh;
+        bvh.build(boxes);
+        for (int move = 0; move < 2000; move++)
+        {
+            const uint32_t object = (uint32_t)(random() % COUNT);
+            if (move % 4 == 0)
+                boxes[object] = randomBox();
+            else
+            {
+                const glm::vec3 step(unit(random) * 0.2f, unit(random) * 0.2f, unit(random) * 0.2f);
+                boxes[object] = {boxes[object].min + step, boxes[object].max + step};
+            }
+            bvh.update(object, boxes[object]);
+            if (move % 500 == 499)
+                bvh.rebuildIfDegraded();
+        }
+
+        bool passed = true;
+        std::vector<uint32_t> found;
+        const auto sorted = [](std::vector<uint32_t> &objects) -> std::vector<uint32_t>& {
+            std::sort(objects.begin(), objects.end());
+            return objects;
+        };
+        for (int query = 0; query < 50 && passed; query++)
+        {
+            const glm::vec3 eye(across(random), across(random), across(random));
+            const glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 0.01f));
+            const glm::mat4 viewProj = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 30.0f)
+                                       * glm::lookAt(eye, eye + direction, glm::vec3(0.0f, 1.0f, 0.0f));
+            glm::vec4 planes[6];
+            frustumPlanes(viewProj, planes);
+            found.clear();
+            bvh.queryFrustum(planes, found);
+            sorted(found);
+            for (uint32_t i = 0; i < COUNT; i++)
+            {
+                bool inside = true, outside = false;
+                for (const glm::vec4 &plane : planes)
+                {
+                    const float margin = glm::dot(glm::vec3(plane), boxes[i].center()) + plane.w
+                                         + glm::dot(glm::abs(glm::vec3(plane)), boxes[i].extent());
+                    inside &= margin > 1e-4f;
+                    outside |= margin < -1e-4f;
+                }
+                const bool reported = std::binary_search(found.begin(), found.end(), i);
+                if ((inside && !reported) || (outside && reported))
+                    passed = fail("BVH", "frustum query " + std::to_string(query) + " differs on object " + std::to_string(i));
+            }
+
+            const Aabb box = randomBox();
+            const glm::vec3 center(across(random), across(random), across(random));
+            const float radius = size(random) * 3.0f;
+            std::vector<uint32_t> inBox, inSphere;
+            for (uint32_t i = 0; i < COUNT; i++)
+            {
+                if (boxes[i].overlaps(box))
+                    inBox.push_back(i);
+                const glm::vec3 outside = glm::max(glm::max(boxes[i].min - center, center - boxes[i].max), glm::vec3(0.0f));
+                if (glm::dot(outside, outside) <= radius * radius)
+                    inSphere.push_back(i);
+            }
+            found.clear();
+            bvh.queryBox(box, found);
+            if (sorted(found) != inBox)
+                passed = fail("BVH", "box query " + std::to_string(query) + " differs");
+            found.clear();
+            bvh.querySphere(center, radius, found);
+            if (sorted(found) != inSphere)
+                passed = fail("BVH", "sphere query " + std::to_string(query) + " differs");
+        }
+
+        for (int ray = 0; ray < 1000 && passed; ray++)
+        {
+            const glm::vec3 origin(across(random), across(random), across(random));
+            const glm::vec3 direction(unit(random), unit(random), unit(random));
+            const float limit = ray % 2 == 0 ? FLT_MAX : SIDE * 0.25f;
+            float nearest = limit;
+            const glm::vec3 inverse = 1.0f / direction;
+            for (const Aabb &box : boxes)
+            {
+                const glm::vec3 t1 = (box.min - origin) * inverse, t2 = (box.max - origin) * inverse;
+                const glm::vec3 near = glm::min(t1, t2), far = glm::max(t1, t2);
+                const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+                if (entry <= std::min(std::min(far.x, far.y), far.z) && entry < nearest)
+                    nearest = entry;
+            }
+            const BvhHit hit = bvh.raycast(origin, direction, limit);
+            const bool missed = nearest == limit;
+            if (missed != (hit.object == Bvh::NONE) || (!missed && std::abs(hit.distance - nearest) > 1e-5f * (1.0f + nearest)))
+                passed = fail("BVH", "ray " + std::to_string(ray) + " hits at " + std::to_string(hit.distance) + ", nearest box at "
+                                     + std::to_string(nearest));
+        }
+        return passed;
+    }
+
+    struct Check
+    {
+        const char *name;
+        bool (*run)();
+    };
+
+    constexpr Check checks[] = {
+        {"obj", checkObjRelativeIndices},
+        {"gltf", checkGltfAccessors},
+        {"preprocessor", checkPreprocessor},
+        {"mesh_builder", checkMeshBuilder},
+        {"bvh", checkBvhQueries},
+    };
+}
+
+// Usage: OpenGLCheck [name...]  (runs every check when no name is given); exits with 1 if any failed
+int main(const int argc, char **argv) {
+    int failed = 0;
+    for (const Check &check : checks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            selected |= std::strcmp(argv[i], check.name) == 0;
+
+        if (!selected)
+            continue;
+
+        std::cout << "== " << check.name << std::endl;
+        const bool passed = check.run();
+        std::cout << "== " << check.name << (passed ? ": ok" : ": FAILED") << std::endl;
+        failed += passed ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+#ifndef OPENGL_BLOCK_LAYOUT_H
+#define OPENGL_BLOCK_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "glm/glm.hpp"
+
+// Expected layout of one member of a uniform or storage block, as computed by blockgen
+struct BlockMemberLayout
+{
+    const char *name;
+    unsigned int offset;
+    unsigned int arrayStride;   // 0 for non-arrays
+    unsigned int matrixStride;  // 0 for non-matrices
+};
+
+// Expected layout of a uniform or storage block. The structs generated into shader_blocks.h expose one as LAYOUT,
+// and Shader::verifyBlock() checks it against the linked program.
+struct BlockLayout
+{
+    const char *name;
+    bool storage;               // buffer (SSBO) rather than uniform block
+    unsigned int size;          // 0 when the block ends with a runtime-sized array
+    const BlockMemberLayout *members;
+    size_t memberCount;
+};
+
+// An array element padded to the array stride of its block layout (std140 rounds every stride up to a vec4)
+template<typename T, size_t Stride>
+struct BlockElement
+{
+    T value;
+    uint8_t padding[Stride - sizeof(T)];
+
+    BlockElement& operator=(const T &other) { value = other; return *this; }
+    operator const T&() const { return value; }
+};
+
+// A mat3 as std140/std430 store it: three columns, each padded to a vec4
+struct BlockMat3
+{
+    glm::vec4 columns[3];
+
+    BlockMat3& operator=(const glm::mat3 &other)
+    {
+        for (int i = 0; i < 3; i++)
+            columns[i] = glm::vec4(other[i], 0.0f);
+        return *this;
+    }
+    operator glm::mat3() const { return glm::mat3(glm::vec3(columns[0]), glm::vec3(columns[1]), glm::vec3(columns[2])); }
+};
+
+#endif //OPENGL_BLOCK_LAYOUT_H
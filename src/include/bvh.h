@@ -0,0 +1,105 @@
+#ifndef OPENGL_BVH_H
+#define OPENGL_BVH_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+// An axis-aligned box
+struct Aabb
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+    float area() const
+    {
+        const glm::vec3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+    bool contains(const Aabb &box) const
+    {
+        return glm::all(glm::lessThanEqual(min, box.min)) && glm::all(glm::lessThanEqual(box.max, max));
+    }
+    bool overlaps(const Aabb &box) const
+    {
+        return glm::all(glm::lessThanEqual(min, box.max)) && glm::all(glm::lessThanEqual(box.min, max));
+    }
+    void merge(const Aabb &box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+    static Aabb empty() { return {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)}; }
+};
+
+// the box around box moved by transform (rotation, translation, scale)
+Aabb transformBox(const Aabb &box, const glm::mat4 &transform);
+
+// The nearest object a ray hits, at distance along the ray (0 when it starts inside); object is Bvh::NONE on a miss
+struct BvhHit
+{
+    uint32_t object;
+    float distance;
+};
+
+// A bounding volume hierarchy over the boxes of moving objects. build() splits them top-down with the binned
+// surface area heuristic into leaves of up to MAX_LEAF objects. Each object keeps a loose copy of its box, a fifth
+// of its size larger: update() costs nothing while an object stays inside it, and otherwise refits its leaf and the
+// ancestors up to the first one that does not change, O(log n). Refits wear the tree down over time; once enough
+// objects have moved, rebuildIfDegraded() measures the tree's cost and builds it again if it grew too much.
+// Queries test the exact boxes.
+class Bvh
+{
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr unsigned int MAX_LEAF = 4;
+
+    // object i is boxes[i]
+    void build(const std::vector<Aabb> &boxes);
+    size_t size() const { return boxes.size(); }
+
+    void update(uint32_t object, const Aabb &box);
+    const Aabb& box(uint32_t object) const { return boxes[object]; }
+    // returns whether it rebuilt
+    bool rebuildIfDegraded();
+
+    // the objects whose boxes are at least partly inside the frustum (planes from frustumPlanes()), overlap box, or
+    // overlap the sphere, appended to out in no particular order
+    void queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t> &out) const;
+    void queryBox(const Aabb &box, std::vector<uint32_t> &out) const;
+    void querySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &out) const;
+    // direction need not be normalized; distances are in its length
+    BvhHit raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance = FLT_MAX) const;
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t refits() const { return refitCount; }
+    // the surface area heuristic's cost of a ray through the tree, relative to the root's area
+    float cost() const;
+
+private:
+    struct Node
+    {
+        Aabb bounds;
+        uint32_t first;     // the first of two adjacent children, or of the leaf's objects in order
+        uint32_t count;     // objects of a leaf, 0 for an inner node
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> order;        // the objects, leaf by leaf
+    std::vector<Aabb> boxes;            // exact
+    std::vector<Aabb> looseBoxes;
+    std::vector<uint32_t> leaves;       // of each object
+    size_t refitCount = 0;
+    size_t movedSinceCheck = 0;
+    float builtCost = 0.0f;
+
+    // the objects of node's subtree, appended to out
+    void collect(uint32_t node, std::vector<uint32_t> &out) const;
+};
+
+#endif //OPENGL_BVH_H
@@ -0,0 +1,52 @@
+#ifndef OPENGL_CUBE_FIELD_H
+#define OPENGL_CUBE_FIELD_H
+
+#include <cstddef>
+#include <vector>
+#include "glm/glm.hpp"
+#include "vertex_layout.h"
+#include "transform_system.h"
+
+// Per-instance data of a cube, read by the INSTANCED variant of the light shaders (TRS instead of a full matrix:
+// 36 bytes instead of 64)
+struct CubeInstance
+{
+    glm::vec4 positionScale;    // translation, uniform scale
+    glm::vec4 rotation;         // quaternion (x, y, z, w)
+    float alpha;
+};
+
+// The spinning cubes: the ten hand-placed ones, then as many as asked scattered in front of the camera.
+// Every cube is animated from the frame time alone, so the per-draw and the instanced paths draw the same scene.
+class CubeField
+{
+public:
+    // uniform scale of every cube
+    static constexpr float SCALE = 0.5f;
+
+    explicit CubeField(size_t count);
+
+    size_t size() const { return positions.size(); }
+    const glm::vec3& position(size_t index) const { return positions[index]; }
+
+    // per-draw path; model() is the matrix one glm call at a time, the TransformSystem computes the same ones
+    glm::mat4 model(size_t index, float time) const;
+    float alpha(size_t index, float time) const;
+    // Ry * Rx * Rz of the spin as a quaternion (x, y, z, w)
+    glm::vec4 rotation(size_t index, float time) const;
+
+    // adds every cube to transforms, returns the index of the first; animate() sets their spin at time
+    size_t addTransforms(TransformSystem &transforms) const;
+    void animate(float time, TransformSystem &transforms, size_t first) const;
+
+    // instanced path: one cube's instance, or all size() of them
+    CubeInstance instance(size_t index, float time) const;
+    void instances(float time, CubeInstance *out) const;
+    // attributes 4 to 6 of the instance buffer, see lighting.vert
+    static const VertexLayout& instanceLayout();
+
+private:
+    std::vector<glm::vec3> positions;
+};
+
+#endif //OPENGL_CUBE_FIELD_H
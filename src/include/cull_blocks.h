@@ -0,0 +1,90 @@
+#ifndef OPENGL_CULL_BLOCKS_H
+#define OPENGL_CULL_BLOCKS_H
+
+#include <cmath>
+#include <cstddef>
+#include "glm/glm.hpp"
+#include "simd.h"
+
+// Bounds loaded a block of lanes at a time (see simd.h), with the frustum and sphere tests FrustumCuller and
+// MeshletCuller run on them. x, y, z... are one array per component, padded to a whole block.
+namespace simd {
+
+    // spheres from block i on, loaded once however many frustums they are tested against
+    template <typename L>
+    struct SphereBlock
+    {
+        typename L::V cx, cy, cz, minusRadius;
+
+        SphereBlock(const size_t i, const float *x, const float *y, const float *z, const float *radius)
+            : cx(L::load(x + i)), cy(L::load(y + i)), cz(L::load(z + i)),
+              minusRadius(L::sub(L::set(0.0f), L::load(radius + i))) {}
+
+        // outside when the center is further than the radius behind any plane
+        typename L::M outside(const glm::vec4 planes[6]) const
+        {
+            const auto distance = [&](const glm::vec4 &plane) {
+                return L::add(L::add(L::mul(cx, L::set(plane.x)), L::mul(cy, L::set(plane.y))),
+                              L::add(L::mul(cz, L::set(plane.z)), L::set(plane.w)));
+            };
+            typename L::M out = L::less(distance(planes[0]), minusRadius);
+            for (int plane = 1; plane < 6; plane++)
+                out = L::either(out, L::less(distance(planes[plane]), minusRadius));
+            return out;
+        }
+
+        // outside a sphere (center, radius), which is cheaper to know than the planes
+        typename L::M beyond(const glm::vec4 &sphere) const
+        {
+            const typename L::V dx = L::sub(cx, L::set(sphere.x)), dy = L::sub(cy, L::set(sphere.y)),
+                                dz = L::sub(cz, L::set(sphere.z));
+            const typename L::V reach = L::sub(L::set(sphere.w), minusRadius);
+            return L::less(L::mul(reach, reach), L::add(L::add(L::mul(dx, dx), L::mul(dy, dy)), L::mul(dz, dz)));
+        }
+    };
+
+    // boxes from block i on, the same way
+    template <typename L>
+    struct BoxBlock
+    {
+        typename L::V cx, cy, cz, hx, hy, hz;
+
+        BoxBlock(const size_t i, const float *x, const float *y, const float *z, const float *ex, const float *ey,
+                 const float *ez)
+            : cx(L::load(x + i)), cy(L::load(y + i)), cz(L::load(z + i)), hx(L::load(ex + i)), hy(L::load(ey + i)),
+              hz(L::load(ez + i)) {}
+
+        // outside when the box's corner furthest along a plane's normal is behind it: the center is further behind
+        // than the extent projected on the normal
+        typename L::M outside(const glm::vec4 planes[6]) const
+        {
+            const auto behind = [&](const glm::vec4 &plane) {
+                const typename L::V distance = L::add(L::add(L::mul(cx, L::set(plane.x)), L::mul(cy, L::set(plane.y))),
+                                                      L::add(L::mul(cz, L::set(plane.z)), L::set(plane.w)));
+                const typename L::V extent = L::add(L::add(L::mul(hx, L::set(std::abs(plane.x))),
+                                                           L::mul(hy, L::set(std::abs(plane.y)))),
+                                                    L::mul(hz, L::set(std::abs(plane.z))));
+                return L::less(L::add(distance, extent), L::set(0.0f));
+            };
+            typename L::M out = behind(planes[0]);
+            for (int plane = 1; plane < 6; plane++)
+                out = L::either(out, behind(planes[plane]));
+            return out;
+        }
+
+        // outside a sphere (center, radius): the nearest point of the box is further than the radius
+        typename L::M beyond(const glm::vec4 &sphere) const
+        {
+            const typename L::V zero = L::set(0.0f);
+            const auto gap = [&](const typename L::V center, const typename L::V half, const float at) {
+                const typename L::V offset = L::sub(center, L::set(at));
+                return L::max(L::sub(L::max(offset, L::sub(zero, offset)), half), zero);
+            };
+            const typename L::V gx = gap(cx, hx, sphere.x), gy = gap(cy, hy, sphere.y), gz = gap(cz, hz, sphere.z);
+            return L::less(L::set(sphere.w * sphere.w), L::add(L::add(L::mul(gx, gx), L::mul(gy, gy)), L::mul(gz, gz)));
+        }
+    };
+
+}
+
+#endif //OPENGL_CULL_BLOCKS_H
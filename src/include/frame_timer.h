@@ -0,0 +1,29 @@
+#ifndef OPENGL_FRAME_TIMER_H
+#define OPENGL_FRAME_TIMER_H
+
+#include <vector>
+
+// Frame-to-frame CPU time, with hitch detection: a frame is a spike when it takes more than twice the
+// running average and at least SPIKE_MARGIN_MS longer. Spikes in the first WATCH_SECONDS (shader and
+// pipeline warm-up territory) are logged as they happen, the rest are summed up by report().
+class FrameTimer
+{
+public:
+    static constexpr double SPIKE_MARGIN_MS = 4.0;
+    static constexpr double WATCH_SECONDS = 5.0;
+
+    // call once per frame with the current time (glfwGetTime)
+    void frame(double now);
+
+    void report() const;
+
+    unsigned int spikes = 0;
+
+private:
+    std::vector<float> frameMs;
+    double start = -1.0;
+    double last = 0.0;
+    double averageMs = 0.0;
+};
+
+#endif //OPENGL_FRAME_TIMER_H
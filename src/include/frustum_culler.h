@@ -0,0 +1,88 @@
+#ifndef OPENGL_FRUSTUM_CULLER_H
+#define OPENGL_FRUSTUM_CULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Objects tested and rejected over one frame
+struct FrustumCullStats
+{
+    size_t tested = 0;
+    size_t culled = 0;
+    double microseconds = 0.0;  // spent in the culls
+};
+
+// World-space bounding spheres and axis-aligned boxes, one array per component, tested against the frustum of
+// this frame's view a block at a time (8 with AVX, 4 with SSE2, one at a time elsewhere) into a compacted list of
+// the visible ones. Large sets are split over the worker threads of parallelFor. Spheres and boxes are two separate
+// sets, each indexed from 0 in the order added.
+// Several views (the camera, shadow cascades, probe faces...) are culled in one sweep instead of one pass each: a
+// block of bounds is loaded once and tested against every frustum, and each object gets a mask of the views it is in.
+// A sphere around each frustum is tested before its planes, so objects just past a frustum's corners, which the
+// planes alone let through, are dropped there.
+class FrustumCuller
+{
+public:
+    // views one cullSphereViews() / cullBoxViews() tests at once, a bit of the masks each
+    static constexpr size_t MAX_VIEWS = 32;
+
+    // this frame's frustum, from projection * view
+    void setView(const glm::mat4 &viewProj);
+    // this frame's frustums of the multi-view culls, from projection * view each; view i is bit i of the masks
+    void setViews(const glm::mat4 *viewProjs, size_t count);
+    size_t viewCount() const { return views; }
+
+    size_t addSphere(const glm::vec3 &center, float radius);
+    void setSphere(size_t index, const glm::vec3 &center, float radius);
+    size_t sphereCount() const { return spheres; }
+    size_t addBox(const glm::vec3 &min, const glm::vec3 &max);
+    void setBox(size_t index, const glm::vec3 &min, const glm::vec3 &max);
+    size_t boxCount() const { return boxes; }
+
+    // tests every sphere / box; returns the indices of those at least partly inside, ascending (valid until the
+    // next cull of the same kind)
+    const std::vector<uint32_t>& cullSpheres();
+    const std::vector<uint32_t>& cullBoxes();
+    // tests every sphere / box against every view set with setViews(); returns a mask per object, bit v set when it
+    // is at least partly inside view v (valid until the next cull of the same kind)
+    const std::vector<uint32_t>& cullSphereViews();
+    const std::vector<uint32_t>& cullBoxViews();
+
+    // the counts since the last endFrame()
+    const FrustumCullStats& stats() const { return current; }
+    void endFrame();
+    const FrustumCullStats& lastFrame() const { return previous; }
+
+private:
+    glm::vec4 planes[6] = {};
+    size_t views = 0;
+    std::vector<glm::vec4> viewPlanes;      // 6 per view
+    std::vector<glm::vec4> viewSpheres;     // around each view's frustum
+
+    // padded to a multiple of the block
+    size_t spheres = 0;
+    std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+    size_t boxes = 0;
+    std::vector<float> boxX, boxY, boxZ, extentX, extentY, extentZ;  // center, half extent
+
+    std::vector<uint32_t> visibleSpheres, visibleBoxes;
+    std::vector<uint32_t> sphereMasks, boxMasks;
+    std::vector<std::vector<uint32_t>> taskVisible;     // per parallelFor task
+    std::vector<size_t> taskCulled;
+
+    FrustumCullStats current, previous;
+
+    // runs cull(first, last, visible) over [0, count), in parallel when count is large, into visible
+    template <typename Cull>
+    void cullAll(size_t count, std::vector<uint32_t> &visible, const Cull &cull);
+    // runs cull(first, last, masks), which returns how many it found in no view, the same way into masks
+    template <typename Cull>
+    void cullViews(size_t count, std::vector<uint32_t> &masks, const Cull &cull);
+};
+
+// the planes of the frustum of viewProj (left, right, bottom, top, near, far), normalized, pointing inwards
+void frustumPlanes(const glm::mat4 &viewProj, glm::vec4 planes[6]);
+
+#endif //OPENGL_FRUSTUM_CULLER_H
@@ -0,0 +1,119 @@
+#ifndef OPENGL_HIZ_CULLER_H
+#define OPENGL_HIZ_CULLER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+#include "glm/glm.hpp"
+#include "mesh_registry.h"
+#include "shader_compiler.h"
+
+// Objects tested, hidden and drawn over one frame
+struct HizCullStats
+{
+    size_t objects = 0;
+    size_t frustumCulled = 0;
+    size_t occluded = 0;        // in the frustum, behind the depth phase 1 drew
+    size_t drawnFirst = 0;      // visible last frame, drawn before the test
+    size_t drawnSecond = 0;     // newly visible, drawn after it
+    size_t triangles = 0;
+};
+
+// Two-phase occlusion culling on the GPU, without reading anything back. Phase 1 draws the objects in the frustum
+// that were visible last frame; their depth is reduced to a hierarchical-Z pyramid (the farthest depth of each 2x2,
+// 4x4, ... block of pixels) by a single dispatch of src/shaders/cull/hiz_build.comp; phase 2 tests every object in the
+// frustum against the pyramid in src/shaders/cull/hiz_cull.comp, draws the newly visible ones and keeps which are
+// visible for the next frame. An object appearing is drawn the same frame, one disappearing a frame late.
+// Objects are CubeInstance TRS of a mesh with levels of detail: each phase writes the instances it keeps into the
+// draw of their level, so a phase is one multi-draw of a command per level whose instance count the shader counts.
+class HizCuller
+{
+public:
+    static constexpr char BUILD_PATH[] = "src/shaders/cull/hiz_build.comp";
+    static constexpr char CULL_PATH[] = "src/shaders/cull/hiz_cull.comp";
+    static constexpr int MAX_LEVELS = 8;
+
+    HizCuller(const MeshRegistry &registry, ShaderHandle buildProgram, ShaderHandle cullProgram);
+    HizCuller(const HizCuller&) = delete;
+    HizCuller& operator=(const HizCuller&) = delete;
+
+    bool ready() const { return buildProgram.ready() && cullProgram.ready(); }
+
+    // the meshes of the levels of detail, finest first, with their errors, and the bounding sphere's radius, both
+    // for an instance of scale 1
+    void setLevels(const std::vector<int> &meshes, const std::vector<float> &errors, float boundsRadius);
+    // the depth buffer phase 1 draws into (a GL_TEXTURE_2D of a depth format), width x height pixels; its filters
+    // are set to GL_NEAREST
+    void setDepth(unsigned int depthTexture, int width, int height);
+
+    // starts a frame: the count objects' CubeInstance TRS are at instanceOffset in instanceBuffer (a multiple of
+    // StreamingRingBuffer::storageAlignment()), in the same order every frame; pixelsPerUnit is at distance 1
+    void begin(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition, float pixelsPerUnit,
+               unsigned int instanceBuffer, GLintptr instanceOffset, size_t count);
+    // phase 1: the objects visible last frame
+    void cullFirst();
+    void drawFirst() const;
+    // phase 2, once drawFirst() is done: the pyramid from its depth, then every object
+    void cullSecond();
+    void drawSecond() const;
+
+    // the instances the draws read, CubeInstance; bind with Pipeline::setInstanceBuffer(instanceBuffer(), 0)
+    unsigned int instanceBuffer() const { return drawnBuffer; }
+
+    // the counts of the frame so far; waits for the GPU, so for reports only
+    HizCullStats readStats() const;
+
+    // deletes the buffers, while the context is still current
+    void release();
+
+private:
+    const MeshRegistry &registry;
+    ShaderHandle buildProgram, cullProgram;
+    std::vector<int> levels;
+    float levelErrors[MAX_LEVELS] = {};
+    int levelTriangles[MAX_LEVELS] = {};
+    float radius = 1.0f;
+
+    unsigned int depthTexture = 0;
+    glm::ivec2 depthSize{0};
+    glm::ivec2 pyramidSize{0};      // of level 0
+    int pyramidLevels = 0;
+
+    unsigned int pyramidBuffer = 0;
+    unsigned int buildBuffer = 0;
+    unsigned int visibilityBuffer = 0;
+    unsigned int drawBuffer = 0;
+    unsigned int drawnBuffer = 0;
+    unsigned int counterBuffer = 0;
+    size_t capacity = 0;            // objects the visibility and instance buffers have room for
+
+    unsigned int objects = 0;
+    GLintptr objectsOffset = 0;
+    size_t objectCount = 0;
+    glm::mat4 viewProj{1.0f};
+    glm::vec4 planes[6] = {};
+    glm::vec3 camera{0.0f};
+    float pixelsPerUnit = 1.0f;
+
+    // resolved once the programs are linked
+    struct
+    {
+        Uniform<int> hizWidth, hizHeight, hizLevelCount;
+    } build;
+    struct
+    {
+        Uniform<int> hizWidth, hizHeight, hizLevelCount;
+        Uniform<int> phase, objectCount, levelCount;
+        Uniform<glm::mat4> viewProj;
+        Uniform<glm::vec4> frustumPlanes;
+        Uniform<glm::vec3> cameraPosition;
+        Uniform<glm::vec2> viewport;
+        Uniform<float> boundsRadius, pixelsPerUnit, levelErrors;
+        Uniform<int> levelTriangles;
+    } cull;
+
+    void dispatchCull(int phase);
+    void drawPhase(int phase) const;
+};
+
+#endif //OPENGL_HIZ_CULLER_H
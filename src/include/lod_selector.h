@@ -0,0 +1,40 @@
+#ifndef OPENGL_LOD_SELECTOR_H
+#define OPENGL_LOD_SELECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Picks the level of detail of every object from how large its simplification error would look on screen: the
+// coarsest level whose error projects to at most threshold pixels. Each object remembers its level, and only moves
+// to a coarser one once that one's error is below (1 - hysteresis) of the threshold, so that objects near a switching
+// distance do not pop back and forth from frame to frame.
+class LodSelector
+{
+public:
+    explicit LodSelector(float thresholdPixels = 1.0f, float hysteresis = 0.25f);
+
+    // this frame's view: the camera position, its vertical field of view in degrees (Camera::Zoom) and the viewport
+    // height in pixels
+    void setView(const glm::vec3 &cameraPosition, float fovY, int viewportHeight);
+    // the pixels a world-space error covers at a distance from the camera
+    float projectedError(float worldError, float distance) const { return worldError * pixelsPerUnit / distance; }
+
+    // the level to draw object with: it is bounded by a sphere, and errors are the world-space errors of its levels
+    // (ascending, errors[0] is full detail)
+    unsigned int select(size_t object, const glm::vec3 &center, float radius, const float *errors, unsigned int levelCount);
+    unsigned int level(size_t object) const { return levels[object]; }
+
+    // the objects to remember levels for (new ones start at full detail)
+    void resize(size_t objectCount) { levels.resize(objectCount, 0); }
+
+private:
+    float threshold;
+    float hysteresis;
+    glm::vec3 camera{0.0f};
+    float pixelsPerUnit = 1.0f;     // at distance 1
+    std::vector<uint8_t> levels;
+};
+
+#endif //OPENGL_LOD_SELECTOR_H
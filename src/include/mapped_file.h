@@ -0,0 +1,26 @@
+#ifndef OPENGL_MAPPED_FILE_H
+#define OPENGL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read-only into memory: the page cache is read in place, nothing is copied up front
+class MappedFile
+{
+public:
+    // prints an error and stays empty if the file cannot be opened or mapped
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool valid() const { return bytes != nullptr; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+};
+
+#endif //OPENGL_MAPPED_FILE_H
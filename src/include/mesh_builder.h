@@ -0,0 +1,125 @@
+#ifndef OPENGL_MESH_BUILDER_H
+#define OPENGL_MESH_BUILDER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Meshlets are cut to what a mesh shader workgroup usually holds, small enough that their bounds are tight
+constexpr unsigned int MESHLET_MAX_VERTICES = 64;
+constexpr unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of neighbouring triangles, stored as a contiguous range of its mesh's indices, with the bounds culling
+// tests it against (model space, see buildMeshlets)
+struct Meshlet
+{
+    glm::vec3 center;       // bounding sphere
+    float radius;
+    glm::vec3 coneAxis;     // normal cone: the triangles all face away from a camera at p when
+    float coneCutoff;       // dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius (never when 1)
+    uint32_t firstIndex;    // relative to the mesh
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t padding;
+};
+
+// An indexed triangle mesh, ready to upload
+struct Mesh
+{
+    std::vector<unsigned char> vertices;    // vertexSize bytes per vertex
+    unsigned int vertexSize = 0;
+    std::vector<unsigned char> indices;     // uint16_t or uint32_t, see indexType
+    GLenum indexType = GL_UNSIGNED_INT;     // GL_UNSIGNED_SHORT when every index fits in 16 bits
+    unsigned int indexCount = 0;
+    glm::mat4 positionTransform{1.0f};     // maps stored positions to model space (quantized positions, see convertMesh)
+    std::vector<Meshlet> meshlets;          // covering every index in order, or empty when they were not built
+
+    size_t vertexCount() const { return vertexSize != 0 ? vertices.size() / vertexSize : 0; }
+};
+
+// The data of a mesh wherever it is stored (a Mesh, or a mapped .mesh file), without owning it
+struct MeshView
+{
+    const unsigned char *vertices = nullptr;
+    size_t vertexCount = 0;
+    unsigned int vertexSize = 0;
+    const unsigned char *indices = nullptr;
+    GLenum indexType = GL_UNSIGNED_INT;
+    unsigned int indexCount = 0;
+    glm::mat4 positionTransform{1.0f};
+    const Meshlet *meshlets = nullptr;
+    size_t meshletCount = 0;
+
+    MeshView() = default;
+    MeshView(const Mesh &mesh)
+        : vertices(mesh.vertices.data()), vertexCount(mesh.vertexCount()), vertexSize(mesh.vertexSize),
+          indices(mesh.indices.data()), indexType(mesh.indexType), indexCount(mesh.indexCount),
+          positionTransform(mesh.positionTransform), meshlets(mesh.meshlets.data()), meshletCount(mesh.meshlets.size()) {}
+};
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats
+{
+    float acmr;     // average cache miss ratio: vertices transformed per triangle (0.5 is ideal, 3 is no reuse)
+    float atvr;     // average transform to vertex ratio: vertices transformed per unique vertex (1 is ideal)
+};
+
+// Builds a Mesh from triangles:
+//  1. welds bit-identical vertices into a unique vertex buffer and an index buffer
+//  2. orders the triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+//  3. orders clusters of those triangles front to back from the mesh center, to cut overdraw
+//  4. groups the triangles into meshlets, for culling
+//  5. orders the vertices by first use, for vertex fetch locality
+// Positions (3 floats, at positionOffset in each vertex) are only read by the overdraw and meshlet passes.
+class MeshBuilder
+{
+public:
+    // FIFO size used for ACMR/ATVR; close to what current GPUs reuse per batch
+    static constexpr unsigned int CACHE_SIZE = 16;
+
+    explicit MeshBuilder(unsigned int vertexSize, unsigned int positionOffset = 0);
+
+    // a non-indexed triangle list, 3 vertices per triangle
+    void addTriangles(const void *vertices, size_t vertexCount);
+    // an indexed triangle list
+    void addIndexed(const void *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount);
+
+    // welds, optimizes and packs what was added; prints the vertex cache statistics before and after if label is set
+    Mesh build(const char *label = nullptr) const;
+
+private:
+    unsigned int vertexSize;
+    unsigned int positionOffset;
+    std::vector<unsigned char> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// stores indices into mesh (whose vertices are already set), as 16-bit indices when the vertex count allows
+void packIndices(Mesh &mesh, const std::vector<uint32_t> &indices);
+// the indices of mesh as 32-bit indices, whatever their width
+std::vector<uint32_t> unpackIndices(const Mesh &mesh);
+
+// Mesh optimization passes, used by MeshBuilder::build()
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount,
+                                    unsigned int cacheSize = MeshBuilder::CACHE_SIZE);
+// welds bit-identical vertices in place, rewriting the indices; returns the unique vertex count
+size_t weldVertices(std::vector<unsigned char> &vertices, unsigned int vertexSize, std::vector<uint32_t> &indices);
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount);
+// expects cache-optimized indices, and keeps most of their cache efficiency
+void optimizeOverdraw(std::vector<uint32_t> &indices, const unsigned char *vertices, size_t vertexCount,
+                      unsigned int vertexSize, unsigned int positionOffset);
+// reorders the vertices in place by first use in indices, rewriting the indices
+void optimizeVertexFetch(std::vector<unsigned char> &vertices, unsigned int vertexSize, std::vector<uint32_t> &indices);
+// Splits the triangles into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles,
+// reordering indices so that each one is a contiguous range. A meshlet grows from the first triangle left over the
+// triangles sharing the most vertices with it, nearest first, then over the next triangles in order, so the order
+// the earlier passes picked mostly survives. positions are the model space positions of the vertices.
+std::vector<Meshlet> buildMeshlets(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions);
+// the same for a mesh with float positions at positionOffset, in place
+void buildMeshlets(Mesh &mesh, unsigned int positionOffset);
+// the positions (3 floats at positionOffset) of the vertices of a mesh
+std::vector<glm::vec3> meshPositions(const Mesh &mesh, unsigned int positionOffset);
+
+#endif //OPENGL_MESH_BUILDER_H
@@ -0,0 +1,109 @@
+#ifndef OPENGL_MESH_FILE_H
+#define OPENGL_MESH_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "mesh_builder.h"
+#include "vertex_layout.h"
+
+// .mesh: a mesh cache in exactly the bytes the GL buffers take, written by meshc (src/tools/meshc.cpp) and loaded
+// by mapping the file. Little-endian, laid out as:
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]     the vertex layout
+//   MeshFileSubmesh[submeshCount]
+//   Meshlet[meshletCount]               every submesh's meshlets, one submesh after the other
+//   vertex blob (vertexCount * vertexSize bytes), at a multiple of MESH_FILE_ALIGNMENT
+//   index blob (indexCount indices of indexType), at a multiple of MESH_FILE_ALIGNMENT
+// Any change to this layout bumps MESH_FILE_VERSION; files of another version are rejected, and re-run through meshc.
+constexpr uint32_t MESH_FILE_VERSION = 3;  // 2: submesh levels of detail, 3: meshlets
+constexpr size_t MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileHeader
+{
+    char magic[4];              // "MESH"
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t attributeCount;
+    uint32_t vertexCount;
+    uint32_t indexType;         // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint32_t meshletCount;
+    uint32_t padding;
+    float boundsMin[3];         // model space, over every submesh
+    float boundsMax[3];
+    float positionTransform[16];    // column-major, see Mesh::positionTransform
+    uint64_t attributeOffset;   // byte offsets from the start of the file
+    uint64_t submeshOffset;
+    uint64_t meshletOffset;
+    uint64_t vertexOffset;
+    uint64_t vertexBytes;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+};
+static_assert(sizeof(MeshFileHeader) == 184, "MeshFileHeader is read straight from the file");
+
+struct MeshFileAttribute
+{
+    uint32_t semantic;          // VertexSemantic
+    uint32_t location;
+    uint32_t format;            // VertexFormat
+    uint32_t offset;            // checked against the offset VertexLayout assigns
+};
+static_assert(sizeof(MeshFileAttribute) == 16, "MeshFileAttribute is read straight from the file");
+
+// A part of the mesh drawn on its own, e.g. per material or per level of detail; its indices are relative to baseVertex
+struct MeshFileSubmesh
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t baseVertex;
+    uint32_t vertexCount;
+    uint32_t lod;               // 0 at full detail, else a simplified level of the nearest submesh before it at lod 0
+    float lodError;             // model units, see MeshLod::error
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;      // their firstIndex is relative to the submesh's
+    float boundsMin[3];         // model space
+    float boundsMax[3];
+};
+static_assert(sizeof(MeshFileSubmesh) == 56, "MeshFileSubmesh is read straight from the file");
+static_assert(sizeof(Meshlet) == 48, "Meshlet is read straight from the file");
+
+// Writes the parts of a mesh as its submeshes, one after the other: the parts' vertices use layout and they share
+// parts[0].positionTransform. submeshes[i] gives the lod, error and bounds of parts[i], its ranges (and its meshlets,
+// from parts[i].meshlets) are filled in; the header bounds are the union of theirs. Prints an error and returns false if the file cannot be written.
+bool writeMeshFile(const std::string &path, const std::vector<Mesh> &parts, const VertexLayout &layout,
+                   std::vector<MeshFileSubmesh> submeshes);
+
+// A .mesh file mapped into memory. Everything is read in place: the views point into the mapping, so the mesh
+// goes from the page cache to the GL (MeshRegistry::add) without being copied on the heap or parsed.
+class MeshFile
+{
+public:
+    // prints an error and stays invalid if the file cannot be mapped, or is not a well-formed .mesh of this version
+    explicit MeshFile(const std::string &path);
+
+    bool valid() const { return header != nullptr; }
+    const MeshFileHeader& info() const { return *header; }
+    const VertexLayout& layout() const { return vertexLayout; }
+    size_t submeshCount() const { return header->submeshCount; }
+    const MeshFileSubmesh& submesh(size_t index) const { return submeshes[index]; }
+
+    // how many levels of detail a submesh at lod 0 has, itself included: the submeshes after it with lod > 0
+    size_t lodCount(size_t submesh) const;
+
+    // one submesh, pointing into the mapping (valid while the MeshFile lives)
+    MeshView view(size_t submesh) const;
+
+private:
+    MappedFile file;
+    const MeshFileHeader *header = nullptr;
+    const MeshFileSubmesh *submeshes = nullptr;
+    const Meshlet *meshlets = nullptr;
+    VertexLayout vertexLayout;
+};
+
+#endif //OPENGL_MESH_FILE_H
@@ -0,0 +1,30 @@
+#ifndef OPENGL_MESH_IMPORTER_H
+#define OPENGL_MESH_IMPORTER_H
+
+#include <cstddef>
+#include <string>
+#include "mesh_builder.h"
+#include "vertex_layout.h"
+
+// A mesh read from a content file, in float formats (convertMesh it to a quantized layout)
+struct ImportedMesh
+{
+    Mesh mesh;
+    // FLOAT3 position at location 0, then FLOAT3 normal at 1 and FLOAT2 texcoord at 2 when the file has them
+    VertexLayout layout;
+};
+
+// Reads a Wavefront .obj or a binary glTF .glb (by extension) from a memory mapping of the file:
+//  - .obj is split at line boundaries into chunks that are parsed in parallel; each chunk welds its own
+//    position/texcoord/normal index triples, then the chunks' vertices are merged and their indices remapped
+//  - .glb accessors are read in place from the mapped binary chunk, straight into the interleaved vertices
+// Every primitive of a .glb goes into the one mesh, without the node transforms. threads limits the .obj
+// parsing threads (0: every worker). The indices are left in file order, MeshBuilder can optimize them.
+// Prints an error and returns false when the file cannot be read.
+bool importMesh(const std::string &path, ImportedMesh &out, unsigned int threads = 0);
+
+// the same, from memory
+bool importObj(const char *data, size_t size, ImportedMesh &out, unsigned int threads = 0);
+bool importGlb(const unsigned char *data, size_t size, ImportedMesh &out);
+
+#endif //OPENGL_MESH_IMPORTER_H
@@ -0,0 +1,109 @@
+#ifndef OPENGL_MESH_REGISTRY_H
+#define OPENGL_MESH_REGISTRY_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+#include "mesh_builder.h"
+#include "pipeline.h"
+#include "vertex_layout.h"
+
+// Where a mesh lives in the registry's shared buffers
+struct MeshRange
+{
+    unsigned int firstIndex;    // in indices, not bytes
+    unsigned int indexCount;
+    int baseVertex;             // added to every index of the mesh, so the mesh keeps its own 0-based indices
+    unsigned int vertexCount;
+    glm::mat4 positionTransform;
+    unsigned int firstMeshlet;  // in MeshRegistry::meshlets(), none when meshletCount is 0
+    unsigned int meshletCount;
+};
+
+// One draw of glMultiDrawElementsIndirect, as laid out in the indirect buffer
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// Every mesh of a vertex layout sub-allocated into one vertex buffer and one index buffer, so that meshes are
+// switched by offsets in the draw call instead of by rebinding buffers. The buffers are attached to the VAO of
+// a Pipeline declared with the same layout (bind()), and all draws of a pass go out in one call (IndirectDrawList).
+// Meshes are only ever added; the (immutable) buffers grow by doubling, into new buffers.
+class MeshRegistry
+{
+public:
+    // every mesh's indices are stored as indexType; 16-bit indices need each mesh to have at most 65536 vertices
+    explicit MeshRegistry(VertexLayout layout, GLenum indexType = GL_UNSIGNED_SHORT);
+    MeshRegistry(const MeshRegistry&) = delete;
+    MeshRegistry& operator=(const MeshRegistry&) = delete;
+
+    // uploads the mesh (its vertices must use the registry's layout); returns its id, or -1 if it does not fit.
+    // The vertices, and the indices when they already are indexType, go to the GL straight from where the view
+    // points (a mapped .mesh file is uploaded without a copy on the heap)
+    int add(const MeshView &mesh);
+    // sizes the buffers for that many more vertices and indices, so that adding known meshes never grows them
+    void reserve(size_t vertexCount, size_t indexCount);
+
+    size_t size() const { return ranges.size(); }
+    const MeshRange& range(int mesh) const { return ranges[(size_t)mesh]; }
+    // the meshlets of every mesh, kept on the CPU for culling; their firstIndex is relative to their mesh
+    const std::vector<Meshlet>& meshlets() const { return meshletTable; }
+    const VertexLayout& layout() const { return vertexLayout; }
+    GLenum indexType() const { return indexFormat; }
+
+    // attaches the shared buffers to the pipeline's VAO; call after pipeline.bind()
+    void bind(const Pipeline &pipeline) const;
+
+    // draw of the mesh for an indirect buffer; the instances read per-instance attributes from baseInstance on,
+    // which is how per-draw data is indexed (gl_DrawID needs GL 4.6 or ARB_shader_draw_parameters)
+    DrawElementsIndirectCommand command(int mesh, unsigned int instanceCount = 1, unsigned int baseInstance = 0) const;
+    // the same draw, issued on its own
+    void draw(int mesh, unsigned int instanceCount = 1, unsigned int baseInstance = 0) const;
+
+    // deletes the buffers, while the context is still current
+    void release();
+
+private:
+    VertexLayout vertexLayout;
+    GLenum indexFormat;
+    unsigned int indexSize;
+    std::vector<MeshRange> ranges;
+    std::vector<Meshlet> meshletTable;
+
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    size_t vertexCapacity = 0, vertexUsed = 0;  // in vertices
+    size_t indexCapacity = 0, indexUsed = 0;    // in indices
+};
+
+// The draws of one pass, built on the CPU every frame and submitted with a single glMultiDrawElementsIndirect
+class IndirectDrawList
+{
+public:
+    IndirectDrawList() = default;
+    IndirectDrawList(const IndirectDrawList&) = delete;
+    IndirectDrawList& operator=(const IndirectDrawList&) = delete;
+
+    void clear() { commands.clear(); }
+    void add(const DrawElementsIndirectCommand &command) { commands.push_back(command); }
+    size_t size() const { return commands.size(); }
+
+    // uploads the commands into the (orphaned) indirect buffer and draws them all; the pipeline and the
+    // registry's buffers must be bound
+    void submit(const MeshRegistry &registry);
+
+    // deletes the indirect buffer, while the context is still current
+    void release();
+
+private:
+    std::vector<DrawElementsIndirectCommand> commands;
+    unsigned int indirectBuffer = 0;
+    size_t capacity = 0;    // in commands
+};
+
+#endif //OPENGL_MESH_REGISTRY_H
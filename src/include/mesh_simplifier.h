@@ -0,0 +1,41 @@
+#ifndef OPENGL_MESH_SIMPLIFIER_H
+#define OPENGL_MESH_SIMPLIFIER_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "mesh_builder.h"
+
+// One level of detail of a mesh: a simplified index buffer over the vertices of the full-detail mesh
+struct MeshLod
+{
+    std::vector<uint32_t> indices;
+    float error;    // how far (in model units) the simplified surface may be from the full-detail one; 0 for LOD 0
+};
+
+// Simplifies an indexed triangle list towards targetIndexCount by quadric error metric edge collapse (Garland and
+// Heckbert). A collapse moves a vertex onto a neighbour, so no vertex is made up and the remaining ones keep their
+// attributes. Where two vertices share a position (a UV or normal seam) they only collapse along the seam, both sides
+// together, and vertices of open borders only along the border, so neither cracks; anything more tangled stays put.
+// Stops early before a collapse costing more than targetError (model units). Positions are 3 floats at
+// positionOffset. Returns the new indices; resultError gets the largest error of the collapses done.
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t> &indices, const unsigned char *vertices,
+                                   size_t vertexCount, unsigned int vertexSize, unsigned int positionOffset,
+                                   size_t targetIndexCount, float targetError = FLT_MAX, float *resultError = nullptr);
+
+// The LOD chain of a mesh with float positions at positionOffset: LOD 0 is the mesh itself, and each next level keeps
+// ratio of the triangles of the previous one, until maxLevels levels or until simplification stalls
+std::vector<MeshLod> generateLods(const Mesh &mesh, unsigned int positionOffset, unsigned int maxLevels = 6,
+                                  float ratio = 0.5f);
+// the LOD chains of several meshes, generated in parallel (one mesh per task)
+std::vector<std::vector<MeshLod>> generateLodChains(const std::vector<const Mesh*> &meshes, unsigned int positionOffset,
+                                                    unsigned int maxLevels = 6, float ratio = 0.5f);
+
+// A level of detail as a Mesh of its own: the vertices of mesh that the LOD uses (mesh may be in another layout than
+// the one the LOD was generated from, e.g. quantized, as long as the vertex order is the same), re-optimized for the
+// vertex cache and fetch and split into meshlets around positions (the model space positions of mesh's vertices).
+// Keeps mesh.positionTransform, so every level of a chain draws with the same transform.
+Mesh extractLod(const Mesh &mesh, const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions);
+
+#endif //OPENGL_MESH_SIMPLIFIER_H
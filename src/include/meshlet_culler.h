@@ -0,0 +1,125 @@
+#ifndef OPENGL_MESHLET_CULLER_H
+#define OPENGL_MESHLET_CULLER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "mesh_registry.h"
+#include "shader_compiler.h"
+#include "frustum_culler.h"
+
+// Meshlets tested and rejected over one frame
+struct MeshletCullStats
+{
+    size_t meshlets = 0;
+    size_t frustumCulled = 0;
+    size_t backfaceCulled = 0;  // inside the frustum, but every triangle faces away from the camera
+    size_t triangles = 0;       // of the meshlets tested
+    size_t trianglesCulled = 0;
+
+    size_t culled() const { return frustumCulled + backfaceCulled; }
+};
+
+// How much of an object the last MeshletCuller::cull() kept
+enum class MeshletCoverage { NONE, SOME, ALL };
+
+// Culls the meshlets of the registry's meshes on the CPU, a block of simd::Lanes at a time, against the
+// six frustum planes and their normal cones. Objects are rotated, translated and uniformly scaled copies of a mesh:
+// the planes and the camera are moved into the object's space once, so the bounds are tested as stored.
+class MeshletCuller
+{
+public:
+    explicit MeshletCuller(const MeshRegistry &registry);
+
+    // this frame's camera; the planes are extracted from viewProj
+    void setView(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition);
+
+    // tests the meshlets of mesh, drawn with model (from the space of the meshlet bounds to the world); a mesh
+    // without meshlets is always ALL
+    MeshletCoverage cull(int mesh, const glm::mat4 &model);
+    // the draws of the meshlets the last cull() kept, runs of consecutive ones merged, as instance baseInstance
+    void addVisible(IndirectDrawList &draws, unsigned int baseInstance) const;
+
+    // the counts since the last endFrame()
+    const MeshletCullStats& stats() const { return current; }
+    void endFrame();
+    const MeshletCullStats& lastFrame() const { return previous; }
+
+private:
+    const MeshRegistry &registry;
+    // the bounds of every meshlet of the registry, one array per component (padded by a block of lanes less one,
+    // so blocks never read past the end), refreshed when meshes were added
+    std::vector<float> centerX, centerY, centerZ, radius, axisX, axisY, axisZ, cutoff;
+    size_t synced = 0;
+
+    glm::vec4 planes[6] = {};
+    glm::vec3 camera{0.0f};
+
+    int culledMesh = -1;
+    std::vector<uint8_t> visible;   // per meshlet of culledMesh
+
+    MeshletCullStats current, previous;
+
+    void sync();
+};
+
+// The same tests in a compute shader (src/shaders/cull/meshlet_cull.comp), for every instance of a mesh at once:
+// one invocation per (instance, meshlet) appends the draw of a kept meshlet to an indirect buffer on the GPU, which
+// is drawn without the CPU reading anything back. With GL 4.6 the draw count comes from the GPU as well; before
+// that every slot is drawn, the unused ones as zero-instance draws.
+class GpuMeshletCuller
+{
+public:
+    static constexpr char PROGRAM_PATH[] = "src/shaders/cull/meshlet_cull.comp";
+
+    GpuMeshletCuller(const MeshRegistry &registry, ShaderHandle program);
+    GpuMeshletCuller(const GpuMeshletCuller&) = delete;
+    GpuMeshletCuller& operator=(const GpuMeshletCuller&) = delete;
+
+    bool ready() const { return program.ready(); }
+
+    // starts a frame: empties the draws and the counters, room for maxDraws (instance, meshlet) pairs
+    void begin(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition, size_t maxDraws);
+    // culls the meshlets of mesh for the count instances from baseInstance firstInstance on; the CubeInstance TRS
+    // of baseInstance 0 is at instanceOffset in instanceBuffer (a multiple of StreamingRingBuffer::storageAlignment()),
+    // and boundsTransform (rotation, translation, uniform scale) applies before the TRS
+    void cull(int mesh, unsigned int instanceBuffer, GLintptr instanceOffset, unsigned int firstInstance,
+              unsigned int count, const glm::mat4 &boundsTransform);
+    // draws what the culls kept; the pipeline and the registry's buffers must be bound
+    void draw() const;
+
+    // the counts of the frame so far; waits for the GPU, so for reports only
+    MeshletCullStats readStats() const;
+
+    // deletes the buffers, while the context is still current
+    void release();
+
+private:
+    const MeshRegistry &registry;
+    ShaderHandle program;
+    unsigned int meshletBuffer = 0;
+    unsigned int drawBuffer = 0;
+    unsigned int counterBuffer = 0;
+    size_t meshletsUploaded = 0;
+    size_t drawCapacity = 0;        // in draws
+    size_t maxDraws = 0;
+    size_t tested = 0, testedTriangles = 0;
+
+    glm::vec4 planes[6] = {};
+    glm::vec3 camera{0.0f};
+
+    // resolved once the program is linked
+    struct
+    {
+        Uniform<glm::vec4> frustumPlanes;
+        Uniform<glm::vec3> cameraPosition;
+        Uniform<glm::mat4> boundsTransform;
+        Uniform<float> boundsScale;
+        Uniform<int> firstMeshlet, meshletCount, instanceStride, instanceCount, firstInstance, firstIndex, baseVertex,
+                     maxDraws;
+    } uniforms;
+};
+
+#endif //OPENGL_MESHLET_CULLER_H
@@ -0,0 +1,97 @@
+#ifndef OPENGL_OCCLUSION_CULLER_H
+#define OPENGL_OCCLUSION_CULLER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "bvh.h"
+
+// Occluders drawn and objects tested and hidden over one frame
+struct OcclusionCullStats
+{
+    size_t occluders = 0;
+    size_t triangles = 0;               // of the occluders, facing the camera and in front of the near plane
+    size_t tested = 0;
+    size_t occluded = 0;
+    double rasterMicroseconds = 0.0;    // drawing the occluders and building the hierarchy
+    double testMicroseconds = 0.0;
+};
+
+// Software occlusion culling: each frame a few occluder meshes are drawn on the CPU into a small depth buffer, and
+// objects whose bounds are entirely behind what they cover are not drawn. The buffer holds 1 / w, which is linear
+// in screen space and larger nearer the camera; triangles are binned into tiles that the worker threads of
+// parallelFor fill a block of pixels at a time with SIMD edge functions. A hierarchy of the farthest depth in each
+// 2x2, 4x4, ... block lets a box be tested against a handful of values whatever its size on screen.
+// Occluders must lie inside the objects they stand for: triangles crossing the near plane or facing away are
+// dropped, and a pixel takes the farthest depth its triangle reaches within it. A pixel counts as covered when its
+// center is, so along an occluder's outline the buffer claims pixels that are only partly behind it; occluded()
+// grows the boxes it tests by half a pixel to make up for them.
+class OcclusionCuller
+{
+public:
+    static constexpr int WIDTH = 256;
+    static constexpr int HEIGHT = 128;
+    static constexpr int TILE_WIDTH = 32;
+    static constexpr int TILE_HEIGHT = 32;
+
+    // clears the depth buffer for this frame's view, from projection * view
+    void begin(const glm::mat4 &viewProj);
+    // counter-clockwise triangles of indices into positions, moved by model
+    void addOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                     const glm::mat4 &model);
+    // draws the occluders added since begin()
+    void rasterize();
+
+    // whether the box is entirely hidden behind the occluders
+    bool occluded(const Aabb &box) const;
+    // the candidates whose boxOf(candidate) is not hidden, in order (valid until the next cull)
+    template <typename BoxOf>
+    const std::vector<uint32_t>& cull(const std::vector<uint32_t> &candidates, const BoxOf &boxOf);
+
+    // the pixels, bottom row first
+    const float* depth() const { return levels[0].data(); }
+
+    // the counts since the last endFrame()
+    const OcclusionCullStats& stats() const { return current; }
+    void endFrame();
+    const OcclusionCullStats& lastFrame() const { return previous; }
+
+private:
+    // a triangle's edge functions and depth plane in pixels, and the pixels its bounds cover
+    struct Triangle
+    {
+        glm::vec3 edges[3];     // inside where x * edge.x + y * edge.y + edge.z >= 0
+        glm::vec3 depth;        // 1 / w = x * depth.x + y * depth.y + depth.z
+        int minX, minY, maxX, maxY;
+    };
+
+    glm::mat4 viewProj{1.0f};
+    std::vector<glm::vec4> clipPositions;       // of the occluder being added
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;    // triangles of each tile
+    std::vector<std::vector<float>> levels;     // the depth buffer, then each level halved
+
+    std::vector<uint32_t> visible;
+    OcclusionCullStats current, previous;
+
+    void rasterizeTile(int tile);
+};
+
+template <typename BoxOf>
+const std::vector<uint32_t>& OcclusionCuller::cull(const std::vector<uint32_t> &candidates, const BoxOf &boxOf)
+{
+    const auto start = std::chrono::steady_clock::now();
+    visible.clear();
+    for (const uint32_t candidate : candidates)
+        if (!occluded(boxOf(candidate)))
+            visible.push_back(candidate);
+
+    current.tested += candidates.size();
+    current.occluded += candidates.size() - visible.size();
+    current.testMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    return visible;
+}
+
+#endif //OPENGL_OCCLUSION_CULLER_H
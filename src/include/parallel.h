@@ -0,0 +1,16 @@
+#ifndef OPENGL_PARALLEL_H
+#define OPENGL_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+// Data-parallel loops on a pool of worker threads, started on first use (one per hardware thread, the calling
+// thread included). Loops are run one at a time; a parallelFor called from inside a task runs inline.
+
+// runs task(i) for every i in [0, count), spread over the pool and the calling thread; returns once all are done
+void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+// how many threads a parallelFor runs on, the calling thread included
+unsigned int workerCount();
+
+#endif //OPENGL_PARALLEL_H
@@ -0,0 +1,102 @@
+#ifndef OPENGL_PIPELINE_H
+#define OPENGL_PIPELINE_H
+
+#include <glad/glad.h>
+#include "shader.h"
+#include "shader_compiler.h"
+#include "vertex_layout.h"
+
+// Fixed-function state, compared member by member when switching pipelines
+struct DepthState
+{
+    bool test = true;
+    bool write = true;
+    GLenum func = GL_LESS;
+};
+struct BlendState
+{
+    bool enabled = false;
+    GLenum source = GL_SRC_ALPHA;
+    GLenum destination = GL_ONE_MINUS_SRC_ALPHA;
+};
+struct CullState
+{
+    bool enabled = false;
+    GLenum face = GL_BACK;
+};
+
+// Everything a draw depends on besides buffers, textures and uniforms
+struct PipelineDesc
+{
+    const char *label;
+    ShaderHandle program;
+    VertexLayout layout;
+    DepthState depth;
+    BlendState blend;
+    CullState cull;
+    // per-instance attributes (vertex buffer binding 1, advancing once per instance); empty for non-instanced draws
+    VertexLayout instanceLayout = {};
+};
+
+// An immutable pipeline state object, declared up front during loading: program, vertex layout (its own VAO)
+// and depth/blend/cull state. Binding it only touches the fixed-function state that differs from the
+// previously bound pipeline. Buffers are not part of it, bind them with setVertexBuffer()/setIndexBuffer()/
+// setInstanceBuffer() after bind().
+class Pipeline
+{
+public:
+    // fallback is drawn with until the program is linked (see ShaderHandle::getOr)
+    Pipeline(PipelineDesc desc, const Shader &fallback);
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    const PipelineDesc& desc() const { return description; }
+    // the program bind() uses right now
+    const Shader& program() const { return description.program.getOr(*fallback); }
+
+    void bind() const;
+    void setVertexBuffer(unsigned int buffer, GLintptr offset = 0) const;
+    void setIndexBuffer(unsigned int buffer) const;
+    void setInstanceBuffer(unsigned int buffer, GLintptr offset = 0) const;
+
+    // deletes the VAO, while the context is still current
+    void release();
+
+    // the GL state last set by a Pipeline is assumed to still be current; call this after touching
+    // depth/blend/cull state directly
+    static void invalidateState();
+
+private:
+    PipelineDesc description;
+    const Shader *fallback;
+    unsigned int VAO = 0;
+
+    friend class PipelineWarmup;
+    void bindWith(const Shader &shader) const;
+};
+
+// Drivers finish compiling a program for a given vertex layout and state combination only at the first draw
+// that uses them. The warm-up issues that first draw during loading instead of in the middle of a frame:
+// one degenerate triangle into a 1x1 offscreen target, for every declared pipeline.
+class PipelineWarmup
+{
+public:
+    // warms the pipeline with its program right away if it is linked, otherwise with the fallback now and
+    // with the program as soon as the ShaderCompiler resolves it (before the frame that first draws with it)
+    void add(const Pipeline &pipeline);
+
+    size_t warmed() const { return draws; }
+    // deletes the offscreen target, while the context is still current
+    void release();
+
+private:
+    unsigned int FBO = 0;
+    unsigned int colorTarget = 0;
+    unsigned int depthTarget = 0;
+    unsigned int vertexBuffer = 0;
+    size_t draws = 0;
+
+    void draw(const Pipeline &pipeline, const Shader &shader);
+};
+
+#endif //OPENGL_PIPELINE_H
@@ -0,0 +1,63 @@
+#ifndef OPENGL_PROGRAM_CACHE_H
+#define OPENGL_PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// 64-bit FNV-1a, used to key cached programs and shader stages
+inline uint64_t hashBytes(const void *data, const size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const auto *bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(const std::string_view text, const uint64_t hash = 14695981039346656037ull)
+{
+    return hashBytes(text.data(), text.size(), hash);
+}
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+// Entries are keyed on the preprocessed sources plus the GL_VENDOR, GL_RENDERER and GL_VERSION strings,
+// so a driver update invalidates them. A binary the driver rejects is deleted and the caller compiles from source.
+class ProgramCache
+{
+public:
+    // directory the binaries are written to, relative to the working directory
+    static constexpr char DIRECTORY[] = "shader_cache";
+
+    static ProgramCache& get();
+
+    uint64_t makeKey(std::initializer_list<std::string_view> sources);
+
+    // Loads a cached binary into program; returns false on a miss or when the driver rejects it
+    bool load(unsigned int program, uint64_t key);
+    // Saves a freshly linked program. It must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    void store(unsigned int program, uint64_t key, double compileMs);
+
+    // Prints hits/misses and the compile time the hits saved
+    void report() const;
+
+    bool enabled = true;
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int rejected = 0;
+    double loadMs = 0.0;        // time spent loading the hits
+    double savedMs = 0.0;       // blocking compile time the hits would have cost
+
+private:
+    ProgramCache() = default;
+
+    uint64_t driverHash = 0;
+
+    static std::string pathOf(uint64_t key);
+};
+
+#endif //OPENGL_PROGRAM_CACHE_H
@@ -2,23 +2,188 @@
 #define OPENGL_SHADER_H
 
 #include <glad/glad.h>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include "block_layout.h"
+
+// An active uniform of a linked program, as reported by the driver
+struct UniformInfo
+{
+    std::string name;   // without the "[0]" suffix for arrays
+    GLenum type;        // GL_FLOAT, GL_FLOAT_VEC3, GL_SAMPLER_2D...
+    int location;
+    int size;           // array size, 1 for non-array uniforms
+};
+
+// A member of a uniform or storage block, with its layout in the buffer
+struct BlockMemberInfo
+{
+    std::string name;   // without the block prefix and the "[0]" suffix
+    GLenum type;
+    int offset;
+    int arrayStride;    // 0 for non-arrays
+    int matrixStride;   // 0 for non-matrices
+    int size;           // array size, 0 for a runtime-sized array
+};
+
+// An active uniform block (UBO) or shader storage block (SSBO) of a linked program
+struct BlockInfo
+{
+    std::string name;
+    bool storage;
+    int binding;
+    int dataSize;
+    std::vector<BlockMemberInfo> members;
+};
+
+// Maps a C++ type to its GLSL uniform type and the glUniform* call that uploads it
+template<typename T>
+struct UniformTraits;
+
+template<> struct UniformTraits<bool> {
+    static constexpr GLenum type = GL_BOOL;
+    static void upload(const int location, const int count, const bool *value) {
+        for (int i = 0; i < count; i++)
+            glUniform1i(location + i, (int)value[i]);
+    }
+};
+template<> struct UniformTraits<int> {
+    static constexpr GLenum type = GL_INT;
+    static void upload(const int location, const int count, const int *value) { glUniform1iv(location, count, value); }
+};
+template<> struct UniformTraits<float> {
+    static constexpr GLenum type = GL_FLOAT;
+    static void upload(const int location, const int count, const float *value) { glUniform1fv(location, count, value); }
+};
+template<> struct UniformTraits<glm::vec2> {
+    static constexpr GLenum type = GL_FLOAT_VEC2;
+    static void upload(const int location, const int count, const glm::vec2 *value) { glUniform2fv(location, count, glm::value_ptr(*value)); }
+};
+template<> struct UniformTraits<glm::vec3> {
+    static constexpr GLenum type = GL_FLOAT_VEC3;
+    static void upload(const int location, const int count, const glm::vec3 *value) { glUniform3fv(location, count, glm::value_ptr(*value)); }
+};
+template<> struct UniformTraits<glm::vec4> {
+    static constexpr GLenum type = GL_FLOAT_VEC4;
+    static void upload(const int location, const int count, const glm::vec4 *value) { glUniform4fv(location, count, glm::value_ptr(*value)); }
+};
+template<> struct UniformTraits<glm::mat3> {
+    static constexpr GLenum type = GL_FLOAT_MAT3;
+    static void upload(const int location, const int count, const glm::mat3 *value) { glUniformMatrix3fv(location, count, GL_FALSE, glm::value_ptr(*value)); }
+};
+template<> struct UniformTraits<glm::mat4> {
+    static constexpr GLenum type = GL_FLOAT_MAT4;
+    static void upload(const int location, const int count, const glm::mat4 *value) { glUniformMatrix4fv(location, count, GL_FALSE, glm::value_ptr(*value)); }
+};
+
+// CPU-side copy of the last value uploaded to a uniform, shared by every handle to it
+struct UniformShadow
+{
+    bool known = false;                 // nothing was uploaded yet, the program holds its default value
+    std::vector<unsigned char> value;   // bytes of the last upload, as passed to set()
+};
+
+// glUniform* calls issued and skipped (value unchanged) by the uniform shadows.
+// The render loop calls endFrame() once per frame, lastFrame then holds that frame's counts.
+struct UniformUploadStats
+{
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+
+    struct Counts { unsigned int issued, elided; } lastFrame = {0, 0};
+
+    static UniformUploadStats& get() { static UniformUploadStats stats; return stats; }
+
+    void endFrame()
+    {
+        lastFrame = {issued, elided};
+        issued = elided = 0;
+    }
+};
+
+// A uniform location resolved once, through Shader::uniform<T>(name).
+// Setting it is a single glUniform* call on the currently bound program: no string work and no driver query.
+// The call is skipped when the value is bit for bit the one last uploaded, so set it only with its program bound.
+template<typename T>
+class Uniform
+{
+public:
+    int location = -1;
+
+    Uniform() = default;
+    explicit Uniform(const int location, UniformShadow *shadow = nullptr) : location(location), shadow(shadow) {}
+
+    bool valid() const { return location >= 0; }
+
+    void set(const T &value) const { set(&value, 1); }
+    void set(const T *values, const int count) const
+    {
+        if (location < 0)
+            return;
+
+        UniformUploadStats &stats = UniformUploadStats::get();
+        const size_t bytes = sizeof(T) * (size_t)count;
+        if (shadow != nullptr && shadow->known && shadow->value.size() == bytes
+            && std::memcmp(shadow->value.data(), values, bytes) == 0)
+        {
+            stats.elided++;
+            return;
+        }
+
+        UniformTraits<T>::upload(location, count, values);
+        stats.issued++;
+        if (shadow != nullptr)
+        {
+            const auto *first = reinterpret_cast<const unsigned char*>(values);
+            shadow->value.assign(first, first + bytes);
+            shadow->known = true;
+        }
+    }
+
+private:
+    UniformShadow *shadow = nullptr;
+};
 
 class Shader
 {
 public:
     // the program ID
     unsigned int ID;
-    // constructor reads and builds the shader
+    // constructor reads and builds the shader, blocking until it is linked
     Shader(const char* vertexPath, const char* fragmentPath);
+    // adopts an already linked program
+    explicit Shader(unsigned int program);
+    Shader() : ID(0) {}
+
+    // reads a shader source file, empty on failure: from the table embedded at build time,
+    // or from the disk when built with OPENGL_SHADERS_FROM_DISK
+    static std::string readSource(const char* path);
+    static bool sourceExists(const char* path);
+
     // use/activate the shader
     void use() const;
-    // utility uniform functions
+
+    // active uniforms reflected right after linking
+    const std::vector<UniformInfo>& uniforms() const { return uniformTable; }
+    const UniformInfo* findUniform(const std::string &name) const;
+    // resolves a typed uniform handle; setting an invalid handle (location -1) does nothing
+    template<typename T>
+    Uniform<T> uniform(const std::string &name) const;
+
+    // active uniform and storage blocks, with the std140/std430 layout the driver picked
+    const std::vector<BlockInfo>& blocks() const { return blockTable; }
+    const BlockInfo* findBlock(const std::string &name) const;
+    // checks a block against the layout blockgen computed for its C++ mirror; prints every mismatch
+    bool verifyBlock(const BlockLayout &layout) const;
+
+    // utility uniform functions, shadowed like the Uniform<T> handles
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
@@ -29,6 +194,57 @@ public:
     void setVec3(const std::string &name, const glm::vec3 &vec) const;
     void setVec4(const std::string &name, float x, float y, float z, float w) const;
     void setVec4(const std::string &name, const glm::vec4 &vec) const;
+
+private:
+    std::vector<UniformInfo> uniformTable;
+    std::vector<BlockInfo> blockTable;
+    // one shadow per entry of uniformTable, shared by the copies of this Shader
+    std::shared_ptr<std::vector<UniformShadow>> uniformShadows;
+
+    void reflectUniforms();
+    void reflectBlocks(bool storage);
+    // a handle on the uniform, without checking its type; invalid if the uniform is not active
+    template<typename T>
+    Uniform<T> handleOf(const UniformInfo *info) const;
 };
 
-#endif //OPENGL_SHADER_H
\ No newline at end of file
+// Samplers are set through int handles
+inline bool isSamplerType(const GLenum type)
+{
+    switch (type) {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_CUBE_MAP_ARRAY:
+        case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template<typename T>
+Uniform<T> Shader::uniform(const std::string &name) const
+{
+    // like glGetUniformLocation, an unknown or optimized-out uniform gives an invalid handle
+    const UniformInfo *info = findUniform(name);
+    if (info == nullptr)
+        return Uniform<T>();
+
+    const bool typeMatches = info->type == UniformTraits<T>::type
+                             || (UniformTraits<T>::type == GL_INT && isSamplerType(info->type));
+    if (!typeMatches) {
+        std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << std::endl;
+        return Uniform<T>();
+    }
+
+    return handleOf<T>(info);
+}
+
+template<typename T>
+Uniform<T> Shader::handleOf(const UniformInfo *info) const
+{
+    if (info == nullptr)
+        return Uniform<T>();
+    return Uniform<T>(info->location, &(*uniformShadows)[(size_t)(info - uniformTable.data())]);
+}
+
+#endif //OPENGL_SHADER_H
@@ -0,0 +1,127 @@
+#ifndef OPENGL_SHADER_COMPILER_H
+#define OPENGL_SHADER_COMPILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader.h"
+#include "shader_preprocessor.h"
+
+// State shared between a ShaderCompiler and the handles it gives out
+struct ShaderRequest
+{
+    enum Status { PENDING, READY, FAILED };
+
+    std::string label;
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::string computeCode;    // a compute program has only this stage
+    unsigned int vertex = 0;
+    unsigned int fragment = 0;
+    unsigned int compute = 0;
+    unsigned int program = 0;
+    uint64_t cacheKey = 0;
+    double blockingMs = 0.0;    // time submit and finish kept the caller waiting, not the wall time in between
+
+    Status status = PENDING;
+    Shader shader;
+    std::vector<std::function<void(const Shader&)>> callbacks;
+};
+
+// Future-like result of ShaderCompiler::submit
+class ShaderHandle
+{
+public:
+    ShaderHandle() = default;
+    explicit ShaderHandle(std::shared_ptr<ShaderRequest> request) : request(std::move(request)) {}
+
+    bool ready() const { return request && request->status == ShaderRequest::READY; }
+    bool failed() const { return request && request->status == ShaderRequest::FAILED; }
+    bool resolved() const { return request && request->status != ShaderRequest::PENDING; }
+
+    // the linked program; only meaningful once resolved()
+    const Shader& get() const { return request->shader; }
+    // the linked program, or fallback while it is still compiling (or if it failed)
+    const Shader& getOr(const Shader &fallback) const { return ready() ? request->shader : fallback; }
+
+    // runs callback once the program is linked, right away if it already is
+    void onReady(const std::function<void(const Shader&)> &callback) const;
+
+private:
+    std::shared_ptr<ShaderRequest> request;
+};
+
+// Batches shader compilation: every compile and link is submitted to the driver first, and the status
+// queries that would block are deferred to poll()/wait(). With GL_KHR_parallel_shader_compile the driver
+// compiles on its own threads and poll() never blocks; without it poll() resolves everything at once.
+class ShaderCompiler
+{
+public:
+    // loader is used for the extension entry point glad does not know about; nullptr disables it
+    explicit ShaderCompiler(GLADloadproc loader = nullptr);
+
+    // both stages go through the ShaderPreprocessor with the given defines
+    ShaderHandle submit(const char* vertexPath, const char* fragmentPath, const std::vector<ShaderDefine> &defines = {});
+    ShaderHandle submitSource(std::string vertexCode, std::string fragmentCode, std::string label);
+    // a compute program, cached and resolved like the others
+    ShaderHandle submitCompute(const char* computePath, const std::vector<ShaderDefine> &defines = {});
+
+    // resolves the requests the driver has finished, returns how many are still pending
+    size_t poll();
+    // blocks until every request is resolved
+    void wait();
+
+    // a minimal program (PerFrame block + model, flat color) to draw with while the real ones compile
+    const Shader& fallback();
+    static constexpr char FALLBACK_VERTEX_PATH[] = "src/shaders/fallback/fallback.vert";
+    static constexpr char FALLBACK_FRAGMENT_PATH[] = "src/shaders/fallback/fallback.frag";
+
+    // every program linked from now on is checked against these layouts (see blockgen);
+    // a program whose blocks do not match its C++ mirrors fails instead of reading garbage
+    void expectLayouts(std::vector<const BlockLayout*> layouts) { expectedLayouts = std::move(layouts); }
+
+    bool parallel() const { return parallelCompile; }
+    size_t pending() const { return requests.size(); }
+
+private:
+    bool parallelCompile = false;
+    std::vector<std::shared_ptr<ShaderRequest>> requests;
+    std::unique_ptr<Shader> fallbackShader;
+    std::vector<const BlockLayout*> expectedLayouts;
+
+    ShaderHandle submitRequest(std::shared_ptr<ShaderRequest> request);
+    void finish(ShaderRequest &request) const;
+    bool verifyLayouts(const ShaderRequest &request) const;
+    static void discard(ShaderRequest &request);
+};
+
+// The compile-time permutations of one vertex/fragment pair. Bit i of a permutation key defines features[i].
+// A variant is preprocessed and submitted only the first time it is asked for, and keys whose preprocessed
+// sources are identical (features the shader never uses) share one program.
+class ShaderVariants
+{
+public:
+    ShaderVariants(ShaderCompiler &compiler, std::string vertexPath, std::string fragmentPath,
+                   std::vector<std::string> features);
+
+    ShaderHandle variant(uint32_t key);
+
+    size_t variantCount() const { return byKey.size(); }
+    size_t programCount() const { return bySource.size(); }
+
+private:
+    ShaderCompiler &compiler;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> features;
+
+    std::unordered_map<uint32_t, ShaderHandle> byKey;
+    std::unordered_map<uint64_t, ShaderHandle> bySource;    // hash of the preprocessed pair
+};
+
+#endif //OPENGL_SHADER_COMPILER_H
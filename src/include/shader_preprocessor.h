@@ -0,0 +1,47 @@
+#ifndef OPENGL_SHADER_PREPROCESSOR_H
+#define OPENGL_SHADER_PREPROCESSOR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A #define injected in front of a shader source
+struct ShaderDefine
+{
+    std::string name;
+    std::string value = "1";
+};
+
+// Builds the defines for a permutation key: bit i of key set means features[i] is defined
+std::vector<ShaderDefine> permutationDefines(const std::vector<std::string> &features, uint32_t key);
+
+// CPU-side GLSL preprocessor run before the source reaches the driver:
+//  - expands #include "file" (relative to the including file, then to the shader root), honouring #pragma once
+//  - injects #define sets right after #version
+//  - resolves #if/#ifdef/#ifndef/#elif/#else/#endif and strips the dead branches, so each
+//    permutation compiles to straight-line code instead of branching on uniforms on the GPU
+//  - keeps the driver's line numbers true with #line <line> <file id>, the ids listed in a comment
+// Everything else (#define, #extension, #pragma...) is passed through to the driver untouched.
+class ShaderPreprocessor
+{
+public:
+    // include search root, relative to the working directory
+    static constexpr char SHADER_ROOT[] = "src/shaders";
+
+    // returns the preprocessed source; on failure (a file that cannot be read included) prints the error and
+    // returns an empty string
+    static std::string process(const std::string &path, const std::vector<ShaderDefine> &defines = {});
+
+private:
+    std::unordered_map<std::string, std::string> macros;
+    std::vector<std::string> onceFiles;
+    std::vector<std::string> files;     // by #line source id, in the order first met
+    std::string version;
+    std::string error;
+
+    bool processFile(const std::string &path, std::string &output, int depth);
+    bool evaluate(const std::string &expression, long long &result) const;
+};
+
+#endif //OPENGL_SHADER_PREPROCESSOR_H
@@ -0,0 +1,132 @@
+#ifndef OPENGL_SIMD_H
+#define OPENGL_SIMD_H
+
+#include <cmath>
+#include <cstddef>
+#include "glm/glm.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The vector operations the batched kernels are written with, one object per lane: simd::Lanes is AVX (8 lanes)
+// when the build enables it (the OPENGL_AVX option), SSE2 (4 lanes) on x86-64, one scalar lane elsewhere.
+// V holds WIDTH floats, M the result of a comparison.
+namespace simd {
+
+#if defined(__SSE2__)
+    struct Sse
+    {
+        static constexpr size_t WIDTH = 4;
+        static constexpr const char *NAME = "SSE2";
+        using V = __m128;
+        using M = __m128;
+
+        static V load(const float *p) { return _mm_loadu_ps(p); }
+        static void store(float *p, const V v) { _mm_storeu_ps(p, v); }
+        static V set(const float f) { return _mm_set1_ps(f); }
+        // 0, 1, 2, ... across the lanes
+        static V ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+        static V add(const V a, const V b) { return _mm_add_ps(a, b); }
+        static V sub(const V a, const V b) { return _mm_sub_ps(a, b); }
+        static V mul(const V a, const V b) { return _mm_mul_ps(a, b); }
+        static V max(const V a, const V b) { return _mm_max_ps(a, b); }
+        static V sqrt(const V a) { return _mm_sqrt_ps(a); }
+
+        static M less(const V a, const V b) { return _mm_cmplt_ps(a, b); }
+        static M lessEqual(const V a, const V b) { return _mm_cmple_ps(a, b); }
+        static M either(const M a, const M b) { return _mm_or_ps(a, b); }
+        // a in the lanes set in m, b in the others
+        static V select(const M m, const V a, const V b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+        // bit k set when lane k is
+        static unsigned int bits(const M m) { return (unsigned int)_mm_movemask_ps(m); }
+
+        // lane k of x, y, z, w into column of out[k]
+        static void storeColumn(glm::mat4 *out, const int column, V x, V y, V z, V w)
+        {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(&out[0][column][0], x);
+            _mm_storeu_ps(&out[1][column][0], y);
+            _mm_storeu_ps(&out[2][column][0], z);
+            _mm_storeu_ps(&out[3][column][0], w);
+        }
+    };
+#endif
+
+#if defined(__AVX__)
+    struct Avx
+    {
+        static constexpr size_t WIDTH = 8;
+        static constexpr const char *NAME = "AVX";
+        using V = __m256;
+        using M = __m256;
+
+        static V load(const float *p) { return _mm256_loadu_ps(p); }
+        static void store(float *p, const V v) { _mm256_storeu_ps(p, v); }
+        static V set(const float f) { return _mm256_set1_ps(f); }
+        static V ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+        static V add(const V a, const V b) { return _mm256_add_ps(a, b); }
+        static V sub(const V a, const V b) { return _mm256_sub_ps(a, b); }
+        static V mul(const V a, const V b) { return _mm256_mul_ps(a, b); }
+        static V max(const V a, const V b) { return _mm256_max_ps(a, b); }
+        static V sqrt(const V a) { return _mm256_sqrt_ps(a); }
+
+        static M less(const V a, const V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static M lessEqual(const V a, const V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static M either(const M a, const M b) { return _mm256_or_ps(a, b); }
+        static V select(const M m, const V a, const V b) { return _mm256_blendv_ps(b, a, m); }
+        static unsigned int bits(const M m) { return (unsigned int)_mm256_movemask_ps(m); }
+
+        // the two halves as 4 matrices each
+        static void storeColumn(glm::mat4 *out, const int column, const V x, const V y, const V z, const V w)
+        {
+            Sse::storeColumn(out, column, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+                             _mm256_castps256_ps128(z), _mm256_castps256_ps128(w));
+            Sse::storeColumn(out + 4, column, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+                             _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1));
+        }
+    };
+#endif
+
+    struct Scalar
+    {
+        static constexpr size_t WIDTH = 1;
+        static constexpr const char *NAME = "scalar";
+        using V = float;
+        using M = bool;
+
+        static V load(const float *p) { return *p; }
+        static void store(float *p, const V v) { *p = v; }
+        static V set(const float f) { return f; }
+        static V ramp() { return 0.0f; }
+        static V add(const V a, const V b) { return a + b; }
+        static V sub(const V a, const V b) { return a - b; }
+        static V mul(const V a, const V b) { return a * b; }
+        static V max(const V a, const V b) { return a > b ? a : b; }
+        static V sqrt(const V a) { return std::sqrt(a); }
+
+        static M less(const V a, const V b) { return a < b; }
+        static M lessEqual(const V a, const V b) { return a <= b; }
+        static M either(const M a, const M b) { return a || b; }
+        static V select(const M m, const V a, const V b) { return m ? a : b; }
+        static unsigned int bits(const M m) { return m ? 1u : 0u; }
+
+        static void storeColumn(glm::mat4 *out, const int column, const V x, const V y, const V z, const V w)
+        {
+            (*out)[column] = glm::vec4(x, y, z, w);
+        }
+    };
+
+#if defined(__AVX__)
+    using Lanes = Avx;
+#elif defined(__SSE2__)
+    using Lanes = Sse;
+#else
+    using Lanes = Scalar;
+#endif
+
+}
+
+#endif //OPENGL_SIMD_H
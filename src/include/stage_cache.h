@@ -0,0 +1,46 @@
+#ifndef OPENGL_STAGE_CACHE_H
+#define OPENGL_STAGE_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Shader stage objects shared between programs, keyed on the hash of their (preprocessed) source.
+// Each unique stage is compiled once; programs link the cached objects, so N vertex and M fragment
+// variants cost N + M compiles instead of N × M.
+class StageCache
+{
+public:
+    static StageCache& get();
+
+    // returns the shader object for source, submitting its compile only the first time it is seen
+    unsigned int acquire(GLenum type, const std::string &source, const std::string &label);
+    // compile status of a stage returned by acquire(); blocks, and logs a failure only once
+    bool check(unsigned int stage);
+
+    // deletes every cached stage object; linked programs keep working
+    void clear();
+
+    void report() const;
+
+    unsigned int compiles = 0;
+    unsigned int reuses = 0;
+
+private:
+    struct Stage
+    {
+        unsigned int shader;
+        GLenum type;
+        std::string label;
+        bool checked;
+        bool compiled;
+    };
+
+    StageCache() = default;
+
+    std::unordered_map<uint64_t, Stage> stages;     // by source hash
+    std::unordered_map<unsigned int, uint64_t> keys;  // shader object -> source hash
+};
+
+#endif //OPENGL_STAGE_CACHE_H
@@ -0,0 +1,71 @@
+#ifndef OPENGL_STREAMING_RING_BUFFER_H
+#define OPENGL_STREAMING_RING_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// A slice of the ring for the current frame: write through data, point the GPU at offset in buffer()
+struct RingAllocation
+{
+    void *data = nullptr;   // nullptr when the frame region is full
+    GLintptr offset = 0;    // from the start of the buffer
+    GLsizeiptr size = 0;
+};
+
+// Time the CPU spent waiting for the GPU to release a frame region; steady waits mean too few regions
+struct RingWaitStats
+{
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    double lastFrameMs = 0.0;
+    unsigned int waits = 0;     // frames that had to wait at all
+    unsigned int frames = 0;
+};
+
+// Per-frame dynamic data (uniform blocks, shader storage, per-instance vertices), written by the CPU straight
+// into one persistently mapped, coherent buffer. The buffer is split into frameCount regions used in turn; a
+// fence after each frame's draws guards its region, so beginFrame() only blocks when the GPU is still reading
+// the region from frameCount frames ago. Nothing is allocated, mapped or orphaned while rendering.
+class StreamingRingBuffer
+{
+public:
+    // frameSize is rounded up to a multiple of the uniform and storage offset alignments
+    StreamingRingBuffer(size_t frameSize, unsigned int frameCount = 3);
+    StreamingRingBuffer(const StreamingRingBuffer&) = delete;
+    StreamingRingBuffer& operator=(const StreamingRingBuffer&) = delete;
+
+    // moves to the next region, waiting for its fence if needed, and empties it
+    void beginFrame();
+    // fences the region after the frame's last draw that reads it
+    void endFrame();
+
+    // bump-allocates size bytes of the current region at a multiple of alignment (a power of two)
+    RingAllocation allocate(size_t size, size_t alignment = 16);
+    // copies data into a new allocation
+    RingAllocation write(const void *data, size_t size, size_t alignment = 16);
+
+    // the offset alignment glBindBufferRange needs for each target
+    static size_t uniformAlignment();
+    static size_t storageAlignment();
+
+    unsigned int buffer() const { return ringBuffer; }
+    size_t frameSize() const { return regionSize; }
+    const RingWaitStats& waitStats() const { return stats; }
+    void report() const;
+
+    // unmaps and deletes the buffer, while the context is still current
+    void release();
+
+private:
+    unsigned int ringBuffer = 0;
+    unsigned char *mapped = nullptr;
+    size_t regionSize;
+    std::vector<GLsync> fences;     // one per region, 0 when the region is free
+    unsigned int region = 0;
+    size_t used = 0;
+    bool overflowReported = false;
+    RingWaitStats stats;
+};
+
+#endif //OPENGL_STREAMING_RING_BUFFER_H
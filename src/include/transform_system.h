@@ -0,0 +1,54 @@
+#ifndef OPENGL_TRANSFORM_SYSTEM_H
+#define OPENGL_TRANSFORM_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "simd.h"
+
+// The position, rotation and uniform scale of many entities, one array per component, and their world matrices
+// (translate * rotate * scale). update() recomputes the matrices of the entities changed since the last update, a
+// block of transforms per iteration (8 with AVX, 4 with SSE2, one at a time elsewhere), on the worker threads of
+// parallelFor when there are many; blocks where nothing changed are skipped. Setting a component to the value it
+// already has is not a change.
+class TransformSystem
+{
+public:
+    // transforms per iteration of the kernel, and its instruction set
+    static constexpr size_t BLOCK = simd::Lanes::WIDTH;
+    static const char* kernel() { return simd::Lanes::NAME; }
+
+    // adds an entity, changed until the next update; returns its index
+    size_t add(const glm::vec3 &position, const glm::vec4 &rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), float scale = 1.0f);
+    size_t size() const { return count; }
+
+    // rotation is a unit quaternion (x, y, z, w)
+    void setPosition(size_t index, const glm::vec3 &position);
+    void setRotation(size_t index, const glm::vec4 &rotation);
+    void setScale(size_t index, float scale);
+
+    glm::vec3 position(size_t index) const { return {positionX[index], positionY[index], positionZ[index]}; }
+    glm::vec4 rotation(size_t index) const { return {rotationX[index], rotationY[index], rotationZ[index], rotationW[index]}; }
+    float scale(size_t index) const { return scales[index]; }
+
+    // recomputes the world matrices of the changed entities; returns how many there were
+    size_t update();
+    // as of the last update()
+    const glm::mat4& world(size_t index) const { return worlds[index]; }
+    const glm::mat4* worldData() const { return worlds.data(); }
+
+private:
+    size_t count = 0;
+    // padded to a multiple of BLOCK, the padding an identity
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scales;
+    std::vector<uint8_t> changed;
+    std::vector<glm::mat4> worlds;
+
+    // the matrices of blocks [first, last), returns the entities changed among them
+    size_t updateBlocks(size_t first, size_t last);
+};
+
+#endif //OPENGL_TRANSFORM_SYSTEM_H
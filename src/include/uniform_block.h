@@ -0,0 +1,44 @@
+#ifndef OPENGL_UNIFORM_BLOCK_H
+#define OPENGL_UNIFORM_BLOCK_H
+
+#include <glad/glad.h>
+#include <cstring>
+
+// The uniform buffer behind one block of the generated shader_blocks.h. It is bound once to Block::BINDING,
+// the binding every shader declares for that block, and written whole with a single memcpy.
+template<typename Block>
+class UniformBlockBuffer
+{
+public:
+    UniformBlockBuffer()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        glBindBufferBase(GL_UNIFORM_BUFFER, Block::BINDING, UBO);
+    }
+
+    // invalidating the whole range orphans the previous contents, so the write never waits on the GPU
+    void write(const Block &data) const
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        void *mapped = glMapBufferRange(GL_UNIFORM_BUFFER, 0, sizeof(Block), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        std::memcpy(mapped, &data, sizeof(Block));
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // deletes the buffer, while the context is still current
+    void release()
+    {
+        glDeleteBuffers(1, &UBO);
+        UBO = 0;
+    }
+
+private:
+    unsigned int UBO = 0;
+};
+
+#endif //OPENGL_UNIFORM_BLOCK_H
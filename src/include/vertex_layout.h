@@ -0,0 +1,73 @@
+#ifndef OPENGL_VERTEX_LAYOUT_H
+#define OPENGL_VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+#include <initializer_list>
+#include <vector>
+#include "mesh_builder.h"
+
+// What an attribute holds; layouts are converted into one another attribute by attribute, by semantic
+// (INSTANCE attributes are per-instance data, never converted)
+enum class VertexSemantic { POSITION, NORMAL, TANGENT, TEXCOORD, INSTANCE };
+
+// How an attribute is stored in the vertex buffer
+enum class VertexFormat
+{
+    FLOAT,
+    FLOAT2,
+    FLOAT3,
+    FLOAT4,
+    HALF2,              // texture coordinates outside [0, 1]
+    UNORM16_2,          // texture coordinates in [0, 1]
+    SNORM16_4,          // positions relative to the mesh bounds, see Mesh::positionTransform (w is 1)
+    OCT_10_10_10_2,     // unit vectors octahedral-encoded in x/y (decode with octDecode in vertex_decode.glsl),
+                        // w is the tangent handedness
+};
+
+struct VertexFormatInfo
+{
+    int components;
+    GLenum type;
+    bool normalized;
+    unsigned int size;  // bytes
+};
+const VertexFormatInfo& vertexFormatInfo(VertexFormat format);
+
+// An attribute read from the (single, interleaved) vertex buffer of a layout
+struct VertexAttribute
+{
+    VertexSemantic semantic;
+    unsigned int location;  // layout (location = N) in the vertex shader
+    VertexFormat format;
+    unsigned int offset = 0;    // assigned by VertexLayout
+};
+
+// How the vertices of a buffer are laid out, declared once and turned into VAO setup by setup()
+class VertexLayout
+{
+public:
+    VertexLayout() = default;
+    // attributes are packed in order, each one 4-byte aligned
+    VertexLayout(std::initializer_list<VertexAttribute> attributes);
+    explicit VertexLayout(std::vector<VertexAttribute> attributes);
+
+    const std::vector<VertexAttribute>& attributes() const { return attributeList; }
+    unsigned int stride() const { return vertexStride; }
+    const VertexAttribute* find(VertexSemantic semantic) const;
+    // the same attributes (semantic, location, format) in the same order
+    bool operator==(const VertexLayout &other) const;
+    bool operator!=(const VertexLayout &other) const { return !(*this == other); }
+
+    // records the attribute formats in the bound VAO, all read from the given vertex buffer binding
+    void setup(unsigned int binding = 0) const;
+
+private:
+    std::vector<VertexAttribute> attributeList;
+    unsigned int vertexStride = 0;
+};
+
+// Re-encodes the vertices of mesh from one layout to another, matching attributes by semantic; from must only use
+// float formats. Quantized positions are stored relative to the mesh bounds, and mesh.positionTransform maps them back.
+Mesh convertMesh(const Mesh &mesh, const VertexLayout &from, const VertexLayout &to);
+
+#endif //OPENGL_VERTEX_LAYOUT_H
@@ -0,0 +1,408 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // bins of the surface area heuristic along a node's widest axis
+    constexpr int BINS = 16;
+    // an object's loose box is this much of its half size larger on every side
+    constexpr float LOOSENESS = 0.2f;
+    // refits since the last check, in objects, before rebuildIfDegraded() measures the cost again
+    constexpr size_t CHECK_FRACTION = 8;
+    // the cost growth over the built tree's that rebuilds it
+    constexpr float REBUILD_COST = 1.3f;
+
+    Aabb loosen(const Aabb &box)
+    {
+        const glm::vec3 margin = box.extent() * LOOSENESS;
+        return {box.min - margin, box.max + margin};
+    }
+
+    // the plane's signed distance to the box's center, and the box's extent along the plane's normal
+    void planeDistance(const glm::vec4 &plane, const Aabb &box, float &distance, float &radius)
+    {
+        distance = glm::dot(glm::vec3(plane), box.center()) + plane.w;
+        radius = glm::dot(glm::abs(glm::vec3(plane)), box.extent());
+    }
+
+    // the distance along the ray the box is entered at (0 from inside), FLT_MAX if it misses within limit
+    float rayEntry(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &inverseDirection, const float limit)
+    {
+        const glm::vec3 t1 = (box.min - origin) * inverseDirection, t2 = (box.max - origin) * inverseDirection;
+        const glm::vec3 near = glm::min(t1, t2), far = glm::max(t1, t2);
+        const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        const float exit = std::min(std::min(far.x, far.y), far.z);
+        return entry <= exit && entry < limit ? entry : FLT_MAX;
+    }
+
+    bool sphereOverlaps(const Aabb &box, const glm::vec3 &center, const float radius)
+    {
+        const glm::vec3 outside = glm::max(glm::max(box.min - center, center - box.max), glm::vec3(0.0f));
+        return glm::dot(outside, outside) <= radius * radius;
+    }
+}
+
+Aabb transformBox(const Aabb &box, const glm::mat4 &transform)
+{
+    // the extent along each world axis is the sum of the rotated and scaled extents' lengths on it
+    const glm::vec3 center = glm::vec3(transform * glm::vec4(box.center(), 1.0f));
+    const glm::vec3 extent = box.extent();
+    const glm::vec3 worldExtent = glm::abs(glm::vec3(transform[0])) * extent.x + glm::abs(glm::vec3(transform[1])) * extent.y
+                                  + glm::abs(glm::vec3(transform[2])) * extent.z;
+    return {center - worldExtent, center + worldExtent};
+}
+
+void Bvh::build(const std::vector<Aabb> &objectBoxes)
+{
+    boxes = objectBoxes;
+    const uint32_t count = (uint32_t)boxes.size();
+    looseBoxes.resize(count);
+    std::vector<glm::vec3> centers(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        looseBoxes[i] = loosen(boxes[i]);
+        centers[i] = boxes[i].center();
+    }
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    leaves.assign(count, NONE);
+    nodes.clear();
+    parents.clear();
+    refitCount = movedSinceCheck = 0;
+    builtCost = 0.0f;
+    if (count == 0)
+        return;
+
+    struct Range
+    {
+        uint32_t node, first, count;
+    };
+    std::vector<Range> ranges = {{0, 0, count}};
+    nodes.push_back({Aabb::empty(), 0, 0});
+    parents.push_back(NONE);
+    while (!ranges.empty())
+    {
+        const Range range = ranges.back();
+        ranges.pop_back();
+        uint32_t *objects = order.data() + range.first;
+
+        Aabb bounds = Aabb::empty(), centerBounds = Aabb::empty();
+        for (uint32_t i = 0; i < range.count; i++)
+        {
+            bounds.merge(looseBoxes[objects[i]]);
+            centerBounds.merge({centers[objects[i]], centers[objects[i]]});
+        }
+        nodes[range.node].bounds = bounds;
+
+        const glm::vec3 span = centerBounds.max - centerBounds.min;
+        const int axis = span.x >= span.y && span.x >= span.z ? 0 : span.y >= span.z ? 1 : 2;
+        uint32_t split = 0;
+        if (range.count > 1 && span[axis] > 0.0f)
+        {
+            // the binned surface area heuristic: the split between bins with the fewest objects times area
+            struct Bin
+            {
+                Aabb bounds = Aabb::empty();
+                uint32_t count = 0;
+            } bins[BINS];
+            const float scale = (float)BINS / span[axis];
+            const auto binOf = [&](const uint32_t object) {
+                return std::min(BINS - 1, (int)((centers[object][axis] - centerBounds.min[axis]) * scale));
+            };
+            for (uint32_t i = 0; i < range.count; i++)
+            {
+                Bin &bin = bins[binOf(objects[i])];
+                bin.bounds.merge(looseBoxes[objects[i]]);
+                bin.count++;
+            }
+            float rightCost[BINS];
+            Aabb right = Aabb::empty();
+            uint32_t rightCount = 0;
+            for (int bin = BINS - 1; bin > 0; bin--)
+            {
+                right.merge(bins[bin].bounds);
+                rightCount += bins[bin].count;
+                rightCost[bin] = rightCount > 0 ? right.area() * (float)rightCount : 0.0f;
+            }
+            Aabb left = Aabb::empty();
+            uint32_t leftCount = 0;
+            float bestCost = FLT_MAX;
+            int bestBin = 0;
+            for (int bin = 0; bin < BINS - 1; bin++)
+            {
+                left.merge(bins[bin].bounds);
+                leftCount += bins[bin].count;
+                const float cost = (leftCount > 0 ? left.area() * (float)leftCount : 0.0f) + rightCost[bin + 1];
+                if (leftCount > 0 && leftCount < range.count && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestBin = bin;
+                }
+            }
+            // a leaf when it is small and splitting (the two children's boxes to test on the way down) costs more
+            const bool leaf = range.count <= MAX_LEAF && bounds.area() * (float)range.count <= 2.0f * bounds.area() + bestCost;
+            if (!leaf && bestCost < FLT_MAX)
+                split = (uint32_t)(std::partition(objects, objects + range.count,
+                                                  [&](const uint32_t object) { return binOf(object) <= bestBin; })
+                                   - objects);
+        }
+        if (split == 0 && range.count > MAX_LEAF)
+        {
+            // every center in one place (or one bin): halves
+            split = range.count / 2;
+            std::nth_element(objects, objects + split, objects + range.count, [&](const uint32_t a, const uint32_t b) {
+                return centers[a][axis] < centers[b][axis];
+            });
+        }
+
+        if (split == 0)
+        {
+            nodes[range.node].first = range.first;
+            nodes[range.node].count = range.count;
+            for (uint32_t i = 0; i < range.count; i++)
+                leaves[objects[i]] = range.node;
+            continue;
+        }
+        const uint32_t children = (uint32_t)nodes.size();
+        nodes[range.node].first = children;
+        nodes[range.node].count = 0;
+        nodes.push_back({Aabb::empty(), 0, 0});
+        nodes.push_back({Aabb::empty(), 0, 0});
+        parents.push_back(range.node);
+        parents.push_back(range.node);
+        ranges.push_back({children, range.first, split});
+        ranges.push_back({children + 1, range.first + split, range.count - split});
+    }
+
+    // the inner nodes' bounds were taken from their objects, which is what their children's add up to
+    builtCost = cost();
+}
+
+void Bvh::update(const uint32_t object, const Aabb &box)
+{
+    boxes[object] = box;
+    if (looseBoxes[object].contains(box))
+        return;
+
+    looseBoxes[object] = loosen(box);
+    refitCount++;
+    movedSinceCheck++;
+    for (uint32_t node = leaves[object]; node != NONE; node = parents[node])
+    {
+        Node &current = nodes[node];
+        Aabb bounds = Aabb::empty();
+        if (current.count > 0)
+            for (uint32_t i = 0; i < current.count; i++)
+                bounds.merge(looseBoxes[order[current.first + i]]);
+        else
+        {
+            bounds = nodes[current.first].bounds;
+            bounds.merge(nodes[current.first + 1].bounds);
+        }
+        // the ancestors only change if this node did
+        if (bounds.min == current.bounds.min && bounds.max == current.bounds.max)
+            break;
+        current.bounds = bounds;
+    }
+}
+
+bool Bvh::rebuildIfDegraded()
+{
+    if (movedSinceCheck * CHECK_FRACTION < boxes.size() || boxes.empty())
+        return false;
+    movedSinceCheck = 0;
+    if (cost() <= builtCost * REBUILD_COST)
+        return false;
+    const std::vector<Aabb> current = boxes;
+    build(current);
+    return true;
+}
+
+float Bvh::cost() const
+{
+    if (nodes.empty())
+        return 0.0f;
+    float total = 0.0f;
+    for (const Node &node : nodes)
+        total += node.bounds.area() * (node.count > 0 ? (float)node.count : 1.0f);
+    return total / std::max(nodes[0].bounds.area(), FLT_MIN);
+}
+
+void Bvh::collect(const uint32_t node, std::vector<uint32_t> &out) const
+{
+    thread_local std::vector<uint32_t> stack;
+    stack.assign(1, node);
+    while (!stack.empty())
+    {
+        const Node &current = nodes[stack.back()];
+        stack.pop_back();
+        if (current.count > 0)
+            out.insert(out.end(), order.begin() + current.first, order.begin() + current.first + current.count);
+        else
+        {
+            stack.push_back(current.first);
+            stack.push_back(current.first + 1);
+        }
+    }
+}
+
+void Bvh::queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t> &out) const
+{
+    if (nodes.empty())
+        return;
+
+    // a node inside a plane has its whole subtree inside it: the planes still to test go down with each node
+    struct Entry
+    {
+        uint32_t node;
+        unsigned int planes;
+    };
+    thread_local std::vector<Entry> stack;
+    stack.assign(1, {0, 0x3fu});
+    while (!stack.empty())
+    {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[entry.node];
+
+        unsigned int active = entry.planes;
+        bool outside = false;
+        for (int plane = 0; plane < 6 && !outside; plane++)
+        {
+            if (!(active & (1u << plane)))
+                continue;
+            float distance, radius;
+            planeDistance(planes[plane], node.bounds, distance, radius);
+            outside = distance + radius < 0.0f;
+            if (distance - radius >= 0.0f)
+                active &= ~(1u << plane);
+        }
+        if (outside)
+            continue;
+        if (active == 0)
+        {
+            collect(entry.node, out);
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack.push_back({node.first, active});
+            stack.push_back({node.first + 1, active});
+            continue;
+        }
+        for (uint32_t i = 0; i < node.count; i++)
+        {
+            const uint32_t object = order[node.first + i];
+            bool inside = true;
+            for (int plane = 0; plane < 6 && inside; plane++)
+            {
+                if (!(active & (1u << plane)))
+                    continue;
+                float distance, radius;
+                planeDistance(planes[plane], boxes[object], distance, radius);
+                inside = distance + radius >= 0.0f;
+            }
+            if (inside)
+                out.push_back(object);
+        }
+    }
+}
+
+void Bvh::queryBox(const Aabb &box, std::vector<uint32_t> &out) const
+{
+    if (nodes.empty())
+        return;
+    thread_local std::vector<uint32_t> stack;
+    stack.assign(1, 0);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!node.bounds.overlaps(box))
+            continue;
+        if (node.count == 0)
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = 0; i < node.count; i++)
+            if (boxes[order[node.first + i]].overlaps(box))
+                out.push_back(order[node.first + i]);
+    }
+}
+
+void Bvh::querySphere(const glm::vec3 &center, const float radius, std::vector<uint32_t> &out) const
+{
+    if (nodes.empty())
+        return;
+    thread_local std::vector<uint32_t> stack;
+    stack.assign(1, 0);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!sphereOverlaps(node.bounds, center, radius))
+            continue;
+        if (node.count == 0)
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+        for (uint32_t i = 0; i < node.count; i++)
+            if (sphereOverlaps(boxes[order[node.first + i]], center, radius))
+                out.push_back(order[node.first + i]);
+    }
+}
+
+BvhHit Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance) const
+{
+    BvhHit hit = {NONE, maxDistance};
+    if (nodes.empty())
+        return hit;
+
+    // nearer child first, and nodes entered beyond the nearest hit so far are skipped
+    struct Entry
+    {
+        uint32_t node;
+        float distance;
+    };
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    thread_local std::vector<Entry> stack;
+    stack.clear();
+    const float rootDistance = rayEntry(nodes[0].bounds, origin, inverseDirection, hit.distance);
+    if (rootDistance < FLT_MAX)
+        stack.push_back({0, rootDistance});
+    while (!stack.empty())
+    {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.distance >= hit.distance)
+            continue;
+        const Node &node = nodes[entry.node];
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = 0; i < node.count; i++)
+            {
+                const uint32_t object = order[node.first + i];
+                const float distance = rayEntry(boxes[object], origin, inverseDirection, hit.distance);
+                if (distance < hit.distance)
+                    hit = {object, distance};
+            }
+            continue;
+        }
+        Entry near = {node.first, rayEntry(nodes[node.first].bounds, origin, inverseDirection, hit.distance)};
+        Entry far = {node.first + 1, rayEntry(nodes[node.first + 1].bounds, origin, inverseDirection, hit.distance)};
+        if (far.distance < near.distance)
+            std::swap(near, far);
+        if (far.distance < FLT_MAX)
+            stack.push_back(far);
+        if (near.distance < FLT_MAX)
+            stack.push_back(near);
+    }
+    return hit;
+}
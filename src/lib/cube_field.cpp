@@ -0,0 +1,103 @@
+#include "cube_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace {
+    // spin angle (radians) of a cube, the same rotation around Y, X and Z
+    float spin(const size_t index, const float time)
+    {
+        return glm::radians(20.0f * time + (float)(index * index));
+    }
+}
+
+CubeField::CubeField(const size_t count)
+{
+    positions = {
+        glm::vec3( 0.0f, -1.0f, 0.0f),
+        glm::vec3( 2.0f, 5.0f, -10.0f),
+        glm::vec3(-1.5f, -2.2f, -2.5f),
+        glm::vec3(-3.8f, -2.0f, -12.3f),
+        glm::vec3( 2.4f, -0.4f, -3.5f),
+        glm::vec3(-1.7f, 3.0f, -7.5f),
+        glm::vec3( 1.3f, -2.0f, -2.5f),
+        glm::vec3( 1.5f, 2.0f, -2.5f),
+        glm::vec3( 1.5f, 0.2f, -1.5f),
+        glm::vec3(-1.3f, 1.0f, -1.5f)
+    };
+    positions.resize(std::min(count, positions.size()));
+
+    // the rest fill a box in front of the camera, about 2 units apart
+    const float side = 2.0f * std::cbrt((float)count);
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> across(-side * 0.5f, side * 0.5f), ahead(-side - 2.0f, -2.0f);
+    while (positions.size() < count)
+        positions.emplace_back(across(random), across(random), ahead(random));
+}
+
+glm::mat4 CubeField::model(const size_t index, const float time) const
+{
+    const float angle = spin(index, time);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[index]);
+    model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::rotate(model, angle, glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::scale(model, glm::vec3(SCALE));
+}
+
+float CubeField::alpha(const size_t index, const float time) const
+{
+    const float wave = std::sin(time + 100.0f * (float)index);
+    return wave * wave;
+}
+
+glm::vec4 CubeField::rotation(const size_t index, const float time) const
+{
+    // Ry * Rx * Rz as a quaternion: the three share one angle, so a single sin/cos
+    const float half = spin(index, time) * 0.5f;
+    const float s = std::sin(half), c = std::cos(half);
+    const glm::vec4 yx(c * s, s * c, -s * s, c * c);    // qy * qx
+    return {yx.x * c + yx.y * s, yx.y * c - yx.x * s, yx.z * c + yx.w * s, yx.w * c - yx.z * s};
+}
+
+CubeInstance CubeField::instance(const size_t index, const float time) const
+{
+    CubeInstance instance;
+    instance.positionScale = glm::vec4(positions[index], SCALE);
+    instance.rotation = rotation(index, time);
+    instance.alpha = alpha(index, time);
+    return instance;
+}
+
+void CubeField::instances(const float time, CubeInstance *out) const
+{
+    for (size_t i = 0; i < positions.size(); i++)
+        out[i] = instance(i, time);
+}
+
+size_t CubeField::addTransforms(TransformSystem &transforms) const
+{
+    const size_t first = transforms.size();
+    for (const glm::vec3 &position : positions)
+        transforms.add(position, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), SCALE);
+    return first;
+}
+
+void CubeField::animate(const float time, TransformSystem &transforms, const size_t first) const
+{
+    for (size_t i = 0; i < positions.size(); i++)
+        transforms.setRotation(first + i, rotation(i, time));
+}
+
+const VertexLayout& CubeField::instanceLayout()
+{
+    static const VertexLayout layout = {
+        {VertexSemantic::INSTANCE, 4, VertexFormat::FLOAT4},
+        {VertexSemantic::INSTANCE, 5, VertexFormat::FLOAT4},
+        {VertexSemantic::INSTANCE, 6, VertexFormat::FLOAT}
+    };
+    return layout;
+}
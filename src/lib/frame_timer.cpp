@@ -0,0 +1,39 @@
+#include "frame_timer.h"
+
+#include <algorithm>
+#include <iostream>
+
+void FrameTimer::frame(const double now)
+{
+    if (start < 0.0)
+    {
+        start = last = now;
+        return;
+    }
+
+    const double ms = (now - last) * 1000.0;
+    last = now;
+    frameMs.push_back((float)ms);
+
+    // the first frames only seed the average
+    if (frameMs.size() > 10 && ms > 2.0 * averageMs && ms > averageMs + SPIKE_MARGIN_MS)
+    {
+        spikes++;
+        if (now - start < WATCH_SECONDS)
+            std::cout << "FRAME::SPIKE " << ms << " ms at " << (now - start) << " s (frame " << frameMs.size()
+                      << ", average " << averageMs << " ms)" << std::endl;
+    }
+    averageMs = frameMs.size() == 1 ? ms : averageMs + (ms - averageMs) * 0.1;
+}
+
+void FrameTimer::report() const
+{
+    if (frameMs.empty())
+        return;
+
+    std::vector<float> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&](const double p) { return sorted[(size_t)(p * (double)(sorted.size() - 1))]; };
+    std::cout << "Frame times: " << sorted.size() << " frames, median " << percentile(0.5) << " ms, 99th "
+              << percentile(0.99) << " ms, max " << sorted.back() << " ms, " << spikes << " spikes" << std::endl;
+}
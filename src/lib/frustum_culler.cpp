@@ -0,0 +1,263 @@
+#include "frustum_culler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "cull_blocks.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+    using Lanes = simd::Lanes;
+    using simd::BoxBlock;
+    using simd::SphereBlock;
+
+    // below this many objects the culls run on the calling thread alone
+    constexpr size_t PARALLEL_MIN = 65536;
+    // objects per parallelFor task, a multiple of the block
+    constexpr size_t TASK_SIZE = 16384;
+
+    // grows the arrays by a block when index is the first of one
+    void reserveBlock(const size_t index, std::initializer_list<std::vector<float>*> components)
+    {
+        if (index % Lanes::WIDTH != 0)
+            return;
+        for (std::vector<float> *component : components)
+            component->resize(index + Lanes::WIDTH, 0.0f);
+    }
+
+    // appends first + lane for the lanes set in inside, up to count
+    void appendVisible(const unsigned int inside, const size_t first, const size_t count, std::vector<uint32_t> &visible)
+    {
+        for (size_t lane = 0; lane < Lanes::WIDTH && first + lane < count; lane++)
+            if (inside & (1u << lane))
+                visible.push_back((uint32_t)(first + lane));
+    }
+
+    // the blocks of [first, last) against one frustum, the indices of those inside appended to visible
+    template <typename L, typename Block, typename LoadBlock>
+    void cullBlocks(const size_t first, const size_t last, const glm::vec4 planes[6], const LoadBlock &load,
+                    std::vector<uint32_t> &visible)
+    {
+        constexpr unsigned int LANES = (1u << L::WIDTH) - 1;
+        for (size_t i = first; i < last; i += L::WIDTH)
+        {
+            const Block block = load(i);
+            appendVisible(~L::bits(block.outside(planes)) & LANES, i, last, visible);
+        }
+    }
+
+    // the blocks of [first, last) against every view, each loaded once: bit v of masks[i] is set when object i is
+    // inside view v. A view's planes are only tested for the blocks that reach the sphere around its frustum, which
+    // most miss once there are a few views. Returns how many are inside none
+    template <typename L, typename Block, typename LoadBlock>
+    size_t cullBlockViews(const size_t first, const size_t last, const glm::vec4 *planes, const glm::vec4 *spheres,
+                          const size_t views, const LoadBlock &load, uint32_t *masks)
+    {
+        constexpr unsigned int LANES = (1u << L::WIDTH) - 1;
+        size_t culled = 0;
+        for (size_t i = first; i < last; i += L::WIDTH)
+        {
+            const Block block = load(i);
+            uint32_t laneMasks[L::WIDTH] = {};
+            for (size_t view = 0; view < views; view++)
+            {
+                if (L::bits(block.beyond(spheres[view])) == LANES)
+                    continue;
+                const unsigned int inside = ~L::bits(block.outside(planes + view * 6)) & LANES;
+                for (unsigned int lane = 0; lane < L::WIDTH; lane++)
+                    laneMasks[lane] |= ((inside >> lane) & 1u) << view;
+            }
+            for (size_t lane = 0; lane < L::WIDTH && i + lane < last; lane++)
+            {
+                masks[i + lane] = laneMasks[lane];
+                culled += laneMasks[lane] == 0;
+            }
+        }
+        return culled;
+    }
+}
+
+void frustumPlanes(const glm::mat4 &viewProj, glm::vec4 planes[6])
+{
+    // Gribb and Hartmann: the clip space tests -w <= x, y, z <= w against the rows of viewProj
+    const glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    const glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    const glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    const glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+void FrustumCuller::setView(const glm::mat4 &viewProj)
+{
+    frustumPlanes(viewProj, planes);
+}
+
+void FrustumCuller::setViews(const glm::mat4 *viewProjs, const size_t count)
+{
+    if (count > MAX_VIEWS)
+        std::cout << "ERROR::FRUSTUM_CULLER::TOO_MANY_VIEWS: " << count << ", the first " << MAX_VIEWS << " are culled for"
+                  << std::endl;
+    views = std::min<size_t>(count, MAX_VIEWS);
+    viewPlanes.resize(views * 6);
+    viewSpheres.resize(views);
+    for (size_t view = 0; view < views; view++)
+    {
+        frustumPlanes(viewProjs[view], &viewPlanes[view * 6]);
+        // around the frustum's corners, from their middle
+        const glm::mat4 toWorld = glm::inverse(viewProjs[view]);
+        glm::vec3 corners[8], center(0.0f);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            const glm::vec4 world = toWorld * glm::vec4(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f,
+                                                        corner & 4 ? 1.0f : -1.0f, 1.0f);
+            corners[corner] = glm::vec3(world) / world.w;
+            center += corners[corner] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3 &corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        // a little larger than the corners, which the inverse only gets to a few digits
+        viewSpheres[view] = glm::vec4(center, radius * 1.001f);
+    }
+}
+
+size_t FrustumCuller::addSphere(const glm::vec3 &center, const float radius)
+{
+    reserveBlock(spheres, {&sphereX, &sphereY, &sphereZ, &sphereRadius});
+    setSphere(spheres, center, radius);
+    return spheres++;
+}
+
+void FrustumCuller::setSphere(const size_t index, const glm::vec3 &center, const float radius)
+{
+    sphereX[index] = center.x;
+    sphereY[index] = center.y;
+    sphereZ[index] = center.z;
+    sphereRadius[index] = radius;
+}
+
+size_t FrustumCuller::addBox(const glm::vec3 &min, const glm::vec3 &max)
+{
+    reserveBlock(boxes, {&boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ});
+    setBox(boxes, min, max);
+    return boxes++;
+}
+
+void FrustumCuller::setBox(const size_t index, const glm::vec3 &min, const glm::vec3 &max)
+{
+    const glm::vec3 center = (min + max) * 0.5f, extent = (max - min) * 0.5f;
+    boxX[index] = center.x;
+    boxY[index] = center.y;
+    boxZ[index] = center.z;
+    extentX[index] = extent.x;
+    extentY[index] = extent.y;
+    extentZ[index] = extent.z;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cullSpheres()
+{
+    const auto load = [this](const size_t i) {
+        return SphereBlock<Lanes>(i, sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data());
+    };
+    cullAll(spheres, visibleSpheres, [&](const size_t first, const size_t last, std::vector<uint32_t> &visible) {
+        cullBlocks<Lanes, SphereBlock<Lanes>>(first, last, planes, load, visible);
+    });
+    return visibleSpheres;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cullBoxes()
+{
+    const auto load = [this](const size_t i) {
+        return BoxBlock<Lanes>(i, boxX.data(), boxY.data(), boxZ.data(), extentX.data(), extentY.data(), extentZ.data());
+    };
+    cullAll(boxes, visibleBoxes, [&](const size_t first, const size_t last, std::vector<uint32_t> &visible) {
+        cullBlocks<Lanes, BoxBlock<Lanes>>(first, last, planes, load, visible);
+    });
+    return visibleBoxes;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cullSphereViews()
+{
+    const auto load = [this](const size_t i) {
+        return SphereBlock<Lanes>(i, sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data());
+    };
+    cullViews(spheres, sphereMasks, [&](const size_t first, const size_t last, uint32_t *masks) {
+        return cullBlockViews<Lanes, SphereBlock<Lanes>>(first, last, viewPlanes.data(), viewSpheres.data(), views, load, masks);
+    });
+    return sphereMasks;
+}
+
+const std::vector<uint32_t>& FrustumCuller::cullBoxViews()
+{
+    const auto load = [this](const size_t i) {
+        return BoxBlock<Lanes>(i, boxX.data(), boxY.data(), boxZ.data(), extentX.data(), extentY.data(), extentZ.data());
+    };
+    cullViews(boxes, boxMasks, [&](const size_t first, const size_t last, uint32_t *masks) {
+        return cullBlockViews<Lanes, BoxBlock<Lanes>>(first, last, viewPlanes.data(), viewSpheres.data(), views, load, masks);
+    });
+    return boxMasks;
+}
+
+template <typename Cull>
+void FrustumCuller::cullAll(const size_t count, std::vector<uint32_t> &visible, const Cull &cull)
+{
+    const auto start = std::chrono::steady_clock::now();
+    visible.clear();
+    if (count < PARALLEL_MIN || workerCount() == 1)
+        cull(0, count, visible);
+    else
+    {
+        // each task compacts its range on its own, then the ranges are joined in order
+        taskVisible.resize((count + TASK_SIZE - 1) / TASK_SIZE);
+        parallelFor(taskVisible.size(), [&](const size_t task) {
+            taskVisible[task].clear();
+            cull(task * TASK_SIZE, std::min(count, (task + 1) * TASK_SIZE), taskVisible[task]);
+        });
+        for (const std::vector<uint32_t> &taskIndices : taskVisible)
+            visible.insert(visible.end(), taskIndices.begin(), taskIndices.end());
+    }
+
+    current.tested += count;
+    current.culled += count - visible.size();
+    current.microseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Cull>
+void FrustumCuller::cullViews(const size_t count, std::vector<uint32_t> &masks, const Cull &cull)
+{
+    const auto start = std::chrono::steady_clock::now();
+    masks.resize(count);
+    size_t culled = 0;
+    if (count < PARALLEL_MIN || workerCount() == 1)
+        culled = cull(0, count, masks.data());
+    else
+    {
+        // the tasks write their own ranges of the masks
+        taskCulled.resize((count + TASK_SIZE - 1) / TASK_SIZE);
+        parallelFor(taskCulled.size(), [&](const size_t task) {
+            taskCulled[task] = cull(task * TASK_SIZE, std::min(count, (task + 1) * TASK_SIZE), masks.data());
+        });
+        for (const size_t taskCount : taskCulled)
+            culled += taskCount;
+    }
+
+    current.tested += count;
+    current.culled += culled;
+    current.microseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrustumCuller::endFrame()
+{
+    previous = current;
+    current = FrustumCullStats();
+}
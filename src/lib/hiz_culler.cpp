@@ -0,0 +1,244 @@
+#include "hiz_culler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "cube_field.h"
+#include "frustum_culler.h"
+#include "shader_blocks.h"
+
+namespace {
+    // the texture unit the depth buffer is read from while the pyramid is built
+    constexpr int DEPTH_UNIT = 7;
+    // the build's workgroups reduce 32x32 texels of level 0 each, the cull's test 64 objects
+    constexpr int BUILD_BLOCK = 32;
+    constexpr int CULL_GROUP = 64;
+
+    constexpr GLbitfield DRAW_BARRIERS = GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+                                         | GL_SHADER_STORAGE_BARRIER_BIT;
+}
+
+HizCuller::HizCuller(const MeshRegistry &registry, ShaderHandle buildProgram, ShaderHandle cullProgram)
+    : registry(registry), buildProgram(std::move(buildProgram)), cullProgram(std::move(cullProgram))
+{
+    this->buildProgram.onReady([this](const Shader &shader) {
+        shader.use();
+        shader.setInt("depthBuffer", DEPTH_UNIT);
+        build.hizWidth = shader.uniform<int>("hizWidth");
+        build.hizHeight = shader.uniform<int>("hizHeight");
+        build.hizLevelCount = shader.uniform<int>("hizLevelCount");
+    });
+    this->cullProgram.onReady([this](const Shader &shader) {
+        cull.hizWidth = shader.uniform<int>("hizWidth");
+        cull.hizHeight = shader.uniform<int>("hizHeight");
+        cull.hizLevelCount = shader.uniform<int>("hizLevelCount");
+        cull.phase = shader.uniform<int>("phase");
+        cull.objectCount = shader.uniform<int>("objectCount");
+        cull.levelCount = shader.uniform<int>("levelCount");
+        cull.viewProj = shader.uniform<glm::mat4>("viewProj");
+        cull.frustumPlanes = shader.uniform<glm::vec4>("frustumPlanes");
+        cull.cameraPosition = shader.uniform<glm::vec3>("cameraPosition");
+        cull.viewport = shader.uniform<glm::vec2>("viewport");
+        cull.boundsRadius = shader.uniform<float>("boundsRadius");
+        cull.pixelsPerUnit = shader.uniform<float>("pixelsPerUnit");
+        cull.levelErrors = shader.uniform<float>("levelErrors");
+        cull.levelTriangles = shader.uniform<int>("levelTriangles");
+    });
+    for (unsigned int *buffer : {&pyramidBuffer, &buildBuffer, &visibilityBuffer, &drawBuffer, &drawnBuffer, &counterBuffer})
+        glGenBuffers(1, buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buildBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(HizBuildBlock), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(HizCountersBlock), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void HizCuller::setLevels(const std::vector<int> &meshes, const std::vector<float> &errors, const float boundsRadius)
+{
+    if (meshes.size() > MAX_LEVELS)
+        std::cout << "ERROR::HIZ_CULLER::TOO_MANY_LEVELS: " << meshes.size() << ", the first " << MAX_LEVELS
+                  << " are drawn" << std::endl;
+    levels.assign(meshes.begin(), meshes.begin() + std::min<size_t>(meshes.size(), MAX_LEVELS));
+    for (size_t level = 0; level < levels.size(); level++)
+    {
+        levelErrors[level] = errors[level];
+        levelTriangles[level] = (int)(registry.range(levels[level]).indexCount / 3);
+    }
+    radius = boundsRadius;
+}
+
+void HizCuller::setDepth(const unsigned int texture, const int width, const int height)
+{
+    depthTexture = texture;
+    depthSize = glm::ivec2(width, height);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // level 0 is half the pixels each way, rounded up, and the levels go on halving down to 1x1
+    pyramidSize = (depthSize + 1) / 2;
+    size_t texels = 0;
+    pyramidLevels = 0;
+    for (glm::ivec2 size = pyramidSize;; size = glm::max((size + 1) / 2, glm::ivec2(1)))
+    {
+        texels += (size_t)size.x * size.y;
+        pyramidLevels++;
+        if (size.x == 1 && size.y == 1)
+            break;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pyramidBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(texels * sizeof(float)), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buildBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void HizCuller::begin(const glm::mat4 &frameViewProj, const glm::vec3 &cameraPosition, const float framePixelsPerUnit,
+                      const unsigned int instanceBuffer, const GLintptr instanceOffset, const size_t count)
+{
+    viewProj = frameViewProj;
+    frustumPlanes(viewProj, planes);
+    camera = cameraPosition;
+    pixelsPerUnit = framePixelsPerUnit;
+    objects = instanceBuffer;
+    objectsOffset = instanceOffset;
+
+    // new objects start out visible, so that they are drawn in phase 1 and never pop in late
+    if (count > capacity)
+    {
+        const size_t grown = std::max(count, capacity * 2);
+        const std::vector<uint32_t> visible(grown, 1u);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(grown * sizeof(uint32_t)), visible.data(), GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawnBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(std::max<size_t>(levels.size(), 1) * grown * sizeof(CubeInstance)),
+                     nullptr, GL_DYNAMIC_COPY);
+        capacity = grown;
+    }
+    objectCount = count;
+
+    // a level's instances, of both phases, take the count slots from level * count on
+    std::vector<DrawElementsIndirectCommand> commands;
+    for (int phase = 1; phase <= 2; phase++)
+        for (size_t level = 0; level < levels.size(); level++)
+            commands.push_back(registry.command(levels[level], 0, (unsigned int)(level * count)));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(commands.size() * sizeof(DrawElementsIndirectCommand)),
+                 commands.data(), GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void HizCuller::dispatchCull(const int phase)
+{
+    cullProgram.get().use();
+    cull.hizWidth.set(pyramidSize.x);
+    cull.hizHeight.set(pyramidSize.y);
+    cull.hizLevelCount.set(pyramidLevels);
+    cull.phase.set(phase);
+    cull.objectCount.set((int)objectCount);
+    cull.levelCount.set((int)levels.size());
+    cull.viewProj.set(viewProj);
+    cull.frustumPlanes.set(planes, 6);
+    cull.cameraPosition.set(camera);
+    cull.viewport.set(glm::vec2(depthSize));
+    cull.boundsRadius.set(radius);
+    cull.pixelsPerUnit.set(pixelsPerUnit);
+    cull.levelErrors.set(levelErrors, MAX_LEVELS);
+    cull.levelTriangles.set(levelTriangles, MAX_LEVELS);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizPyramidBlock::BINDING, pyramidBuffer);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, HizObjectsBlock::BINDING, objects, objectsOffset,
+                      (GLsizeiptr)(objectCount * sizeof(CubeInstance)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizVisibilityBlock::BINDING, visibilityBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizDrawsBlock::BINDING, drawBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizInstancesBlock::BINDING, drawnBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizCountersBlock::BINDING, counterBuffer);
+    glDispatchCompute((unsigned int)((objectCount + CULL_GROUP - 1) / CULL_GROUP), 1, 1);
+}
+
+void HizCuller::cullFirst()
+{
+    if (!ready() || objectCount == 0 || levels.empty())
+        return;
+    dispatchCull(1);
+}
+
+void HizCuller::cullSecond()
+{
+    if (!ready() || objectCount == 0 || levels.empty() || depthTexture == 0)
+        return;
+
+    // the pyramid from what phase 1 drew, in one dispatch
+    buildProgram.get().use();
+    build.hizWidth.set(pyramidSize.x);
+    build.hizHeight.set(pyramidSize.y);
+    build.hizLevelCount.set(pyramidLevels);
+    glActiveTexture(GL_TEXTURE0 + DEPTH_UNIT);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizPyramidBlock::BINDING, pyramidBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HizBuildBlock::BINDING, buildBuffer);
+    glDispatchCompute((unsigned int)((pyramidSize.x + BUILD_BLOCK - 1) / BUILD_BLOCK),
+                      (unsigned int)((pyramidSize.y + BUILD_BLOCK - 1) / BUILD_BLOCK), 1);
+    // phase 2 draws into the framebuffer the texture is attached to
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    dispatchCull(2);
+}
+
+void HizCuller::drawPhase(const int phase) const
+{
+    if (!ready() || objectCount == 0 || levels.empty())
+        return;
+
+    // the instance counts and the instances were written by the dispatch, which phase 2 reads the counts of as well
+    glMemoryBarrier(DRAW_BARRIERS);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, registry.indexType(),
+                                (const void*)((phase - 1) * levels.size() * sizeof(DrawElementsIndirectCommand)),
+                                (GLsizei)levels.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void HizCuller::drawFirst() const
+{
+    drawPhase(1);
+}
+
+void HizCuller::drawSecond() const
+{
+    drawPhase(2);
+}
+
+HizCullStats HizCuller::readStats() const
+{
+    HizCountersBlock counters{};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), &counters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    HizCullStats stats;
+    stats.objects = objectCount;
+    stats.frustumCulled = counters.frustumCulled;
+    stats.occluded = counters.occluded;
+    stats.drawnFirst = counters.drawnFirst;
+    stats.drawnSecond = counters.drawnSecond;
+    stats.triangles = counters.trianglesDrawn;
+    return stats;
+}
+
+void HizCuller::release()
+{
+    for (unsigned int *buffer : {&pyramidBuffer, &buildBuffer, &visibilityBuffer, &drawBuffer, &drawnBuffer, &counterBuffer})
+    {
+        glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    capacity = 0;
+}
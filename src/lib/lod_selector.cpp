@@ -0,0 +1,38 @@
+#include "lod_selector.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // objects around the camera are measured from this close at least
+    constexpr float MIN_DISTANCE = 1e-3f;
+}
+
+LodSelector::LodSelector(const float thresholdPixels, const float hysteresis)
+    : threshold(thresholdPixels), hysteresis(hysteresis)
+{
+}
+
+void LodSelector::setView(const glm::vec3 &cameraPosition, const float fovY, const int viewportHeight)
+{
+    camera = cameraPosition;
+    // a length at distance 1 spans 2 tan(fov / 2) of the view's height
+    pixelsPerUnit = (float)viewportHeight / (2.0f * std::tan(glm::radians(fovY) * 0.5f));
+}
+
+unsigned int LodSelector::select(const size_t object, const glm::vec3 &center, const float radius, const float *errors,
+                                 const unsigned int levelCount)
+{
+    // the nearest point of the bounding sphere shows the error largest
+    const float distance = std::max(glm::length(center - camera) - radius, MIN_DISTANCE);
+    unsigned int level = std::min<unsigned int>(levels[object], levelCount - 1);
+
+    // finer while the current level shows too much error, then coarser while the next one is well below the threshold
+    while (level > 0 && projectedError(errors[level], distance) > threshold)
+        level--;
+    while (level + 1 < levelCount && projectedError(errors[level + 1], distance) <= threshold * (1.0f - hysteresis))
+        level++;
+
+    levels[object] = (uint8_t)level;
+    return level;
+}
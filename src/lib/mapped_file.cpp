@@ -0,0 +1,44 @@
+#include "mapped_file.h"
+
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+{
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED: " << path << std::endl;
+        return;
+    }
+
+    struct stat info{};
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            // the whole file is about to be read, start reading it ahead
+            madvise(mapping, (size_t)info.st_size, MADV_WILLNEED);
+            bytes = static_cast<const unsigned char*>(mapping);
+            length = (size_t)info.st_size;
+        }
+        else
+            std::cout << "ERROR::MAPPED_FILE::MAP_FAILED: " << path << std::endl;
+    }
+    else
+        std::cout << "ERROR::MAPPED_FILE::EMPTY: " << path << std::endl;
+
+    // the mapping keeps the file alive
+    close(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (bytes != nullptr)
+        munmap(const_cast<unsigned char*>(bytes), length);
+}
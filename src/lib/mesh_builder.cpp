@@ -0,0 +1,552 @@
+#include "mesh_builder.h"
+#include "program_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+#include "glm/glm.hpp"
+
+namespace {
+    constexpr uint32_t NONE = ~0u;
+
+    // Forsyth's scoring: a vertex scores higher the more recently it entered the cache (the last triangle's
+    // three vertices get a flat score, so strips do not ping-pong) and the fewer triangles it has left
+    constexpr int FORSYTH_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    float vertexScore(const int cachePosition, const uint32_t remaining)
+    {
+        if (remaining == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = LAST_TRIANGLE_SCORE;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        return score + VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+    }
+
+    glm::vec3 positionOf(const unsigned char *vertices, const uint32_t index, const unsigned int vertexSize,
+                         const unsigned int positionOffset)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, vertices + (size_t)index * vertexSize + positionOffset, sizeof(position));
+        return position;
+    }
+}
+
+MeshBuilder::MeshBuilder(const unsigned int vertexSize, const unsigned int positionOffset)
+    : vertexSize(vertexSize), positionOffset(positionOffset)
+{
+}
+
+void MeshBuilder::addTriangles(const void *vertexData, const size_t vertexCount)
+{
+    const auto base = (uint32_t)(vertices.size() / vertexSize);
+    const auto *bytes = static_cast<const unsigned char*>(vertexData);
+    vertices.insert(vertices.end(), bytes, bytes + vertexCount * vertexSize);
+    for (size_t i = 0; i < vertexCount / 3 * 3; i++)
+        indices.push_back(base + (uint32_t)i);
+}
+
+void MeshBuilder::addIndexed(const void *vertexData, const size_t vertexCount, const uint32_t *indexData, const size_t indexCount)
+{
+    const auto base = (uint32_t)(vertices.size() / vertexSize);
+    const auto *bytes = static_cast<const unsigned char*>(vertexData);
+    vertices.insert(vertices.end(), bytes, bytes + vertexCount * vertexSize);
+    for (size_t i = 0; i < indexCount / 3 * 3; i++)
+        indices.push_back(base + indexData[i]);
+}
+
+Mesh MeshBuilder::build(const char *label) const
+{
+    Mesh mesh;
+    mesh.vertexSize = vertexSize;
+    mesh.vertices = vertices;
+    std::vector<uint32_t> optimized = indices;
+
+    const size_t inputVertices = vertices.size() / vertexSize;
+    const size_t uniqueVertices = weldVertices(mesh.vertices, vertexSize, optimized);
+    const VertexCacheStats before = analyzeVertexCache(optimized, uniqueVertices);
+
+    optimized = optimizeVertexCache(optimized, uniqueVertices);
+    optimizeOverdraw(optimized, mesh.vertices.data(), uniqueVertices, vertexSize, positionOffset);
+    mesh.meshlets = buildMeshlets(optimized, meshPositions(mesh, positionOffset));
+    optimizeVertexFetch(mesh.vertices, vertexSize, optimized);
+    const VertexCacheStats after = analyzeVertexCache(optimized, mesh.vertexCount());
+
+    packIndices(mesh, optimized);
+
+    if (label != nullptr)
+        std::cout << std::fixed << std::setprecision(2) << "Mesh " << label << ": " << inputVertices << " vertices welded to "
+                  << mesh.vertexCount() << ", " << optimized.size() / 3 << " triangles, "
+                  << (mesh.indexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices; ACMR " << before.acmr << " -> "
+                  << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::defaultfloat << std::endl;
+    return mesh;
+}
+
+void packIndices(Mesh &mesh, const std::vector<uint32_t> &indices)
+{
+    // 16-bit indices halve the index fetch bandwidth whenever the mesh is small enough
+    mesh.indexCount = (unsigned int)indices.size();
+    if (mesh.vertexCount() <= 0xFFFF)
+    {
+        mesh.indexType = GL_UNSIGNED_SHORT;
+        mesh.indices.resize(indices.size() * sizeof(uint16_t));
+        auto *packed = reinterpret_cast<uint16_t*>(mesh.indices.data());
+        for (size_t i = 0; i < indices.size(); i++)
+            packed[i] = (uint16_t)indices[i];
+    }
+    else
+    {
+        mesh.indexType = GL_UNSIGNED_INT;
+        mesh.indices.resize(indices.size() * sizeof(uint32_t));
+        std::memcpy(mesh.indices.data(), indices.data(), mesh.indices.size());
+    }
+}
+
+std::vector<uint32_t> unpackIndices(const Mesh &mesh)
+{
+    std::vector<uint32_t> indices(mesh.indexCount);
+    if (mesh.indexType == GL_UNSIGNED_SHORT)
+    {
+        const auto *packed = reinterpret_cast<const uint16_t*>(mesh.indices.data());
+        std::copy(packed, packed + indices.size(), indices.begin());
+    }
+    else
+        std::memcpy(indices.data(), mesh.indices.data(), indices.size() * sizeof(uint32_t));
+    return indices;
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &indices, const size_t vertexCount, const unsigned int cacheSize)
+{
+    // FIFO: a hit does not refresh the entry, like the post-transform caches of real hardware
+    std::vector<uint32_t> fifo(cacheSize, NONE);
+    size_t head = 0, misses = 0;
+    for (const uint32_t index : indices)
+    {
+        if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+            continue;
+        fifo[head] = index;
+        head = (head + 1) % cacheSize;
+        misses++;
+    }
+
+    const size_t triangles = indices.size() / 3;
+    return {triangles != 0 ? (float)misses / (float)triangles : 0.0f,
+            vertexCount != 0 ? (float)misses / (float)vertexCount : 0.0f};
+}
+
+size_t weldVertices(std::vector<unsigned char> &vertices, const unsigned int vertexSize, std::vector<uint32_t> &indices)
+{
+    const size_t vertexCount = vertices.size() / vertexSize;
+
+    // open addressing on the FNV-1a hash of the vertex bytes, at most half full
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+        tableSize <<= 1;
+    std::vector<uint32_t> table(tableSize, NONE);
+
+    std::vector<uint32_t> remap(vertexCount);
+    uint32_t unique = 0;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const unsigned char *vertex = vertices.data() + i * vertexSize;
+        size_t slot = hashBytes(vertex, vertexSize) & (tableSize - 1);
+        while (table[slot] != NONE && std::memcmp(vertices.data() + (size_t)table[slot] * vertexSize, vertex, vertexSize) != 0)
+            slot = (slot + 1) & (tableSize - 1);
+
+        if (table[slot] == NONE)
+        {
+            // compacts in place: unique <= i, so the destination was already read
+            if (unique != i)
+                std::memmove(vertices.data() + (size_t)unique * vertexSize, vertex, vertexSize);
+            table[slot] = unique++;
+        }
+        remap[i] = table[slot];
+    }
+
+    for (uint32_t &index : indices)
+        index = remap[index];
+    vertices.resize((size_t)unique * vertexSize);
+    return unique;
+}
+
+std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t> &indices, const size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    // vertex -> triangles using it, the first `remaining` of each list are the ones not emitted yet
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (const uint32_t index : indices)
+        remaining[index]++;
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    uint32_t best = triangleCount != 0
+                    ? (uint32_t)(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin())
+                    : NONE;
+    size_t nextUnemitted = 0;
+    while (result.size() < triangleCount * 3)
+    {
+        if (best == NONE)
+        {
+            // dead end, none of the cached vertices has triangles left: restart from the next one in input order
+            while (emitted[nextUnemitted])
+                nextUnemitted++;
+            best = (uint32_t)nextUnemitted;
+        }
+
+        emitted[best] = true;
+        const uint32_t *triangle = &indices[(size_t)best * 3];
+        result.insert(result.end(), triangle, triangle + 3);
+
+        // drop the triangle from its vertices' lists
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t v = triangle[k];
+            uint32_t *list = &adjacency[firstTriangle[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++)
+                if (list[i] == best)
+                {
+                    std::swap(list[i], list[remaining[v] - 1]);
+                    break;
+                }
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front of the LRU cache
+        nextCache.assign(triangle, triangle + 3);
+        for (const uint32_t v : cache)
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        std::swap(cache, nextCache);
+
+        // rescore the cached vertices (and the evicted ones) and push the change to their triangles
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            const uint32_t v = cache[i];
+            const int position = i < (size_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+            const float newScore = vertexScore(position, remaining[v]);
+            const float delta = newScore - score[v];
+            score[v] = newScore;
+            for (uint32_t j = 0; j < remaining[v]; j++)
+                triangleScore[adjacency[firstTriangle[v] + j]] += delta;
+        }
+        if (cache.size() > (size_t)FORSYTH_CACHE_SIZE)
+            cache.resize(FORSYTH_CACHE_SIZE);
+
+        // the next triangle is the best one touching the cache
+        best = NONE;
+        float bestScore = -1.0f;
+        for (const uint32_t v : cache)
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                const uint32_t t = adjacency[firstTriangle[v] + j];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+    }
+    return result;
+}
+
+void optimizeOverdraw(std::vector<uint32_t> &indices, const unsigned char *vertices, const size_t vertexCount,
+                      const unsigned int vertexSize, const unsigned int positionOffset)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return;
+
+    // clusters start where the cache-optimized order restarts (a triangle whose three vertices all miss),
+    // so reordering whole clusters costs almost nothing in vertex cache efficiency
+    std::vector<size_t> clusterStart;
+    {
+        std::vector<uint32_t> fifo(MeshBuilder::CACHE_SIZE, NONE);
+        size_t head = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            int misses = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                const uint32_t index = indices[t * 3 + k];
+                if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+                    continue;
+                fifo[head] = index;
+                head = (head + 1) % fifo.size();
+                misses++;
+            }
+            if (t == 0 || misses == 3)
+                clusterStart.push_back(t);
+        }
+    }
+    clusterStart.push_back(triangleCount);
+    const size_t clusterCount = clusterStart.size() - 1;
+
+    // area-weighted centroid and normal of each cluster
+    std::vector<glm::vec3> centroid(clusterCount), normal(clusterCount);
+    std::vector<float> area(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 weighted(0.0f), normalSum(0.0f);
+        float areaSum = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const glm::vec3 a = positionOf(vertices, indices[t * 3], vertexSize, positionOffset);
+            const glm::vec3 b = positionOf(vertices, indices[t * 3 + 1], vertexSize, positionOffset);
+            const glm::vec3 d = positionOf(vertices, indices[t * 3 + 2], vertexSize, positionOffset);
+            const glm::vec3 cross = glm::cross(b - a, d - a);
+            const float triangleArea = glm::length(cross) * 0.5f;
+            weighted += (a + b + d) / 3.0f * triangleArea;
+            normalSum += cross;
+            areaSum += triangleArea;
+        }
+        centroid[c] = areaSum > 0.0f ? weighted / areaSum : positionOf(vertices, indices[clusterStart[c] * 3], vertexSize, positionOffset);
+        const float normalLength = glm::length(normalSum);
+        normal[c] = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+        area[c] = areaSum;
+        meshCentroid += weighted;
+        meshArea += areaSum;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // clusters facing away from the center are the outer surface: drawn first, they occlude the inner ones
+    std::vector<float> key(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        key[c] = glm::dot(centroid[c] - meshCentroid, normal[c]);
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return key[a] > key[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const size_t c : order)
+        result.insert(result.end(), indices.begin() + (long)(clusterStart[c] * 3), indices.begin() + (long)(clusterStart[c + 1] * 3));
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<unsigned char> &vertices, const unsigned int vertexSize, std::vector<uint32_t> &indices)
+{
+    const size_t vertexCount = vertices.size() / vertexSize;
+    std::vector<uint32_t> remap(vertexCount, NONE);
+    std::vector<unsigned char> ordered;
+    ordered.reserve(vertices.size());
+
+    // vertices are stored in the order the index buffer first touches them; unreferenced ones are dropped
+    uint32_t next = 0;
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == NONE)
+        {
+            remap[index] = next++;
+            ordered.insert(ordered.end(), vertices.begin() + (long)((size_t)index * vertexSize),
+                           vertices.begin() + (long)((size_t)(index + 1) * vertexSize));
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+std::vector<Meshlet> buildMeshlets(std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions)
+{
+    std::vector<Meshlet> meshlets;
+    const size_t triangleCount = indices.size() / 3;
+    const size_t vertexCount = positions.size();
+    if (triangleCount == 0)
+        return meshlets;
+
+    // the triangles around each vertex
+    std::vector<uint32_t> firstTriangle(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        firstTriangle[indices[i] + 1]++;
+    std::partial_sum(firstTriangle.begin(), firstTriangle.end(), firstTriangle.begin());
+    {
+        std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[filled[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<bool> inMeshlet(vertexCount, false);
+    std::vector<uint32_t> vertices, triangles, candidates;
+    glm::vec3 vertexSum(0.0f);
+    std::vector<uint32_t> reordered;
+    reordered.reserve(triangleCount * 3);
+
+    const auto newVertices = [&](const uint32_t triangle) {
+        const uint32_t *corner = &indices[(size_t)triangle * 3];
+        unsigned int count = 0;
+        for (int k = 0; k < 3; k++)
+            count += !inMeshlet[corner[k]] && (k == 0 || corner[k] != corner[0]) && (k < 2 || corner[k] != corner[1]);
+        return count;
+    };
+    const auto centroidOf = [&](const uint32_t triangle) {
+        const uint32_t *corner = &indices[(size_t)triangle * 3];
+        return (positions[corner[0]] + positions[corner[1]] + positions[corner[2]]) / 3.0f;
+    };
+
+    const auto add = [&](const uint32_t triangle) {
+        emitted[triangle] = true;
+        triangles.push_back(triangle);
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t vertex = indices[(size_t)triangle * 3 + k];
+            if (inMeshlet[vertex])
+                continue;
+            inMeshlet[vertex] = true;
+            vertices.push_back(vertex);
+            vertexSum += positions[vertex];
+            for (uint32_t t = firstTriangle[vertex]; t < firstTriangle[vertex + 1]; t++)
+                if (!emitted[adjacency[t]])
+                    candidates.push_back(adjacency[t]);
+        }
+    };
+
+    const auto flush = [&]() {
+        Meshlet meshlet{};
+        meshlet.firstIndex = (uint32_t)reordered.size();
+        meshlet.triangleCount = (uint32_t)triangles.size();
+        meshlet.vertexCount = (uint32_t)vertices.size();
+
+        // the sphere around the bounding box, and the cone around the average normal
+        glm::vec3 low(INFINITY), high(-INFINITY);
+        for (const uint32_t vertex : vertices)
+        {
+            low = glm::min(low, positions[vertex]);
+            high = glm::max(high, positions[vertex]);
+            inMeshlet[vertex] = false;
+        }
+        meshlet.center = (low + high) * 0.5f;
+        for (const uint32_t vertex : vertices)
+            meshlet.radius = std::max(meshlet.radius, glm::length(positions[vertex] - meshlet.center));
+
+        // in their earlier order, which was picked for the vertex cache
+        std::sort(triangles.begin(), triangles.end());
+        std::vector<glm::vec3> normals;
+        glm::vec3 normalSum(0.0f);
+        for (const uint32_t triangle : triangles)
+        {
+            const uint32_t *corner = &indices[(size_t)triangle * 3];
+            reordered.insert(reordered.end(), corner, corner + 3);
+            const glm::vec3 normal = glm::cross(positions[corner[1]] - positions[corner[0]],
+                                                positions[corner[2]] - positions[corner[0]]);
+            const float length = glm::length(normal);
+            if (length > 0.0f)
+            {
+                normals.push_back(normal / length);
+                normalSum += normals.back();
+            }
+        }
+        const float sumLength = glm::length(normalSum);
+        meshlet.coneAxis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+        float minDot = sumLength > 0.0f ? 1.0f : -1.0f;
+        for (const glm::vec3 &normal : normals)
+            minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+        // a cone wider than about 84 degrees around the axis culls too rarely to test
+        meshlet.coneCutoff = minDot <= 0.1f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+
+        meshlets.push_back(meshlet);
+        vertices.clear();
+        triangles.clear();
+        candidates.clear();
+        vertexSum = glm::vec3(0.0f);
+    };
+
+    size_t seed = 0;
+    while (true)
+    {
+        // the candidate that adds the fewest vertices, then the nearest to the meshlet's centroid
+        uint32_t best = NONE;
+        unsigned int bestNew = 4;
+        float bestDistance = INFINITY;
+        const glm::vec3 centroid = vertices.empty() ? glm::vec3(0.0f) : vertexSum / (float)vertices.size();
+        for (size_t c = 0; c < candidates.size();)
+        {
+            const uint32_t triangle = candidates[c];
+            if (emitted[triangle])
+            {
+                candidates[c] = candidates.back();
+                candidates.pop_back();
+                continue;
+            }
+            const unsigned int added = newVertices(triangle);
+            if (added < bestNew || (added == bestNew && glm::length(centroidOf(triangle) - centroid) < bestDistance))
+            {
+                best = triangle;
+                bestNew = added;
+                bestDistance = glm::length(centroidOf(triangle) - centroid);
+            }
+            c++;
+        }
+        // nothing connected is left: the next triangle in order
+        if (best == NONE)
+        {
+            while (seed < triangleCount && emitted[seed])
+                seed++;
+            if (seed == triangleCount)
+                break;
+            best = (uint32_t)seed;
+        }
+
+        if (triangles.size() == MESHLET_MAX_TRIANGLES || vertices.size() + newVertices(best) > MESHLET_MAX_VERTICES)
+            flush();
+        add(best);
+    }
+    flush();
+
+    indices.swap(reordered);
+    return meshlets;
+}
+
+void buildMeshlets(Mesh &mesh, const unsigned int positionOffset)
+{
+    std::vector<uint32_t> indices = unpackIndices(mesh);
+    mesh.meshlets = buildMeshlets(indices, meshPositions(mesh, positionOffset));
+    packIndices(mesh, indices);
+}
+
+std::vector<glm::vec3> meshPositions(const Mesh &mesh, const unsigned int positionOffset)
+{
+    std::vector<glm::vec3> positions(mesh.vertexCount());
+    for (size_t v = 0; v < positions.size(); v++)
+        positions[v] = positionOf(mesh.vertices.data(), (uint32_t)v, mesh.vertexSize, positionOffset);
+    return positions;
+}
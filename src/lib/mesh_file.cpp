@@ -0,0 +1,220 @@
+#include "mesh_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace {
+    size_t aligned(const size_t offset)
+    {
+        return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    }
+
+    size_t indexSize(const uint32_t indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    // [offset, offset + bytes) lies in a file of fileSize bytes
+    bool inFile(const uint64_t offset, const uint64_t bytes, const size_t fileSize)
+    {
+        return offset <= fileSize && bytes <= fileSize - offset;
+    }
+}
+
+bool writeMeshFile(const std::string &path, const std::vector<Mesh> &parts, const VertexLayout &layout,
+                   std::vector<MeshFileSubmesh> submeshes)
+{
+    MeshFileHeader header{};
+    std::memcpy(header.magic, "MESH", sizeof(header.magic));
+    header.version = MESH_FILE_VERSION;
+    header.vertexSize = layout.stride();
+    header.attributeCount = (uint32_t)layout.attributes().size();
+    header.submeshCount = (uint32_t)submeshes.size();
+    // 16-bit indices only if every part has them
+    header.indexType = GL_UNSIGNED_SHORT;
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        submeshes[i].firstIndex = header.indexCount;
+        submeshes[i].indexCount = parts[i].indexCount;
+        submeshes[i].baseVertex = header.vertexCount;
+        submeshes[i].vertexCount = (uint32_t)parts[i].vertexCount();
+        submeshes[i].firstMeshlet = header.meshletCount;
+        submeshes[i].meshletCount = (uint32_t)parts[i].meshlets.size();
+        header.meshletCount += (uint32_t)parts[i].meshlets.size();
+        header.indexCount += parts[i].indexCount;
+        header.vertexCount += (uint32_t)parts[i].vertexCount();
+        if (parts[i].indexType == GL_UNSIGNED_INT)
+            header.indexType = GL_UNSIGNED_INT;
+    }
+    if (!parts.empty())
+        std::memcpy(header.positionTransform, &parts[0].positionTransform[0][0], sizeof(header.positionTransform));
+    for (int axis = 0; axis < 3; axis++)
+    {
+        header.boundsMin[axis] = submeshes.empty() ? 0.0f : submeshes[0].boundsMin[axis];
+        header.boundsMax[axis] = submeshes.empty() ? 0.0f : submeshes[0].boundsMax[axis];
+        for (const MeshFileSubmesh &submesh : submeshes)
+        {
+            header.boundsMin[axis] = std::min(header.boundsMin[axis], submesh.boundsMin[axis]);
+            header.boundsMax[axis] = std::max(header.boundsMax[axis], submesh.boundsMax[axis]);
+        }
+    }
+
+    header.attributeOffset = sizeof(MeshFileHeader);
+    header.submeshOffset = header.attributeOffset + header.attributeCount * sizeof(MeshFileAttribute);
+    header.meshletOffset = header.submeshOffset + submeshes.size() * sizeof(MeshFileSubmesh);
+    header.vertexOffset = aligned(header.meshletOffset + header.meshletCount * sizeof(Meshlet));
+    header.vertexBytes = (uint64_t)header.vertexCount * header.vertexSize;
+    header.indexOffset = aligned(header.vertexOffset + header.vertexBytes);
+    header.indexBytes = (uint64_t)header.indexCount * indexSize(header.indexType);
+
+    std::vector<MeshFileAttribute> attributes;
+    for (const VertexAttribute &attribute : layout.attributes())
+        attributes.push_back({(uint32_t)attribute.semantic, attribute.location, (uint32_t)attribute.format, attribute.offset});
+
+    std::ofstream file(path, std::ios::binary);
+    const auto pad = [&file](const uint64_t offset) {
+        static const char zeros[MESH_FILE_ALIGNMENT] = {};
+        file.write(zeros, (std::streamsize)(offset - (uint64_t)file.tellp()));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(attributes.data()), (std::streamsize)(attributes.size() * sizeof(MeshFileAttribute)));
+    file.write(reinterpret_cast<const char*>(submeshes.data()), (std::streamsize)(submeshes.size() * sizeof(MeshFileSubmesh)));
+    for (const Mesh &part : parts)
+        file.write(reinterpret_cast<const char*>(part.meshlets.data()), (std::streamsize)(part.meshlets.size() * sizeof(Meshlet)));
+    pad(header.vertexOffset);
+    for (const Mesh &part : parts)
+        file.write(reinterpret_cast<const char*>(part.vertices.data()), (std::streamsize)part.vertices.size());
+    pad(header.indexOffset);
+    for (const Mesh &part : parts)
+    {
+        if (part.indexType == header.indexType)
+            file.write(reinterpret_cast<const char*>(part.indices.data()), (std::streamsize)part.indices.size());
+        else
+        {
+            const std::vector<uint32_t> wide = unpackIndices(part);
+            file.write(reinterpret_cast<const char*>(wide.data()), (std::streamsize)(wide.size() * sizeof(uint32_t)));
+        }
+    }
+    file.close();
+    if (!file)
+    {
+        std::cout << "ERROR::MESH_FILE::WRITE_FAILED: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+MeshFile::MeshFile(const std::string &path) : file(path)
+{
+    if (!file.valid())
+        return;
+
+    const auto fail = [&path](const char *error) {
+        std::cout << "ERROR::MESH_FILE::" << error << ": " << path << std::endl;
+    };
+    const size_t size = file.size();
+    if (size < sizeof(MeshFileHeader) || std::memcmp(file.data(), "MESH", 4) != 0)
+    {
+        fail("NOT_A_MESH_FILE");
+        return;
+    }
+    const auto *fileHeader = reinterpret_cast<const MeshFileHeader*>(file.data());
+    if (fileHeader->version != MESH_FILE_VERSION)
+    {
+        std::cout << "ERROR::MESH_FILE::VERSION: " << path << " is version " << fileHeader->version << ", expected "
+                  << MESH_FILE_VERSION << " (convert it again with meshc)" << std::endl;
+        return;
+    }
+    const MeshFileHeader &h = *fileHeader;
+
+    // every table and blob inside the file, the blobs aligned and exactly as large as their counts say
+    if (h.attributeCount > 16 || (h.indexType != GL_UNSIGNED_SHORT && h.indexType != GL_UNSIGNED_INT)
+        || !inFile(h.attributeOffset, (uint64_t)h.attributeCount * sizeof(MeshFileAttribute), size)
+        || !inFile(h.submeshOffset, (uint64_t)h.submeshCount * sizeof(MeshFileSubmesh), size)
+        || !inFile(h.meshletOffset, (uint64_t)h.meshletCount * sizeof(Meshlet), size)
+        || !inFile(h.vertexOffset, h.vertexBytes, size) || !inFile(h.indexOffset, h.indexBytes, size)
+        || h.attributeOffset % alignof(MeshFileAttribute) != 0 || h.submeshOffset % alignof(MeshFileSubmesh) != 0
+        || h.meshletOffset % alignof(Meshlet) != 0
+        || h.vertexOffset % MESH_FILE_ALIGNMENT != 0 || h.indexOffset % MESH_FILE_ALIGNMENT != 0
+        || h.vertexBytes != (uint64_t)h.vertexCount * h.vertexSize || h.indexBytes != (uint64_t)h.indexCount * indexSize(h.indexType))
+    {
+        fail("CORRUPT");
+        return;
+    }
+
+    // the layout is rebuilt, and must assign the offsets the writer saw
+    const auto *attributes = reinterpret_cast<const MeshFileAttribute*>(file.data() + h.attributeOffset);
+    std::vector<VertexAttribute> attributeList;
+    for (uint32_t i = 0; i < h.attributeCount; i++)
+    {
+        if (attributes[i].semantic > (uint32_t)VertexSemantic::INSTANCE || attributes[i].format > (uint32_t)VertexFormat::OCT_10_10_10_2)
+        {
+            fail("UNKNOWN_ATTRIBUTE");
+            return;
+        }
+        attributeList.push_back({(VertexSemantic)attributes[i].semantic, attributes[i].location, (VertexFormat)attributes[i].format});
+    }
+    VertexLayout layout(std::move(attributeList));
+    bool sameOffsets = layout.stride() == h.vertexSize;
+    for (uint32_t i = 0; i < h.attributeCount; i++)
+        sameOffsets &= layout.attributes()[i].offset == attributes[i].offset;
+    if (!sameOffsets)
+    {
+        fail("LAYOUT_MISMATCH");
+        return;
+    }
+
+    // the submeshes' ranges and their meshlets' (a small table); the indices themselves are trusted, reading them
+    // all would touch every page up front
+    const auto *submeshTable = reinterpret_cast<const MeshFileSubmesh*>(file.data() + h.submeshOffset);
+    const auto *meshletTable = reinterpret_cast<const Meshlet*>(file.data() + h.meshletOffset);
+    for (uint32_t i = 0; i < h.submeshCount; i++)
+    {
+        const MeshFileSubmesh &submesh = submeshTable[i];
+        bool valid = (uint64_t)submesh.firstIndex + submesh.indexCount <= h.indexCount
+                     && (uint64_t)submesh.baseVertex + submesh.vertexCount <= h.vertexCount && (i != 0 || submesh.lod == 0)
+                     && (uint64_t)submesh.firstMeshlet + submesh.meshletCount <= h.meshletCount;
+        for (uint32_t m = 0; valid && m < submesh.meshletCount; m++)
+        {
+            const Meshlet &meshlet = meshletTable[submesh.firstMeshlet + m];
+            valid = (uint64_t)meshlet.firstIndex + (uint64_t)meshlet.triangleCount * 3 <= submesh.indexCount;
+        }
+        if (!valid)
+        {
+            fail("CORRUPT_SUBMESH");
+            return;
+        }
+    }
+
+    header = fileHeader;
+    submeshes = submeshTable;
+    meshlets = meshletTable;
+    vertexLayout = std::move(layout);
+}
+
+size_t MeshFile::lodCount(const size_t submesh) const
+{
+    size_t count = 1;
+    while (submesh + count < header->submeshCount && submeshes[submesh + count].lod != 0)
+        count++;
+    return count;
+}
+
+MeshView MeshFile::view(const size_t submesh) const
+{
+    const MeshFileSubmesh &range = submeshes[submesh];
+    MeshView view;
+    view.vertexSize = header->vertexSize;
+    view.vertexCount = range.vertexCount;
+    view.vertices = file.data() + header->vertexOffset + (size_t)range.baseVertex * header->vertexSize;
+    view.indexType = header->indexType;
+    view.indexCount = range.indexCount;
+    view.indices = file.data() + header->indexOffset + (size_t)range.firstIndex * indexSize(header->indexType);
+    std::memcpy(&view.positionTransform[0][0], header->positionTransform, sizeof(header->positionTransform));
+    view.meshlets = meshlets + range.firstMeshlet;
+    view.meshletCount = range.meshletCount;
+    return view;
+}
@@ -0,0 +1,889 @@
+#include "mesh_importer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "parallel.h"
+
+namespace {
+    constexpr uint32_t NONE = ~0u;
+    // vertices filled per task when interleaving
+    constexpr size_t VERTEX_BLOCK = 1 << 16;
+
+    VertexLayout importLayout(const bool normals, const bool texcoords)
+    {
+        if (normals && texcoords)
+            return {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3},
+                    {VertexSemantic::NORMAL, 1, VertexFormat::FLOAT3},
+                    {VertexSemantic::TEXCOORD, 2, VertexFormat::FLOAT2}};
+        if (normals)
+            return {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3},
+                    {VertexSemantic::NORMAL, 1, VertexFormat::FLOAT3}};
+        if (texcoords)
+            return {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3},
+                    {VertexSemantic::TEXCOORD, 2, VertexFormat::FLOAT2}};
+        return {{VertexSemantic::POSITION, 0, VertexFormat::FLOAT3}};
+    }
+
+    unsigned int offsetOf(const VertexLayout &layout, const VertexSemantic semantic)
+    {
+        const VertexAttribute *attribute = layout.find(semantic);
+        return attribute != nullptr ? attribute->offset : NONE;
+    }
+
+
+    // ---- Wavefront OBJ
+
+    // a face corner: indices into the file's position, texcoord and normal lists (NONE when absent)
+    struct ObjCorner
+    {
+        uint32_t position, texcoord, normal;
+
+        bool operator==(const ObjCorner &other) const
+        {
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+    };
+
+    // Negative indices count back from the last element read, which a chunk only knows relative to its own
+    // start: they are stored flagged, biased so that they can point into earlier chunks, and resolved at merge
+    constexpr uint32_t RELATIVE = 0x80000000u;
+    constexpr int64_t RELATIVE_BIAS = 0x40000000;
+
+    struct ObjChunk
+    {
+        const char *begin, *end;
+        std::vector<float> positions, texcoords, normals;
+        std::vector<ObjCorner> corners;     // 3 per triangle, polygons fan-triangulated
+        bool failed = false;
+
+        // welded: the chunk's distinct corners, which of them each corner is, and where they went in the mesh
+        std::vector<ObjCorner> unique;
+        std::vector<uint32_t> cornerIds;
+        std::vector<uint32_t> remap;
+        std::vector<std::vector<uint32_t>> byShard;    // the distinct corners each merge shard takes
+        size_t cornerOffset = 0;
+    };
+
+    // the cross-chunk merge welds in this many shards, picked by the top bits of hashCorner; a constant rather than
+    // one per worker so that the vertex order does not depend on the machine
+    constexpr unsigned int MERGE_SHARD_BITS = 6;
+    constexpr size_t MERGE_SHARDS = size_t(1) << MERGE_SHARD_BITS;
+
+    uint32_t hashCorner(const ObjCorner &corner)
+    {
+        uint32_t hash = corner.position * 0x9E3779B1u ^ corner.texcoord * 0x85EBCA77u ^ corner.normal * 0xC2B2AE3Du;
+        hash ^= hash >> 15;
+        hash *= 0x2C1B3C6Du;
+        return hash ^ hash >> 13;
+    }
+
+    // open addressing on hashCorner, at most half full
+    class CornerTable
+    {
+    public:
+        explicit CornerTable(const size_t count)
+        {
+            size_t size = 16;
+            while (size < count * 2)
+                size <<= 1;
+            slots.assign(size, NONE);
+        }
+
+        // the id of corner in ids, adding it as ids.size() if it is new
+        uint32_t insert(const ObjCorner &corner, std::vector<ObjCorner> &ids)
+        {
+            const size_t mask = slots.size() - 1;
+            size_t slot = hashCorner(corner) & mask;
+            while (slots[slot] != NONE)
+            {
+                if (ids[slots[slot]] == corner)
+                    return slots[slot];
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = (uint32_t)ids.size();
+            ids.push_back(corner);
+            return slots[slot];
+        }
+
+    private:
+        std::vector<uint32_t> slots;
+    };
+
+    bool isBlank(const char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    const char* skipBlanks(const char *p, const char *end)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+        return p;
+    }
+
+    bool parseFloat(const char *&p, const char *end, float &value)
+    {
+        p = skipBlanks(p, end);
+        if (p < end && *p == '+')
+            p++;
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // reads a 1-based (or negative, relative) OBJ index, stored as described at RELATIVE
+    bool parseIndex(const char *&p, const char *end, const size_t localCount, uint32_t &index)
+    {
+        long long value = 0;
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value == 0)
+            return false;
+        p = result.ptr;
+        if (value > 0)
+        {
+            index = value <= (long long)RELATIVE ? (uint32_t)(value - 1) : NONE;
+            return index != NONE;
+        }
+        const int64_t local = (int64_t)localCount + value;
+        if (local < -RELATIVE_BIAS)
+            return false;
+        index = RELATIVE | (uint32_t)(local + RELATIVE_BIAS);
+        return true;
+    }
+
+    void parseObjChunk(ObjChunk &chunk)
+    {
+        std::vector<ObjCorner> polygon;
+        const char *end = chunk.end;
+        for (const char *line = chunk.begin; line < end; )
+        {
+            const char *next = static_cast<const char*>(std::memchr(line, '\n', (size_t)(end - line)));
+            next = next != nullptr ? next + 1 : end;
+
+            const char *p = skipBlanks(line, next);
+            bool valid = true;
+            if (next - p > 2 && p[0] == 'v' && isBlank(p[1]))
+            {
+                float position[3];
+                p += 1;
+                valid = parseFloat(p, next, position[0]) && parseFloat(p, next, position[1]) && parseFloat(p, next, position[2]);
+                chunk.positions.insert(chunk.positions.end(), position, position + 3);
+            }
+            else if (next - p > 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+            {
+                float texcoord[2] = {0.0f, 0.0f};
+                p += 2;
+                valid = parseFloat(p, next, texcoord[0]);
+                parseFloat(p, next, texcoord[1]);   // optional
+                chunk.texcoords.insert(chunk.texcoords.end(), texcoord, texcoord + 2);
+            }
+            else if (next - p > 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+            {
+                float normal[3];
+                p += 2;
+                valid = parseFloat(p, next, normal[0]) && parseFloat(p, next, normal[1]) && parseFloat(p, next, normal[2]);
+                chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+            }
+            else if (next - p > 2 && p[0] == 'f' && isBlank(p[1]))
+            {
+                // v, v/vt, v//vn or v/vt/vn per corner
+                polygon.clear();
+                p = skipBlanks(p + 1, next);
+                while (valid && p < next && *p != '\n' && *p != '\r' && *p != '#')
+                {
+                    ObjCorner corner = {NONE, NONE, NONE};
+                    valid = parseIndex(p, next, chunk.positions.size() / 3, corner.position);
+                    if (valid && p < next && *p == '/')
+                    {
+                        p++;
+                        if (p < next && *p != '/')
+                            valid = parseIndex(p, next, chunk.texcoords.size() / 2, corner.texcoord);
+                        if (valid && p < next && *p == '/')
+                        {
+                            p++;
+                            valid = parseIndex(p, next, chunk.normals.size() / 3, corner.normal);
+                        }
+                    }
+                    polygon.push_back(corner);
+                    p = skipBlanks(p, next);
+                }
+                for (size_t i = 2; valid && i < polygon.size(); i++)
+                    chunk.corners.insert(chunk.corners.end(), {polygon[0], polygon[i - 1], polygon[i]});
+            }
+
+            if (!valid && !chunk.failed)
+            {
+                const char *lineEnd = next;
+                while (lineEnd > line && (lineEnd[-1] == '\n' || lineEnd[-1] == '\r'))
+                    lineEnd--;
+                std::cout << "ERROR::IMPORT::OBJ_SYNTAX: " << std::string_view(line, (size_t)(lineEnd - line)) << std::endl;
+                chunk.failed = true;
+            }
+            line = next;
+        }
+    }
+
+    // turns a chunk-relative index into a file index; false if it points outside the file's list
+    bool resolveIndex(uint32_t &index, const size_t base, const size_t total)
+    {
+        if (index == NONE)
+            return true;
+        if ((index & RELATIVE) != 0)
+        {
+            const int64_t resolved = (int64_t)(index & ~RELATIVE) - RELATIVE_BIAS + (int64_t)base;
+            if (resolved < 0)
+                return false;
+            index = (uint32_t)resolved;
+        }
+        return index < total;
+    }
+
+
+    // ---- glTF binary
+
+    // The subset of JSON glTF needs, parsed into a tree (the JSON chunk is small next to the binary one)
+    struct Json
+    {
+        enum class Type { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT } type = Type::NONE;
+        double number = 0.0;
+        std::string string;
+        std::vector<Json> items;
+        std::vector<std::pair<std::string, Json>> members;
+
+        const Json* member(const char *key) const
+        {
+            for (const auto &entry : members)
+                if (entry.first == key)
+                    return &entry.second;
+            return nullptr;
+        }
+        const Json* item(const size_t index) const
+        {
+            return index < items.size() ? &items[index] : nullptr;
+        }
+        // a missing key gives the fallback; anything but a whole number below 2^32 - 1 gives NONE
+        size_t indexOr(const char *key, const size_t fallback) const
+        {
+            const Json *value = member(key);
+            if (value == nullptr)
+                return fallback;
+            if (value->type != Type::NUMBER || !(value->number >= 0.0 && value->number < (double)NONE)
+                || value->number != std::floor(value->number))
+                return NONE;
+            return (size_t)value->number;
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+        JsonParser(const char *begin, const char *end) : p(begin), end(end) {}
+
+        bool parse(Json &root)
+        {
+            return value(root, 0) && (skipSpaces(), p == end);
+        }
+
+    private:
+        static constexpr int MAX_DEPTH = 64;
+        const char *p, *end;
+
+        void skipSpaces()
+        {
+            while (p < end && std::isspace((unsigned char)*p))
+                p++;
+        }
+
+        bool literal(const char *word)
+        {
+            const size_t length = std::strlen(word);
+            if ((size_t)(end - p) < length || std::memcmp(p, word, length) != 0)
+                return false;
+            p += length;
+            return true;
+        }
+
+        bool string(std::string &out)
+        {
+            if (p == end || *p != '"')
+                return false;
+            p++;
+            while (p < end && *p != '"')
+            {
+                if (*p != '\\')
+                {
+                    out += *p++;
+                    continue;
+                }
+                if (++p == end)
+                    return false;
+                const char escape = *p++;
+                switch (escape)
+                {
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u':
+                    {
+                        unsigned int code = 0;
+                        if (end - p < 4 || std::from_chars(p, p + 4, code, 16).ptr != p + 4)
+                            return false;
+                        p += 4;
+                        // UTF-8, surrogate pairs left as they are (glTF names and keys are not affected)
+                        if (code < 0x80)
+                            out += (char)code;
+                        else if (code < 0x800)
+                            out += {(char)(0xC0 | code >> 6), (char)(0x80 | (code & 0x3F))};
+                        else
+                            out += {(char)(0xE0 | code >> 12), (char)(0x80 | (code >> 6 & 0x3F)), (char)(0x80 | (code & 0x3F))};
+                        break;
+                    }
+                    default: out += escape; break;
+                }
+            }
+            if (p == end)
+                return false;
+            p++;
+            return true;
+        }
+
+        bool value(Json &out, const int depth)
+        {
+            skipSpaces();
+            if (p == end || depth > MAX_DEPTH)
+                return false;
+            switch (*p)
+            {
+                case '{':
+                {
+                    out.type = Json::Type::OBJECT;
+                    p++;
+                    skipSpaces();
+                    if (p < end && *p == '}')
+                        return ++p, true;
+                    while (true)
+                    {
+                        std::pair<std::string, Json> member;
+                        skipSpaces();
+                        if (!string(member.first))
+                            return false;
+                        skipSpaces();
+                        if (p == end || *p++ != ':' || !value(member.second, depth + 1))
+                            return false;
+                        out.members.push_back(std::move(member));
+                        skipSpaces();
+                        if (p < end && *p == ',')
+                            p++;
+                        else
+                            return p < end && *p++ == '}';
+                    }
+                }
+                case '[':
+                {
+                    out.type = Json::Type::ARRAY;
+                    p++;
+                    skipSpaces();
+                    if (p < end && *p == ']')
+                        return ++p, true;
+                    while (true)
+                    {
+                        out.items.emplace_back();
+                        if (!value(out.items.back(), depth + 1))
+                            return false;
+                        skipSpaces();
+                        if (p < end && *p == ',')
+                            p++;
+                        else
+                            return p < end && *p++ == ']';
+                    }
+                }
+                case '"':
+                    out.type = Json::Type::STRING;
+                    return string(out.string);
+                case 't':
+                    out.type = Json::Type::BOOLEAN;
+                    out.number = 1.0;
+                    return literal("true");
+                case 'f':
+                    out.type = Json::Type::BOOLEAN;
+                    return literal("false");
+                case 'n':
+                    return literal("null");
+                default:
+                {
+                    out.type = Json::Type::NUMBER;
+                    const std::from_chars_result result = std::from_chars(p, end, out.number);
+                    if (result.ec != std::errc())
+                        return false;
+                    p = result.ptr;
+                    return true;
+                }
+            }
+        }
+    };
+
+    constexpr uint32_t GLB_MAGIC = 0x46546C67;         // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;    // "JSON"
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;     // "BIN\0"
+
+    constexpr int GLTF_BYTE = 5120;
+    constexpr int GLTF_UNSIGNED_BYTE = 5121;
+    constexpr int GLTF_SHORT = 5122;
+    constexpr int GLTF_UNSIGNED_SHORT = 5123;
+    constexpr int GLTF_UNSIGNED_INT = 5125;
+    constexpr int GLTF_FLOAT = 5126;
+    constexpr int GLTF_TRIANGLES = 4;
+
+    uint32_t readU32(const unsigned char *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // where an accessor's elements are in the binary chunk
+    struct AccessorView
+    {
+        const unsigned char *data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+        bool normalized = false;
+    };
+
+    bool accessorView(const Json &gltf, const size_t accessor, const unsigned char *bin, const size_t binSize,
+                      AccessorView &view)
+    {
+        const Json *accessors = gltf.member("accessors");
+        const Json *bufferViews = gltf.member("bufferViews");
+        const Json *description = accessors != nullptr ? accessors->item(accessor) : nullptr;
+        if (description == nullptr || bufferViews == nullptr)
+            return false;
+        if (description->member("sparse") != nullptr)
+        {
+            std::cout << "ERROR::IMPORT::GLB_SPARSE_ACCESSOR" << std::endl;
+            return false;
+        }
+        const Json *bufferView = bufferViews->item(description->indexOr("bufferView", NONE));
+        const Json *type = description->member("type");
+        if (bufferView == nullptr || type == nullptr)
+            return false;
+        if (bufferView->indexOr("buffer", 0) != 0 || bin == nullptr)
+        {
+            std::cout << "ERROR::IMPORT::GLB_EXTERNAL_BUFFER" << std::endl;
+            return false;
+        }
+
+        const std::string &typeName = type->string;
+        view.components = typeName == "SCALAR" ? 1 : typeName == "VEC2" ? 2 : typeName == "VEC3" ? 3 : typeName == "VEC4" ? 4 : 0;
+        view.componentType = (int)description->indexOr("componentType", 0);
+        const size_t componentSize = view.componentType == GLTF_BYTE || view.componentType == GLTF_UNSIGNED_BYTE ? 1
+                                     : view.componentType == GLTF_SHORT || view.componentType == GLTF_UNSIGNED_SHORT ? 2
+                                     : view.componentType == GLTF_UNSIGNED_INT || view.componentType == GLTF_FLOAT ? 4 : 0;
+        const Json *normalized = description->member("normalized");
+        view.normalized = normalized != nullptr && normalized->number != 0.0;
+        view.count = description->indexOr("count", 0);
+
+        const size_t elementSize = componentSize * (size_t)view.components;
+        view.stride = bufferView->indexOr("byteStride", elementSize);
+        const size_t offset = bufferView->indexOr("byteOffset", 0) + description->indexOr("byteOffset", 0);
+        const size_t viewEnd = bufferView->indexOr("byteOffset", 0) + bufferView->indexOr("byteLength", 0);
+        const size_t limit = std::min(viewEnd, binSize);
+        // the last element must end inside the view, checked without forming count * stride
+        if (elementSize == 0 || view.stride < elementSize
+            || (view.count > 0 && (offset > limit || elementSize > limit - offset
+                                   || view.count - 1 > (limit - offset - elementSize) / view.stride)))
+        {
+            std::cout << "ERROR::IMPORT::GLB_BAD_ACCESSOR: " << accessor << std::endl;
+            return false;
+        }
+        view.data = bin + offset;
+        return true;
+    }
+
+    // copies count elements of a float or normalized integer accessor into the interleaved vertices
+    void copyAttribute(const AccessorView &view, const int components, unsigned char *vertices,
+                       const unsigned int vertexSize, const unsigned int attributeOffset)
+    {
+        const size_t blocks = (view.count + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+        parallelFor(blocks, [&](const size_t block) {
+            const size_t first = block * VERTEX_BLOCK, last = std::min(view.count, first + VERTEX_BLOCK);
+            for (size_t i = first; i < last; i++)
+            {
+                const unsigned char *element = view.data + i * view.stride;
+                float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                if (view.componentType == GLTF_FLOAT)
+                    std::memcpy(value, element, sizeof(float) * (size_t)components);
+                else if (view.componentType == GLTF_UNSIGNED_BYTE)
+                    for (int c = 0; c < components; c++)
+                        value[c] = (float)element[c] / 255.0f;
+                else if (view.componentType == GLTF_UNSIGNED_SHORT)
+                    for (int c = 0; c < components; c++)
+                    {
+                        uint16_t component;
+                        std::memcpy(&component, element + c * sizeof(component), sizeof(component));
+                        value[c] = (float)component / 65535.0f;
+                    }
+                std::memcpy(vertices + i * vertexSize + attributeOffset, value, sizeof(float) * (size_t)components);
+            }
+        });
+    }
+
+    bool isFloatAccessor(const AccessorView &view, const int components)
+    {
+        return view.componentType == GLTF_FLOAT && view.components == components;
+    }
+
+    bool isTexcoordAccessor(const AccessorView &view)
+    {
+        return view.components == 2 && (view.componentType == GLTF_FLOAT
+               || (view.normalized && (view.componentType == GLTF_UNSIGNED_BYTE || view.componentType == GLTF_UNSIGNED_SHORT)));
+    }
+
+    // glTF indices are unsigned scalars
+    bool isIndexAccessor(const AccessorView &view)
+    {
+        return view.components == 1 && (view.componentType == GLTF_UNSIGNED_BYTE
+               || view.componentType == GLTF_UNSIGNED_SHORT || view.componentType == GLTF_UNSIGNED_INT);
+    }
+}
+
+bool importMesh(const std::string &path, ImportedMesh &out, const unsigned int threads)
+{
+    std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) { return (char)std::tolower(c); });
+    if (extension != ".obj" && extension != ".glb")
+    {
+        std::cout << "ERROR::IMPORT::UNSUPPORTED_FORMAT: " << path << std::endl;
+        return false;
+    }
+
+    const MappedFile file(path);
+    if (!file.valid())
+        return false;
+    if (extension == ".obj")
+        return importObj(reinterpret_cast<const char*>(file.data()), file.size(), out, threads);
+    return importGlb(file.data(), file.size(), out);
+}
+
+bool importObj(const char *data, const size_t size, ImportedMesh &out, const unsigned int threads)
+{
+    // a few chunks per worker even out lines of uneven cost; small files are not worth splitting
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+    size_t chunkCount = threads != 0 ? threads : (size_t)workerCount() * 4;
+    chunkCount = std::max<size_t>(1, std::min(chunkCount, size / MIN_CHUNK_BYTES));
+
+    // 1. split at line boundaries and parse every chunk
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *end = data + size;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        const char *begin = i == 0 ? data : chunks[i - 1].end;
+        const char *split = i + 1 == chunkCount ? end : std::max(begin, data + size * (i + 1) / chunkCount);
+        const char *newline = static_cast<const char*>(std::memchr(split, '\n', (size_t)(end - split)));
+        chunks[i].begin = begin;
+        chunks[i].end = i + 1 == chunkCount || newline == nullptr ? end : newline + 1;
+    }
+    parallelFor(chunkCount, [&](const size_t i) { parseObjChunk(chunks[i]); });
+
+    // 2. each chunk's indices become file indices, now that the counts before it are known
+    std::vector<size_t> positionBase(chunkCount + 1, 0), texcoordBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0);
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        if (chunks[i].failed)
+            return false;
+        positionBase[i + 1] = positionBase[i] + chunks[i].positions.size() / 3;
+        texcoordBase[i + 1] = texcoordBase[i] + chunks[i].texcoords.size() / 2;
+        normalBase[i + 1] = normalBase[i] + chunks[i].normals.size() / 3;
+        chunks[i].cornerOffset = i == 0 ? 0 : chunks[i - 1].cornerOffset + chunks[i - 1].corners.size();
+    }
+    const size_t cornerCount = chunkCount > 0 ? chunks.back().cornerOffset + chunks.back().corners.size() : 0;
+    if (cornerCount > NONE || positionBase[chunkCount] >= RELATIVE)
+    {
+        std::cout << "ERROR::IMPORT::OBJ_TOO_LARGE" << std::endl;
+        return false;
+    }
+
+    std::vector<char> resolved(chunkCount, 1), usesTexcoords(chunkCount, 0), usesNormals(chunkCount, 0);
+    parallelFor(chunkCount, [&](const size_t i) {
+        for (ObjCorner &corner : chunks[i].corners)
+        {
+            resolved[i] &= resolveIndex(corner.position, positionBase[i], positionBase[chunkCount])
+                           & resolveIndex(corner.texcoord, texcoordBase[i], texcoordBase[chunkCount])
+                           & resolveIndex(corner.normal, normalBase[i], normalBase[chunkCount]);
+            usesTexcoords[i] |= corner.texcoord != NONE;
+            usesNormals[i] |= corner.normal != NONE;
+        }
+    });
+    if (std::find(resolved.begin(), resolved.end(), 0) != resolved.end())
+    {
+        std::cout << "ERROR::IMPORT::OBJ_INDEX_OUT_OF_RANGE" << std::endl;
+        return false;
+    }
+    const bool texcoords = std::find(usesTexcoords.begin(), usesTexcoords.end(), 1) != usesTexcoords.end();
+    const bool normals = std::find(usesNormals.begin(), usesNormals.end(), 1) != usesNormals.end();
+
+    out.layout = importLayout(normals, texcoords);
+    Mesh &mesh = out.mesh;
+    mesh = Mesh();
+    mesh.vertexSize = out.layout.stride();
+    std::vector<uint32_t> indices(cornerCount);
+
+    // 3a. positions only: the position list is the vertex buffer, the position indices are the index buffer
+    if (!texcoords && !normals)
+    {
+        mesh.vertices.resize(positionBase[chunkCount] * mesh.vertexSize);
+        parallelFor(chunkCount, [&](const size_t i) {
+            const ObjChunk &chunk = chunks[i];
+            std::memcpy(mesh.vertices.data() + positionBase[i] * mesh.vertexSize, chunk.positions.data(),
+                        chunk.positions.size() * sizeof(float));
+            for (size_t c = 0; c < chunk.corners.size(); c++)
+                indices[chunk.cornerOffset + c] = chunk.corners[c].position;
+        });
+        packIndices(mesh, indices);
+        return true;
+    }
+
+    // 3b. otherwise every distinct corner is a vertex: weld within each chunk in parallel...
+    parallelFor(chunkCount, [&](const size_t i) {
+        ObjChunk &chunk = chunks[i];
+        CornerTable table(chunk.corners.size());
+        chunk.cornerIds.resize(chunk.corners.size());
+        for (size_t c = 0; c < chunk.corners.size(); c++)
+            chunk.cornerIds[c] = table.insert(chunk.corners[c], chunk.unique);
+    });
+
+    // ...then merge the chunks' distinct corners into the mesh's vertices, sharded by hash so that every shard welds
+    // on its own: first each chunk sorts its corners by shard...
+    parallelFor(chunkCount, [&](const size_t i) {
+        ObjChunk &chunk = chunks[i];
+        chunk.remap.resize(chunk.unique.size());
+        chunk.byShard.assign(MERGE_SHARDS, {});
+        for (size_t u = 0; u < chunk.unique.size(); u++)
+            chunk.byShard[hashCorner(chunk.unique[u]) >> (32 - MERGE_SHARD_BITS)].push_back((uint32_t)u);
+    });
+
+    // ...each shard welds its corners, in file order, into its own vertices...
+    std::vector<std::vector<ObjCorner>> shardVertices(MERGE_SHARDS);
+    parallelFor(MERGE_SHARDS, [&](const size_t shard) {
+        size_t shardCount = 0;
+        for (const ObjChunk &chunk : chunks)
+            shardCount += chunk.byShard[shard].size();
+        CornerTable table(shardCount);
+        for (ObjChunk &chunk : chunks)
+            for (const uint32_t u : chunk.byShard[shard])
+                chunk.remap[u] = table.insert(chunk.unique[u], shardVertices[shard]);
+    });
+
+    // ...and the shards' vertices are laid end to end, their ids offset by the vertices of the shards before
+    std::vector<size_t> shardBase(MERGE_SHARDS + 1, 0);
+    for (size_t shard = 0; shard < MERGE_SHARDS; shard++)
+        shardBase[shard + 1] = shardBase[shard] + shardVertices[shard].size();
+    std::vector<ObjCorner> vertices(shardBase[MERGE_SHARDS]);
+    parallelFor(MERGE_SHARDS, [&](const size_t shard) {
+        std::copy(shardVertices[shard].begin(), shardVertices[shard].end(), vertices.begin() + (long)shardBase[shard]);
+    });
+    parallelFor(chunkCount, [&](const size_t i) {
+        ObjChunk &chunk = chunks[i];
+        for (size_t shard = 1; shard < MERGE_SHARDS; shard++)
+            for (const uint32_t u : chunk.byShard[shard])
+                chunk.remap[u] += (uint32_t)shardBase[shard];
+    });
+
+    // 4. remap the indices and interleave the vertices
+    parallelFor(chunkCount, [&](const size_t i) {
+        const ObjChunk &chunk = chunks[i];
+        for (size_t c = 0; c < chunk.cornerIds.size(); c++)
+            indices[chunk.cornerOffset + c] = chunk.remap[chunk.cornerIds[c]];
+    });
+
+    // the attribute lists stay split by chunk, so a file index is looked up in the chunk that read it
+    const auto lookup = [&](const std::vector<size_t> &base, const uint32_t index) {
+        return (size_t)(std::upper_bound(base.begin(), base.end(), (size_t)index) - base.begin() - 1);
+    };
+    const unsigned int normalOffset = offsetOf(out.layout, VertexSemantic::NORMAL);
+    const unsigned int texcoordOffset = offsetOf(out.layout, VertexSemantic::TEXCOORD);
+    mesh.vertices.assign(vertices.size() * mesh.vertexSize, 0);
+    parallelFor((vertices.size() + VERTEX_BLOCK - 1) / VERTEX_BLOCK, [&](const size_t block) {
+        const size_t first = block * VERTEX_BLOCK, last = std::min(vertices.size(), first + VERTEX_BLOCK);
+        for (size_t v = first; v < last; v++)
+        {
+            const ObjCorner &corner = vertices[v];
+            unsigned char *vertex = mesh.vertices.data() + v * mesh.vertexSize;
+            size_t chunk = lookup(positionBase, corner.position);
+            std::memcpy(vertex, &chunks[chunk].positions[(corner.position - positionBase[chunk]) * 3], 3 * sizeof(float));
+            if (normalOffset != NONE && corner.normal != NONE)
+            {
+                chunk = lookup(normalBase, corner.normal);
+                std::memcpy(vertex + normalOffset, &chunks[chunk].normals[(corner.normal - normalBase[chunk]) * 3],
+                            3 * sizeof(float));
+            }
+            if (texcoordOffset != NONE && corner.texcoord != NONE)
+            {
+                chunk = lookup(texcoordBase, corner.texcoord);
+                std::memcpy(vertex + texcoordOffset, &chunks[chunk].texcoords[(corner.texcoord - texcoordBase[chunk]) * 2],
+                            2 * sizeof(float));
+            }
+        }
+    });
+    packIndices(mesh, indices);
+    return true;
+}
+
+bool importGlb(const unsigned char *data, const size_t size, ImportedMesh &out)
+{
+    // 12-byte header, then the JSON chunk and the optional binary chunk, each with an 8-byte header
+    if (size < 20 || readU32(data) != GLB_MAGIC || readU32(data + 4) != 2 || readU32(data + 8) > size
+        || readU32(data + 16) != GLB_CHUNK_JSON)
+    {
+        std::cout << "ERROR::IMPORT::GLB_HEADER" << std::endl;
+        return false;
+    }
+    const size_t length = readU32(data + 8);
+    const size_t jsonLength = readU32(data + 12);
+    if (20 + jsonLength > length)
+    {
+        std::cout << "ERROR::IMPORT::GLB_HEADER" << std::endl;
+        return false;
+    }
+    const unsigned char *bin = nullptr;
+    size_t binSize = 0;
+    const size_t binChunk = 20 + (jsonLength + 3) / 4 * 4;
+    if (binChunk + 8 <= length && readU32(data + binChunk + 4) == GLB_CHUNK_BIN)
+    {
+        bin = data + binChunk + 8;
+        binSize = std::min<size_t>(readU32(data + binChunk), length - binChunk - 8);
+    }
+
+    Json gltf;
+    const char *json = reinterpret_cast<const char*>(data + 20);
+    if (!JsonParser(json, json + jsonLength).parse(gltf) || gltf.type != Json::Type::OBJECT)
+    {
+        std::cout << "ERROR::IMPORT::GLB_JSON" << std::endl;
+        return false;
+    }
+
+    // 1. every triangle primitive of every mesh, and the attributes they have
+    struct Primitive
+    {
+        AccessorView positions, normals, texcoords, indices;
+        size_t baseVertex = 0, firstIndex = 0;
+    };
+    std::vector<Primitive> primitives;
+    size_t vertexCount = 0, indexCount = 0;
+    bool normals = false, texcoords = false;
+    const Json *meshes = gltf.member("meshes");
+    for (size_t m = 0; meshes != nullptr && m < meshes->items.size(); m++)
+    {
+        const Json *meshPrimitives = meshes->items[m].member("primitives");
+        for (size_t p = 0; meshPrimitives != nullptr && p < meshPrimitives->items.size(); p++)
+        {
+            const Json &description = meshPrimitives->items[p];
+            const Json *attributes = description.member("attributes");
+            if (description.indexOr("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || attributes == nullptr
+                || attributes->member("POSITION") == nullptr)
+            {
+                std::cout << "ERROR::IMPORT::GLB_PRIMITIVE_SKIPPED: mesh " << m << ", primitive " << p << std::endl;
+                continue;
+            }
+
+            Primitive primitive;
+            if (!accessorView(gltf, attributes->indexOr("POSITION", NONE), bin, binSize, primitive.positions)
+                || !isFloatAccessor(primitive.positions, 3))
+                return false;
+            if (attributes->member("NORMAL") != nullptr
+                && (!accessorView(gltf, attributes->indexOr("NORMAL", NONE), bin, binSize, primitive.normals)
+                    || !isFloatAccessor(primitive.normals, 3) || primitive.normals.count != primitive.positions.count))
+                return false;
+            if (attributes->member("TEXCOORD_0") != nullptr
+                && (!accessorView(gltf, attributes->indexOr("TEXCOORD_0", NONE), bin, binSize, primitive.texcoords)
+                    || !isTexcoordAccessor(primitive.texcoords) || primitive.texcoords.count != primitive.positions.count))
+                return false;
+            if (description.member("indices") != nullptr
+                && (!accessorView(gltf, description.indexOr("indices", NONE), bin, binSize, primitive.indices)
+                    || !isIndexAccessor(primitive.indices)))
+                return false;
+
+            primitive.baseVertex = vertexCount;
+            primitive.firstIndex = indexCount;
+            vertexCount += primitive.positions.count;
+            indexCount += primitive.indices.data != nullptr ? primitive.indices.count : primitive.positions.count;
+            normals |= primitive.normals.data != nullptr;
+            texcoords |= primitive.texcoords.data != nullptr;
+            primitives.push_back(primitive);
+        }
+    }
+    if (vertexCount > NONE || indexCount > NONE)
+    {
+        std::cout << "ERROR::IMPORT::GLB_TOO_LARGE" << std::endl;
+        return false;
+    }
+
+    // 2. read the accessors in place into the interleaved vertices and the index buffer
+    out.layout = importLayout(normals, texcoords);
+    Mesh &mesh = out.mesh;
+    mesh = Mesh();
+    mesh.vertexSize = out.layout.stride();
+    mesh.vertices.assign(vertexCount * mesh.vertexSize, 0);
+    std::vector<uint32_t> indices(indexCount);
+    std::atomic<bool> inRange{true};
+    for (const Primitive &primitive : primitives)
+    {
+        unsigned char *vertices = mesh.vertices.data() + primitive.baseVertex * mesh.vertexSize;
+        copyAttribute(primitive.positions, 3, vertices, mesh.vertexSize, 0);
+        if (primitive.normals.data != nullptr)
+            copyAttribute(primitive.normals, 3, vertices, mesh.vertexSize, offsetOf(out.layout, VertexSemantic::NORMAL));
+        if (primitive.texcoords.data != nullptr)
+            copyAttribute(primitive.texcoords, 2, vertices, mesh.vertexSize, offsetOf(out.layout, VertexSemantic::TEXCOORD));
+
+        const AccessorView &view = primitive.indices;
+        const size_t count = view.data != nullptr ? view.count : primitive.positions.count;
+        uint32_t *primitiveIndices = indices.data() + primitive.firstIndex;
+        parallelFor((count + VERTEX_BLOCK - 1) / VERTEX_BLOCK, [&](const size_t block) {
+            const size_t first = block * VERTEX_BLOCK, last = std::min(count, first + VERTEX_BLOCK);
+            bool valid = true;
+            for (size_t i = first; i < last; i++)
+            {
+                uint32_t index = (uint32_t)i;
+                if (view.componentType == GLTF_UNSIGNED_BYTE)
+                    index = view.data[i * view.stride];
+                else if (view.componentType == GLTF_UNSIGNED_SHORT)
+                {
+                    uint16_t shortIndex;
+                    std::memcpy(&shortIndex, view.data + i * view.stride, sizeof(shortIndex));
+                    index = shortIndex;
+                }
+                else if (view.componentType == GLTF_UNSIGNED_INT)
+                    std::memcpy(&index, view.data + i * view.stride, sizeof(index));
+                valid &= index < primitive.positions.count;
+                primitiveIndices[i] = (uint32_t)primitive.baseVertex + index;
+            }
+            if (!valid)
+                inRange = false;
+        });
+    }
+    if (!inRange)
+    {
+        std::cout << "ERROR::IMPORT::GLB_INDEX_OUT_OF_RANGE" << std::endl;
+        return false;
+    }
+
+    packIndices(mesh, indices);
+    return true;
+}
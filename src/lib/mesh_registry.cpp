@@ -0,0 +1,193 @@
+#include "mesh_registry.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+    // replaces buffer with a larger one holding the same first usedBytes
+    void growBuffer(unsigned int &buffer, const size_t usedBytes, const size_t newBytes)
+    {
+        unsigned int grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        // immutable storage that only glBufferSubData and copies write to
+        glBufferStorage(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newBytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        if (buffer != 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)usedBytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = grown;
+    }
+
+    // the capacity to grow to for needed elements: at least double, so that adding N meshes copies O(N) data
+    size_t grownCapacity(const size_t capacity, const size_t needed, const size_t minimum)
+    {
+        return std::max({needed, capacity * 2, minimum});
+    }
+
+    uint32_t readIndex(const MeshView &mesh, const size_t i)
+    {
+        if (mesh.indexType == GL_UNSIGNED_SHORT)
+        {
+            uint16_t index;
+            std::memcpy(&index, mesh.indices + i * sizeof(index), sizeof(index));
+            return index;
+        }
+        uint32_t index;
+        std::memcpy(&index, mesh.indices + i * sizeof(index), sizeof(index));
+        return index;
+    }
+}
+
+MeshRegistry::MeshRegistry(VertexLayout layout, const GLenum indexType)
+    : vertexLayout(std::move(layout)), indexFormat(indexType),
+      indexSize(indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t))
+{
+}
+
+int MeshRegistry::add(const MeshView &mesh)
+{
+    if (mesh.vertexSize != vertexLayout.stride())
+    {
+        std::cout << "ERROR::MESH_REGISTRY::LAYOUT_MISMATCH: " << mesh.vertexSize << " byte vertices, expected "
+                  << vertexLayout.stride() << std::endl;
+        return -1;
+    }
+    const size_t vertexCount = mesh.vertexCount;
+    if (indexFormat == GL_UNSIGNED_SHORT && vertexCount > 0x10000)
+    {
+        std::cout << "ERROR::MESH_REGISTRY::TOO_MANY_VERTICES: " << vertexCount << " vertices for 16-bit indices" << std::endl;
+        return -1;
+    }
+
+    // indices stay relative to the mesh (baseVertex offsets them), only their width may change
+    std::vector<unsigned char> converted;
+    const unsigned char *indices = mesh.indices;
+    if (mesh.indexType != indexFormat)
+    {
+        converted.resize(mesh.indexCount * (size_t)indexSize);
+        for (size_t i = 0; i < mesh.indexCount; i++)
+        {
+            const uint32_t index = readIndex(mesh, i);
+            if (indexFormat == GL_UNSIGNED_SHORT)
+            {
+                const uint16_t narrow = (uint16_t)index;
+                std::memcpy(converted.data() + i * sizeof(narrow), &narrow, sizeof(narrow));
+            }
+            else
+                std::memcpy(converted.data() + i * sizeof(index), &index, sizeof(index));
+        }
+        indices = converted.data();
+    }
+
+    const size_t stride = vertexLayout.stride();
+    if (vertexUsed + vertexCount > vertexCapacity)
+    {
+        const size_t capacity = grownCapacity(vertexCapacity, vertexUsed + vertexCount, 4096);
+        growBuffer(vertexBuffer, vertexUsed * stride, capacity * stride);
+        vertexCapacity = capacity;
+    }
+    if (indexUsed + mesh.indexCount > indexCapacity)
+    {
+        const size_t capacity = grownCapacity(indexCapacity, indexUsed + mesh.indexCount, 16384);
+        growBuffer(indexBuffer, indexUsed * indexSize, capacity * indexSize);
+        indexCapacity = capacity;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertexUsed * stride), (GLsizeiptr)(vertexCount * stride), mesh.vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(indexUsed * indexSize), (GLsizeiptr)(mesh.indexCount * (size_t)indexSize),
+                    indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    ranges.push_back({(unsigned int)indexUsed, mesh.indexCount, (int)vertexUsed, (unsigned int)vertexCount,
+                      mesh.positionTransform, (unsigned int)meshletTable.size(), (unsigned int)mesh.meshletCount});
+    meshletTable.insert(meshletTable.end(), mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+    vertexUsed += vertexCount;
+    indexUsed += mesh.indexCount;
+    return (int)ranges.size() - 1;
+}
+
+void MeshRegistry::reserve(const size_t vertexCount, const size_t indexCount)
+{
+    if (vertexUsed + vertexCount > vertexCapacity)
+    {
+        growBuffer(vertexBuffer, vertexUsed * vertexLayout.stride(), (vertexUsed + vertexCount) * vertexLayout.stride());
+        vertexCapacity = vertexUsed + vertexCount;
+    }
+    if (indexUsed + indexCount > indexCapacity)
+    {
+        growBuffer(indexBuffer, indexUsed * indexSize, (indexUsed + indexCount) * indexSize);
+        indexCapacity = indexUsed + indexCount;
+    }
+}
+
+void MeshRegistry::bind(const Pipeline &pipeline) const
+{
+    pipeline.setVertexBuffer(vertexBuffer);
+    pipeline.setIndexBuffer(indexBuffer);
+}
+
+DrawElementsIndirectCommand MeshRegistry::command(const int mesh, const unsigned int instanceCount,
+                                                  const unsigned int baseInstance) const
+{
+    const MeshRange &meshRange = range(mesh);
+    return {meshRange.indexCount, instanceCount, meshRange.firstIndex, meshRange.baseVertex, baseInstance};
+}
+
+void MeshRegistry::draw(const int mesh, const unsigned int instanceCount, const unsigned int baseInstance) const
+{
+    const MeshRange &meshRange = range(mesh);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, (int)meshRange.indexCount, indexFormat,
+                                                  (const void*)((size_t)meshRange.firstIndex * indexSize),
+                                                  (int)instanceCount, meshRange.baseVertex, baseInstance);
+}
+
+void MeshRegistry::release()
+{
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    vertexBuffer = indexBuffer = 0;
+    vertexCapacity = vertexUsed = indexCapacity = indexUsed = 0;
+    ranges.clear();
+    meshletTable.clear();
+}
+
+void IndirectDrawList::submit(const MeshRegistry &registry)
+{
+    if (commands.empty())
+        return;
+
+    if (indirectBuffer == 0)
+        glGenBuffers(1, &indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    // reallocating (or orphaning) the storage means the upload never waits for the previous frame's draws
+    const GLsizeiptr bytes = (GLsizeiptr)(commands.size() * sizeof(DrawElementsIndirectCommand));
+    if (commands.size() > capacity)
+    {
+        capacity = std::max(commands.size(), capacity * 2);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(capacity * sizeof(DrawElementsIndirectCommand)), nullptr,
+                     GL_STREAM_DRAW);
+    }
+    void *mapped = glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    std::memcpy(mapped, commands.data(), (size_t)bytes);
+    glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, registry.indexType(), nullptr, (int)commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectDrawList::release()
+{
+    glDeleteBuffers(1, &indirectBuffer);
+    indirectBuffer = 0;
+    capacity = 0;
+}
@@ -0,0 +1,452 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+#include "parallel.h"
+
+namespace {
+    constexpr uint32_t NONE = ~0u;
+
+    // open border and seam edges are held in place by planes through them, perpendicular to their triangle,
+    // weighted this much more than the triangle planes
+    constexpr double EDGE_WEIGHT = 10.0;
+    // a level that keeps more than this of what it should remove has stalled on locked vertices
+    constexpr float STALLED = 0.5f;
+    // LODs below this many triangles are not worth a draw of their own
+    constexpr size_t MIN_LOD_TRIANGLES = 16;
+
+    // How a vertex may move: MANIFOLD anywhere, BORDER and SEAM only along their edge loop, LOCKED not at all
+    enum VertexKind : uint8_t { MANIFOLD, BORDER, SEAM, LOCKED };
+
+    // The squared distance to a set of planes, as a symmetric 4x4 matrix (A, b, c), summed over planes with weights
+    struct Quadric
+    {
+        double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+        double weight = 0.0;
+
+        void addPlane(const glm::dvec3 &n, const double d, const double w)
+        {
+            a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+            a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric &q)
+        {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+            weight += q.weight;
+            return *this;
+        }
+
+        // weighted mean squared distance of p to the planes
+        double error(const glm::vec3 &p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double sum = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                               + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return weight > 0.0 ? std::abs(sum) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from, to;
+        float error;
+    };
+
+    struct PositionKey
+    {
+        uint32_t bits[3];
+        bool operator==(const PositionKey &other) const
+        {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionHash
+    {
+        size_t operator()(const PositionKey &key) const
+        {
+            return (size_t)(key.bits[0] * 73856093u ^ key.bits[1] * 19349663u ^ key.bits[2] * 83492791u);
+        }
+    };
+
+    uint64_t edgeKey(const uint32_t a, const uint32_t b)
+    {
+        return (uint64_t)a << 32 | b;
+    }
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const std::vector<uint32_t> &indices, const unsigned char *vertices, const size_t vertexCount,
+                   const unsigned int vertexSize, const unsigned int positionOffset)
+            : indices(indices), positions(vertexCount), remap(vertexCount), wedge(vertexCount),
+              kind(vertexCount), loop(vertexCount), loopBack(vertexCount), quadrics(vertexCount),
+              collapseTo(vertexCount), locked(vertexCount)
+        {
+            // positions scaled into the unit cube, so that the quadrics are well conditioned whatever the mesh size
+            glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                std::memcpy(&positions[v], vertices + v * vertexSize + positionOffset, sizeof(glm::vec3));
+                minimum = glm::min(minimum, positions[v]);
+                maximum = glm::max(maximum, positions[v]);
+            }
+            extent = std::max({maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z, FLT_MIN});
+            for (glm::vec3 &position : positions)
+                position = (position - minimum) / extent;
+
+            // vertices at the same position (seams) are chained into a ring of wedges, and share one quadric
+            std::unordered_map<PositionKey, uint32_t, PositionHash> first;
+            first.reserve(vertexCount);
+            for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+            {
+                PositionKey key{};
+                const glm::vec3 position = positions[v] + 0.0f;  // -0 is +0
+                std::memcpy(key.bits, &position, sizeof(key.bits));
+                const auto found = first.emplace(key, v);
+                remap[v] = found.first->second;
+                wedge[v] = v;
+                if (!found.second)
+                {
+                    wedge[v] = wedge[remap[v]];
+                    wedge[remap[v]] = v;
+                }
+            }
+
+            classify();
+            buildQuadrics();
+        }
+
+        // collapses edges, cheapest first, until the target index count or error is reached
+        std::vector<uint32_t> run(const size_t targetIndexCount, const float targetError, float &resultError)
+        {
+            const double errorLimit = (double)targetError / extent * ((double)targetError / extent);
+            double largest = 0.0;
+            while (indices.size() > targetIndexCount)
+            {
+                if (pass(targetIndexCount, errorLimit, largest) == 0)
+                    break;
+                classify();
+            }
+            resultError = (float)(std::sqrt(largest) * extent);
+            return indices;
+        }
+
+    private:
+        std::vector<uint32_t> indices;
+        std::vector<glm::vec3> positions;
+        float extent = 1.0f;
+        std::vector<uint32_t> remap;        // the first vertex at the same position
+        std::vector<uint32_t> wedge;        // the next vertex at the same position (itself when alone)
+        std::vector<VertexKind> kind;
+        std::vector<uint32_t> loop, loopBack;   // the open edge leaving and entering a BORDER/SEAM vertex
+        std::vector<char> openEdge;         // per triangle corner: whether the edge to the next corner is open
+        std::vector<Quadric> quadrics;      // by remap
+        std::vector<uint32_t> collapseTo;
+        std::vector<char> locked;
+        std::vector<uint32_t> triangleOffsets, vertexTriangles;     // triangles around each vertex
+
+        void classify()
+        {
+            const size_t vertexCount = positions.size();
+            std::vector<uint64_t> edges, positionEdges;
+            edges.reserve(indices.size());
+            positionEdges.reserve(indices.size());
+            for (size_t i = 0; i < indices.size(); i += 3)
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+                    edges.push_back(edgeKey(a, b));
+                    positionEdges.push_back(edgeKey(remap[a], remap[b]));
+                }
+            std::sort(edges.begin(), edges.end());
+            std::sort(positionEdges.begin(), positionEdges.end());
+
+            // an edge is open when no triangle has it the other way round: between vertices it is a seam or a
+            // border, between positions only a border
+            std::vector<uint8_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+            std::vector<char> border(vertexCount, 0);
+            std::fill(loop.begin(), loop.end(), NONE);
+            std::fill(loopBack.begin(), loopBack.end(), NONE);
+            openEdge.assign(indices.size(), 0);
+            for (size_t i = 0; i < indices.size(); i += 3)
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+                    if (!std::binary_search(edges.begin(), edges.end(), edgeKey(b, a)))
+                    {
+                        openEdge[i + k] = 1;
+                        openOut[a] = (uint8_t)std::min(openOut[a] + 1, 2);
+                        openIn[b] = (uint8_t)std::min(openIn[b] + 1, 2);
+                        loop[a] = b;
+                        loopBack[b] = a;
+                    }
+                    if (!std::binary_search(positionEdges.begin(), positionEdges.end(), edgeKey(remap[b], remap[a])))
+                        border[remap[a]] = border[remap[b]] = 1;
+                }
+
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                const uint32_t other = wedge[v];
+                const bool simpleLoop = openOut[v] == 1 && openIn[v] == 1;
+                if (other == v)
+                    kind[v] = !border[remap[v]] && openOut[v] == 0 && openIn[v] == 0 ? MANIFOLD
+                              : border[remap[v]] && simpleLoop ? BORDER : LOCKED;
+                else if (wedge[other] == v && !border[remap[v]] && simpleLoop && openOut[other] == 1 && openIn[other] == 1)
+                    kind[v] = SEAM;
+                else
+                    kind[v] = LOCKED;
+            }
+
+            // triangles around each vertex
+            triangleOffsets.assign(vertexCount + 1, 0);
+            for (const uint32_t index : indices)
+                triangleOffsets[index + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                triangleOffsets[v + 1] += triangleOffsets[v];
+            vertexTriangles.resize(indices.size());
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                vertexTriangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+
+        void buildQuadrics()
+        {
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const uint32_t corners[3] = {indices[i], indices[i + 1], indices[i + 2]};
+                const glm::dvec3 p0(positions[corners[0]]), p1(positions[corners[1]]), p2(positions[corners[2]]);
+                glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const double area = glm::length(normal);
+                if (area == 0.0)
+                    continue;
+                normal /= area;
+
+                Quadric plane;
+                plane.addPlane(normal, -glm::dot(normal, p0), area * 0.5);
+                for (const uint32_t corner : corners)
+                    quadrics[remap[corner]] += plane;
+
+                // border and seam edges: the vertex loop continues through them
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint32_t a = corners[k], b = corners[(k + 1) % 3];
+                    if (!openEdge[i + k])
+                        continue;
+                    const glm::dvec3 pa(positions[a]), edge = glm::dvec3(positions[b]) - pa;
+                    const double length = glm::length(edge);
+                    if (length == 0.0)
+                        continue;
+                    const glm::dvec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                    Quadric edgePlane;
+                    edgePlane.addPlane(edgeNormal, -glm::dot(edgeNormal, pa), length * EDGE_WEIGHT);
+                    quadrics[remap[a]] += edgePlane;
+                    quadrics[remap[b]] += edgePlane;
+                }
+            }
+        }
+
+        // the vertex at to's position that continues from's other wedge along the seam
+        uint32_t seamPartner(const uint32_t from, const uint32_t to) const
+        {
+            const uint32_t other = wedge[from];
+            if (loop[other] != NONE && remap[loop[other]] == remap[to])
+                return loop[other];
+            if (loopBack[other] != NONE && remap[loopBack[other]] == remap[to])
+                return loopBack[other];
+            return NONE;
+        }
+
+        bool canCollapse(const uint32_t from, const uint32_t to) const
+        {
+            if (remap[from] == remap[to])
+                return false;
+            switch (kind[from])
+            {
+                case MANIFOLD:
+                    return true;
+                case BORDER:
+                    return (loop[from] == to || loopBack[from] == to) && (kind[to] == BORDER || kind[to] == LOCKED);
+                case SEAM:
+                    return (loop[from] == to || loopBack[from] == to) && (kind[to] == SEAM || kind[to] == LOCKED)
+                           && seamPartner(from, to) != NONE;
+                default:
+                    return false;
+            }
+        }
+
+        // whether moving from onto to turns one of from's remaining triangles over (or almost)
+        bool flips(const uint32_t from, const uint32_t to) const
+        {
+            const glm::vec3 &target = positions[to];
+            for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++)
+            {
+                const size_t triangle = (size_t)vertexTriangles[t] * 3;
+                int corner = 0;
+                while (indices[triangle + corner] != from)
+                    corner++;
+                const uint32_t b = indices[triangle + (corner + 1) % 3], c = indices[triangle + (corner + 2) % 3];
+                // triangles across the collapsed edge disappear
+                if (remap[b] == remap[to] || remap[c] == remap[to])
+                    continue;
+
+                const glm::vec3 &pb = positions[b], &pc = positions[c];
+                const glm::vec3 before = glm::cross(pb - positions[from], pc - positions[from]);
+                const glm::vec3 after = glm::cross(pb - target, pc - target);
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+                    return true;
+            }
+            return false;
+        }
+
+        void lockAround(const uint32_t vertex)
+        {
+            for (uint32_t t = triangleOffsets[vertex]; t < triangleOffsets[vertex + 1]; t++)
+                for (int k = 0; k < 3; k++)
+                    locked[indices[(size_t)vertexTriangles[t] * 3 + k]] = 1;
+        }
+
+        // one round of independent collapses (no two touch the same triangles); returns how many were done
+        size_t pass(const size_t targetIndexCount, const double errorLimit, double &largest)
+        {
+            std::vector<Collapse> collapses;
+            collapses.reserve(indices.size());
+            for (size_t i = 0; i < indices.size(); i += 3)
+                for (int k = 0; k < 3; k++)
+                {
+                    const uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+                    // each edge once (from the triangle that has it as a < b, or the only one)
+                    if (a > b && kind[a] == MANIFOLD && kind[b] == MANIFOLD)
+                        continue;
+
+                    Quadric quadric = quadrics[remap[a]];
+                    quadric += quadrics[remap[b]];
+                    const bool ab = canCollapse(a, b), ba = canCollapse(b, a);
+                    const float errorAb = ab ? (float)quadric.error(positions[b]) : FLT_MAX;
+                    const float errorBa = ba ? (float)quadric.error(positions[a]) : FLT_MAX;
+                    if (ab || ba)
+                        collapses.push_back(errorAb <= errorBa ? Collapse{a, b, errorAb} : Collapse{b, a, errorBa});
+                }
+            std::sort(collapses.begin(), collapses.end(),
+                      [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+
+            // a manifold collapse removes two triangles, so this many collapses about reach the target
+            const size_t goal = std::max<size_t>((indices.size() - targetIndexCount) / 6, 1);
+            std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+            std::fill(locked.begin(), locked.end(), 0);
+            size_t done = 0;
+            for (const Collapse &collapse : collapses)
+            {
+                if (done >= goal || collapse.error > errorLimit)
+                    break;
+                const uint32_t from = collapse.from, to = collapse.to;
+                const uint32_t otherFrom = kind[from] == SEAM ? wedge[from] : NONE;
+                const uint32_t otherTo = kind[from] == SEAM ? seamPartner(from, to) : NONE;
+                if (locked[from] || locked[to] || (otherFrom != NONE && (locked[otherFrom] || locked[otherTo])))
+                    continue;
+                if (flips(from, to) || (otherFrom != NONE && flips(otherFrom, otherTo)))
+                    continue;
+
+                collapseTo[from] = to;
+                lockAround(from);
+                if (otherFrom != NONE)
+                {
+                    collapseTo[otherFrom] = otherTo;
+                    lockAround(otherFrom);
+                }
+                quadrics[remap[to]] += quadrics[remap[from]];
+                largest = std::max(largest, (double)collapse.error);
+                done++;
+            }
+
+            // re-index, dropping the triangles that collapsed to a line
+            size_t kept = 0;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const uint32_t a = collapseTo[indices[i]], b = collapseTo[indices[i + 1]], c = collapseTo[indices[i + 2]];
+                if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+                    continue;
+                indices[kept] = a;
+                indices[kept + 1] = b;
+                indices[kept + 2] = c;
+                kept += 3;
+            }
+            indices.resize(kept);
+            return done;
+        }
+    };
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t> &indices, const unsigned char *vertices,
+                                   const size_t vertexCount, const unsigned int vertexSize,
+                                   const unsigned int positionOffset, const size_t targetIndexCount,
+                                   const float targetError, float *resultError)
+{
+    float error = 0.0f;
+    std::vector<uint32_t> simplified = indices.size() > targetIndexCount
+        ? Simplifier(indices, vertices, vertexCount, vertexSize, positionOffset).run(targetIndexCount, targetError, error)
+        : indices;
+    if (resultError != nullptr)
+        *resultError = error;
+    return simplified;
+}
+
+std::vector<MeshLod> generateLods(const Mesh &mesh, const unsigned int positionOffset, const unsigned int maxLevels,
+                                  const float ratio)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back({unpackIndices(mesh), 0.0f});
+    while (lods.size() < maxLevels)
+    {
+        const MeshLod &last = lods.back();
+        const size_t triangles = last.indices.size() / 3;
+        const auto target = (size_t)((float)triangles * ratio);
+        if (target < MIN_LOD_TRIANGLES)
+            break;
+
+        // each level is simplified from the previous one (much cheaper than from LOD 0), so its error adds up
+        float error;
+        std::vector<uint32_t> indices = simplifyMesh(last.indices, mesh.vertices.data(), mesh.vertexCount(), mesh.vertexSize,
+                                                     positionOffset, target * 3, FLT_MAX, &error);
+        if ((float)indices.size() / 3.0f > (float)target + STALLED * (float)(triangles - target))
+            break;
+        lods.push_back({std::move(indices), last.error + error});
+    }
+    return lods;
+}
+
+std::vector<std::vector<MeshLod>> generateLodChains(const std::vector<const Mesh*> &meshes,
+                                                    const unsigned int positionOffset, const unsigned int maxLevels,
+                                                    const float ratio)
+{
+    std::vector<std::vector<MeshLod>> chains(meshes.size());
+    parallelFor(meshes.size(), [&](const size_t i) {
+        chains[i] = generateLods(*meshes[i], positionOffset, maxLevels, ratio);
+    });
+    return chains;
+}
+
+Mesh extractLod(const Mesh &mesh, const std::vector<uint32_t> &indices, const std::vector<glm::vec3> &positions)
+{
+    Mesh lod;
+    lod.vertexSize = mesh.vertexSize;
+    lod.vertices = mesh.vertices;
+    lod.positionTransform = mesh.positionTransform;
+
+    std::vector<uint32_t> optimized = optimizeVertexCache(indices, mesh.vertexCount());
+    lod.meshlets = buildMeshlets(optimized, positions);
+    optimizeVertexFetch(lod.vertices, lod.vertexSize, optimized);
+    packIndices(lod, optimized);
+    return lod;
+}
@@ -0,0 +1,282 @@
+#include "meshlet_culler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "cube_field.h"
+#include "cull_blocks.h"
+#include "shader_blocks.h"
+#include "simd.h"
+
+namespace {
+    using Lanes = simd::Lanes;
+
+    // largest scale of the 3x3 part, the uniform scale for the transforms culled here
+    float scaleOf(const glm::mat4 &transform)
+    {
+        return std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                         glm::length(glm::vec3(transform[2]))});
+    }
+}
+
+MeshletCuller::MeshletCuller(const MeshRegistry &registry) : registry(registry)
+{
+}
+
+void MeshletCuller::setView(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition)
+{
+    frustumPlanes(viewProj, planes);
+    camera = cameraPosition;
+}
+
+void MeshletCuller::sync()
+{
+    const std::vector<Meshlet> &meshlets = registry.meshlets();
+    if (synced == meshlets.size())
+        return;
+
+    const size_t padded = meshlets.size() + Lanes::WIDTH - 1;
+    for (std::vector<float> *component : {&centerX, &centerY, &centerZ, &radius, &axisX, &axisY, &axisZ, &cutoff})
+        component->assign(padded, 0.0f);
+    for (size_t i = 0; i < meshlets.size(); i++)
+    {
+        centerX[i] = meshlets[i].center.x;
+        centerY[i] = meshlets[i].center.y;
+        centerZ[i] = meshlets[i].center.z;
+        radius[i] = meshlets[i].radius;
+        axisX[i] = meshlets[i].coneAxis.x;
+        axisY[i] = meshlets[i].coneAxis.y;
+        axisZ[i] = meshlets[i].coneAxis.z;
+        cutoff[i] = meshlets[i].coneCutoff;
+    }
+    synced = meshlets.size();
+}
+
+MeshletCoverage MeshletCuller::cull(const int mesh, const glm::mat4 &model)
+{
+    sync();
+    const MeshRange &range = registry.range(mesh);
+    culledMesh = mesh;
+    visible.assign(range.meshletCount, 1);
+    if (range.meshletCount == 0)
+        return MeshletCoverage::ALL;
+
+    // the planes and the camera in the space of the bounds; distances there are the world's divided by scale
+    const float scale = scaleOf(model);
+    glm::vec4 local[6];
+    for (int i = 0; i < 6; i++)
+        local[i] = planes[i] * model / scale;
+    const glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(camera, 1.0f));
+
+    const Meshlet *meshlets = registry.meshlets().data() + range.firstMeshlet;
+    size_t kept = 0;
+    for (size_t first = 0; first < range.meshletCount; first += Lanes::WIDTH)
+    {
+        // the frustum test is FrustumCuller's, on the meshlets' bounding spheres
+        const size_t m = range.firstMeshlet + first;
+        const simd::SphereBlock<Lanes> block(m, centerX.data(), centerY.data(), centerZ.data(), radius.data());
+        const unsigned int outside = Lanes::bits(block.outside(local));
+
+        // backfacing when dot(view, axis) >= cutoff * |view| + radius, view from the camera to the center
+        const Lanes::V vx = Lanes::sub(block.cx, Lanes::set(eye.x));
+        const Lanes::V vy = Lanes::sub(block.cy, Lanes::set(eye.y));
+        const Lanes::V vz = Lanes::sub(block.cz, Lanes::set(eye.z));
+        const Lanes::V length = Lanes::sqrt(Lanes::add(Lanes::add(Lanes::mul(vx, vx), Lanes::mul(vy, vy)), Lanes::mul(vz, vz)));
+        const Lanes::V along = Lanes::add(Lanes::add(Lanes::mul(vx, Lanes::load(&axisX[m])), Lanes::mul(vy, Lanes::load(&axisY[m]))),
+                                          Lanes::mul(vz, Lanes::load(&axisZ[m])));
+        const Lanes::V limit = Lanes::add(Lanes::mul(Lanes::load(&cutoff[m]), length), Lanes::load(&radius[m]));
+        const unsigned int backfacing = Lanes::bits(Lanes::lessEqual(limit, along)) & ~outside;
+
+        const size_t lanes = std::min<size_t>(Lanes::WIDTH, range.meshletCount - first);
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            const unsigned int triangles = meshlets[first + lane].triangleCount;
+            current.meshlets++;
+            current.triangles += triangles;
+            if ((outside | backfacing) & (1u << lane))
+            {
+                visible[first + lane] = 0;
+                current.trianglesCulled += triangles;
+                if (outside & (1u << lane))
+                    current.frustumCulled++;
+                else
+                    current.backfaceCulled++;
+            }
+            else
+                kept++;
+        }
+    }
+    return kept == 0 ? MeshletCoverage::NONE : kept == range.meshletCount ? MeshletCoverage::ALL : MeshletCoverage::SOME;
+}
+
+void MeshletCuller::addVisible(IndirectDrawList &draws, const unsigned int baseInstance) const
+{
+    const MeshRange &range = registry.range(culledMesh);
+    if (range.meshletCount == 0)
+    {
+        draws.add(registry.command(culledMesh, 1, baseInstance));
+        return;
+    }
+
+    // a meshlet's indices follow the previous one's, so a run of kept meshlets is one range of indices
+    const Meshlet *meshlets = registry.meshlets().data() + range.firstMeshlet;
+    for (size_t first = 0; first < range.meshletCount;)
+    {
+        if (!visible[first])
+        {
+            first++;
+            continue;
+        }
+        size_t end = first;
+        unsigned int count = 0;
+        while (end < range.meshletCount && visible[end]
+               && meshlets[end].firstIndex == meshlets[first].firstIndex + count)
+            count += meshlets[end++].triangleCount * 3;
+        draws.add({count, 1, range.firstIndex + meshlets[first].firstIndex, range.baseVertex, baseInstance});
+        first = end;
+    }
+}
+
+void MeshletCuller::endFrame()
+{
+    previous = current;
+    current = MeshletCullStats();
+}
+
+GpuMeshletCuller::GpuMeshletCuller(const MeshRegistry &registry, ShaderHandle program)
+    : registry(registry), program(std::move(program))
+{
+    this->program.onReady([this](const Shader &shader) {
+        uniforms.frustumPlanes = shader.uniform<glm::vec4>("frustumPlanes");
+        uniforms.cameraPosition = shader.uniform<glm::vec3>("cameraPosition");
+        uniforms.boundsTransform = shader.uniform<glm::mat4>("boundsTransform");
+        uniforms.boundsScale = shader.uniform<float>("boundsScale");
+        uniforms.firstMeshlet = shader.uniform<int>("firstMeshlet");
+        uniforms.meshletCount = shader.uniform<int>("meshletCount");
+        uniforms.instanceStride = shader.uniform<int>("instanceStride");
+        uniforms.instanceCount = shader.uniform<int>("instanceCount");
+        uniforms.firstInstance = shader.uniform<int>("firstInstance");
+        uniforms.firstIndex = shader.uniform<int>("firstIndex");
+        uniforms.baseVertex = shader.uniform<int>("baseVertex");
+        uniforms.maxDraws = shader.uniform<int>("maxDraws");
+    });
+    glGenBuffers(1, &meshletBuffer);
+    glGenBuffers(1, &drawBuffer);
+    glGenBuffers(1, &counterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(MeshletCountersBlock), nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuMeshletCuller::begin(const glm::mat4 &viewProj, const glm::vec3 &cameraPosition, const size_t draws)
+{
+    frustumPlanes(viewProj, planes);
+    camera = cameraPosition;
+    maxDraws = draws;
+    tested = testedTriangles = 0;
+
+    // the meshlets of every mesh, uploaded again when meshes were added
+    const std::vector<Meshlet> &meshlets = registry.meshlets();
+    if (meshletsUploaded != meshlets.size())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, meshletBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(std::max<size_t>(meshlets.size(), 1) * sizeof(Meshlet)),
+                     meshlets.data(), GL_STATIC_DRAW);
+        meshletsUploaded = meshlets.size();
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+    if (maxDraws > drawCapacity)
+    {
+        drawCapacity = std::max(maxDraws, drawCapacity * 2);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(drawCapacity * sizeof(DrawElementsIndirectCommand)), nullptr,
+                     GL_DYNAMIC_COPY);
+    }
+    // slots no draw is appended to stay zero-instance draws
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0,
+                         (GLsizeiptr)(std::max<size_t>(maxDraws, 1) * sizeof(DrawElementsIndirectCommand)), GL_RED_INTEGER,
+                         GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuMeshletCuller::cull(const int mesh, const unsigned int instanceBuffer, const GLintptr instanceOffset,
+                            const unsigned int firstInstance, const unsigned int count, const glm::mat4 &boundsTransform)
+{
+    const MeshRange &range = registry.range(mesh);
+    if (!ready() || range.meshletCount == 0 || count == 0)
+        return;
+    tested += (size_t)count * range.meshletCount;
+    for (unsigned int m = 0; m < range.meshletCount; m++)
+        testedTriangles += (size_t)count * registry.meshlets()[range.firstMeshlet + m].triangleCount;
+
+    program.get().use();
+    uniforms.frustumPlanes.set(planes, 6);
+    uniforms.cameraPosition.set(camera);
+    uniforms.boundsTransform.set(boundsTransform);
+    uniforms.boundsScale.set(scaleOf(boundsTransform));
+    uniforms.firstMeshlet.set((int)range.firstMeshlet);
+    uniforms.meshletCount.set((int)range.meshletCount);
+    uniforms.instanceStride.set((int)(sizeof(CubeInstance) / sizeof(float)));
+    uniforms.instanceCount.set((int)count);
+    uniforms.firstInstance.set((int)firstInstance);
+    uniforms.firstIndex.set((int)range.firstIndex);
+    uniforms.baseVertex.set(range.baseVertex);
+    uniforms.maxDraws.set((int)maxDraws);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshletBoundsBlock::BINDING, meshletBuffer);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MeshletInstancesBlock::BINDING, instanceBuffer, instanceOffset,
+                      (GLsizeiptr)((firstInstance + count) * sizeof(CubeInstance)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshletDrawsBlock::BINDING, drawBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshletCountersBlock::BINDING, counterBuffer);
+
+    const size_t invocations = (size_t)count * range.meshletCount;
+    glDispatchCompute((unsigned int)((invocations + 63) / 64), 1, 1);
+}
+
+void GpuMeshletCuller::draw() const
+{
+    if (maxDraws == 0)
+        return;
+
+    // the draws and their count were written by the dispatches
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBuffer);
+    if (GLAD_GL_VERSION_4_6)
+    {
+        glBindBuffer(GL_PARAMETER_BUFFER, counterBuffer);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, registry.indexType(), nullptr, 0, (GLsizei)maxDraws, 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+        glMultiDrawElementsIndirect(GL_TRIANGLES, registry.indexType(), nullptr, (GLsizei)maxDraws, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+MeshletCullStats GpuMeshletCuller::readStats() const
+{
+    MeshletCountersBlock counters{};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counters), &counters);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    MeshletCullStats stats;
+    stats.meshlets = tested;
+    stats.frustumCulled = counters.frustumCulled;
+    stats.backfaceCulled = counters.backfaceCulled;
+    stats.triangles = testedTriangles;
+    stats.trianglesCulled = testedTriangles - counters.visibleTriangles;
+    return stats;
+}
+
+void GpuMeshletCuller::release()
+{
+    glDeleteBuffers(1, &meshletBuffer);
+    glDeleteBuffers(1, &drawBuffer);
+    glDeleteBuffers(1, &counterBuffer);
+    meshletBuffer = drawBuffer = counterBuffer = 0;
+    meshletsUploaded = drawCapacity = 0;
+}
@@ -0,0 +1,225 @@
+#include "occlusion_culler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+#include "simd.h"
+
+namespace {
+    using Lanes = simd::Lanes;
+
+    constexpr int TILES_X = OcclusionCuller::WIDTH / OcclusionCuller::TILE_WIDTH;
+    constexpr int TILES_Y = OcclusionCuller::HEIGHT / OcclusionCuller::TILE_HEIGHT;
+    // below this many triangles the tiles are drawn on the calling thread alone
+    constexpr size_t PARALLEL_MIN = 256;
+    // a box covering more texels than this across, at some level, is tested a level up
+    constexpr int TEST_TEXELS = 4;
+
+    static_assert(OcclusionCuller::TILE_WIDTH % Lanes::WIDTH == 0, "a tile's rows are whole blocks");
+
+    // the pixel coordinates of a clip-space position, bottom left at 0
+    glm::vec2 toPixels(const glm::vec4 &clip)
+    {
+        return glm::vec2((clip.x / clip.w * 0.5f + 0.5f) * (float)OcclusionCuller::WIDTH,
+                         (clip.y / clip.w * 0.5f + 0.5f) * (float)OcclusionCuller::HEIGHT);
+    }
+
+    // the pixels of [minX, maxX] x [minY, maxY] inside a triangle, a block of a row at a time: each pixel's
+    // center is tested against the three edges, and those inside keep the nearer of their depth and the triangle's
+    template <typename L>
+    void rasterizeTriangle(const glm::vec3 edges[3], const glm::vec3 &plane, const int minX, const int minY,
+                           const int maxX, const int maxY, float *depth)
+    {
+        using V = typename L::V;
+        constexpr unsigned int LANES = (1u << L::WIDTH) - 1;
+        const V zero = L::set(0.0f);
+        const V edgeX0 = L::set(edges[0].x), edgeX1 = L::set(edges[1].x), edgeX2 = L::set(edges[2].x);
+        const V planeX = L::set(plane.x);
+        const int firstX = minX - minX % (int)L::WIDTH;
+        for (int y = minY; y <= maxY; y++)
+        {
+            const float centerY = (float)y + 0.5f;
+            const V row0 = L::set(edges[0].y * centerY + edges[0].z), row1 = L::set(edges[1].y * centerY + edges[1].z);
+            const V row2 = L::set(edges[2].y * centerY + edges[2].z), rowDepth = L::set(plane.y * centerY + plane.z);
+            float *pixels = depth + y * OcclusionCuller::WIDTH;
+            for (int x = firstX; x <= maxX; x += (int)L::WIDTH)
+            {
+                const V centerX = L::add(L::set((float)x + 0.5f), L::ramp());
+                const typename L::M outside = L::either(L::either(L::less(L::add(L::mul(edgeX0, centerX), row0), zero),
+                                                                  L::less(L::add(L::mul(edgeX1, centerX), row1), zero)),
+                                                        L::less(L::add(L::mul(edgeX2, centerX), row2), zero));
+                if (L::bits(outside) == LANES)
+                    continue;
+                const V old = L::load(pixels + x);
+                const V nearer = L::max(old, L::add(L::mul(planeX, centerX), rowDepth));
+                L::store(pixels + x, L::select(outside, old, nearer));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::begin(const glm::mat4 &frameViewProj)
+{
+    viewProj = frameViewProj;
+    triangles.clear();
+    bins.resize(TILES_X * TILES_Y);
+    for (std::vector<uint32_t> &bin : bins)
+        bin.clear();
+    if (levels.empty())
+        for (int level = 0; (WIDTH >> level) > 0 || (HEIGHT >> level) > 0; level++)
+            levels.emplace_back((size_t)std::max(1, WIDTH >> level) * std::max(1, HEIGHT >> level));
+    // 1 / w = 0: nothing, infinitely far
+    for (std::vector<float> &level : levels)
+        std::fill(level.begin(), level.end(), 0.0f);
+}
+
+void OcclusionCuller::addOccluder(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices,
+                                  const glm::mat4 &model)
+{
+    const glm::mat4 transform = viewProj * model;
+    clipPositions.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+        clipPositions[i] = transform * glm::vec4(positions[i], 1.0f);
+    current.occluders++;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec4 clip[3] = {clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]};
+        if (clip[0].z < -clip[0].w || clip[1].z < -clip[1].w || clip[2].z < -clip[2].w)
+            continue;
+        const glm::vec2 p[3] = {toPixels(clip[0]), toPixels(clip[1]), toPixels(clip[2])};
+        const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+        if (!(area > 0.0f))
+            continue;
+
+        // the pixels whose centers are inside the triangle's bounds
+        Triangle triangle;
+        const glm::vec2 low = glm::min(glm::min(p[0], p[1]), p[2]), high = glm::max(glm::max(p[0], p[1]), p[2]);
+        triangle.minX = std::max(0, (int)std::ceil(low.x - 0.5f));
+        triangle.minY = std::max(0, (int)std::ceil(low.y - 0.5f));
+        triangle.maxX = std::min(WIDTH - 1, (int)std::floor(high.x - 0.5f));
+        triangle.maxY = std::min(HEIGHT - 1, (int)std::floor(high.y - 0.5f));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            continue;
+
+        // edge k is opposite vertex k, and is its barycentric coordinate times area; 1 / w is interpolated
+        // with them, then lowered to the farthest it gets within half a pixel
+        triangle.depth = glm::vec3(0.0f);
+        for (int k = 0; k < 3; k++)
+        {
+            const glm::vec2 &a = p[(k + 1) % 3], &b = p[(k + 2) % 3];
+            triangle.edges[k] = glm::vec3(a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x);
+            triangle.depth += triangle.edges[k] * (1.0f / clip[k].w);
+        }
+        triangle.depth /= area;
+        triangle.depth.z -= 0.5f * (std::abs(triangle.depth.x) + std::abs(triangle.depth.y));
+
+        const uint32_t index = (uint32_t)triangles.size();
+        triangles.push_back(triangle);
+        for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+            for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+                bins[tileY * TILES_X + tileX].push_back(index);
+        current.triangles++;
+    }
+}
+
+void OcclusionCuller::rasterizeTile(const int tile)
+{
+    const int tileX = tile % TILES_X * TILE_WIDTH, tileY = tile / TILES_X * TILE_HEIGHT;
+    for (const uint32_t index : bins[tile])
+    {
+        const Triangle &triangle = triangles[index];
+        rasterizeTriangle<Lanes>(triangle.edges, triangle.depth, std::max(triangle.minX, tileX),
+                                 std::max(triangle.minY, tileY), std::min(triangle.maxX, tileX + TILE_WIDTH - 1),
+                                 std::min(triangle.maxY, tileY + TILE_HEIGHT - 1), levels[0].data());
+    }
+}
+
+void OcclusionCuller::rasterize()
+{
+    const auto start = std::chrono::steady_clock::now();
+    if (triangles.size() < PARALLEL_MIN || workerCount() == 1)
+        for (int tile = 0; tile < TILES_X * TILES_Y; tile++)
+            rasterizeTile(tile);
+    else
+        parallelFor(TILES_X * TILES_Y, [this](const size_t tile) { rasterizeTile((int)tile); });
+
+    // each texel the farthest of the 2x2 under it
+    for (size_t level = 1; level < levels.size(); level++)
+    {
+        const int width = std::max(1, WIDTH >> level), height = std::max(1, HEIGHT >> level);
+        const int belowWidth = std::max(1, WIDTH >> (level - 1)), belowHeight = std::max(1, HEIGHT >> (level - 1));
+        const float *below = levels[level - 1].data();
+        float *texels = levels[level].data();
+        for (int y = 0; y < height; y++)
+        {
+            const int y0 = std::min(2 * y, belowHeight - 1) * belowWidth, y1 = std::min(2 * y + 1, belowHeight - 1) * belowWidth;
+            for (int x = 0; x < width; x++)
+            {
+                const int x0 = std::min(2 * x, belowWidth - 1), x1 = std::min(2 * x + 1, belowWidth - 1);
+                texels[y * width + x] = std::min(std::min(below[y0 + x0], below[y0 + x1]),
+                                                 std::min(below[y1 + x0], below[y1 + x1]));
+            }
+        }
+    }
+    current.rasterMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionCuller::occluded(const Aabb &box) const
+{
+    // the box's screen bounds and its nearest 1 / w, the corners stepped from the first along the edges; a box
+    // reaching the near plane is never hidden
+    const glm::vec4 first = viewProj * glm::vec4(box.min, 1.0f);
+    const glm::vec3 size = box.max - box.min;
+    const glm::vec4 edgeX = viewProj[0] * size.x, edgeY = viewProj[1] * size.y, edgeZ = viewProj[2] * size.z;
+    glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+    float nearest = 0.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 clip = first;
+        if (corner & 1)
+            clip += edgeX;
+        if (corner & 2)
+            clip += edgeY;
+        if (corner & 4)
+            clip += edgeZ;
+        if (clip.z < -clip.w || clip.w <= 0.0f)
+            return false;
+        const float inverseW = 1.0f / clip.w;
+        const glm::vec2 pixel = (glm::vec2(clip) * inverseW * 0.5f + 0.5f) * glm::vec2(WIDTH, HEIGHT);
+        low = glm::min(low, pixel);
+        high = glm::max(high, pixel);
+        nearest = std::max(nearest, inverseW);
+    }
+    if (high.x < 0.0f || high.y < 0.0f || low.x >= (float)WIDTH || low.y >= (float)HEIGHT)
+        return false;
+
+    // every pixel the bounds touch, grown by half a pixel: occluders cover the pixels whose centers they do, so
+    // the pixels along their outline are only partly behind them. The box is tested at the first level where that
+    // is at most TEST_TEXELS texels across
+    int minX = std::max(0, (int)std::floor(low.x - 0.5f)), minY = std::max(0, (int)std::floor(low.y - 0.5f));
+    int maxX = std::min(WIDTH - 1, (int)std::floor(high.x + 0.5f)), maxY = std::min(HEIGHT - 1, (int)std::floor(high.y + 0.5f));
+    size_t level = 0;
+    while (level + 1 < levels.size() && (maxX - minX >= TEST_TEXELS || maxY - minY >= TEST_TEXELS))
+    {
+        level++;
+        minX >>= 1;
+        minY >>= 1;
+        maxX >>= 1;
+        maxY >>= 1;
+    }
+    const int width = std::max(1, WIDTH >> level);
+    const float *texels = levels[level].data();
+    for (int y = minY; y <= maxY; y++)
+        for (int x = minX; x <= maxX; x++)
+            if (!(nearest < texels[y * width + x]))
+                return false;
+    return true;
+}
+
+void OcclusionCuller::endFrame()
+{
+    previous = current;
+    current = OcclusionCullStats();
+}
@@ -0,0 +1,132 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    thread_local bool insideTask = false;
+
+    class ThreadPool
+    {
+    public:
+        ThreadPool()
+        {
+            const unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+            for (unsigned int i = 1; i < threads; i++)
+                workers.emplace_back([this]() { loop(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread &worker : workers)
+                worker.join();
+        }
+
+        unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+        void run(const size_t count, const std::function<void(size_t)> &task)
+        {
+            std::lock_guard<std::mutex> serial(submit);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = &task;
+                jobCount = count;
+                next = 0;
+                remaining = count;
+                generation++;
+            }
+            wake.notify_all();
+            work();
+
+            // workers still inside work() would read the next job's state, so wait for them to leave too
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return remaining == 0 && busy == 0; });
+            job = nullptr;
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex submit;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        bool stopping = false;
+        unsigned int generation = 0;
+        unsigned int busy = 0;
+
+        const std::function<void(size_t)> *job = nullptr;
+        size_t jobCount = 0;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> remaining{0};
+
+        void work()
+        {
+            insideTask = true;
+            for (size_t i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1))
+            {
+                (*job)(i);
+                if (remaining.fetch_sub(1) == 1)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+            insideTask = false;
+        }
+
+        void loop()
+        {
+            unsigned int seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                // a job that is already finished may be replaced any moment, so only join one with work left
+                if (remaining == 0)
+                    continue;
+                busy++;
+                lock.unlock();
+                work();
+                lock.lock();
+                busy--;
+                if (busy == 0)
+                    done.notify_all();
+            }
+        }
+    };
+
+    ThreadPool& pool()
+    {
+        static ThreadPool threadPool;
+        return threadPool;
+    }
+}
+
+void parallelFor(const size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 0)
+        return;
+    if (count == 1 || insideTask || workerCount() == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+    pool().run(count, task);
+}
+
+unsigned int workerCount()
+{
+    return pool().size();
+}
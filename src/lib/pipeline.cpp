@@ -0,0 +1,163 @@
+#include "pipeline.h"
+
+#include <utility>
+#include <vector>
+
+namespace {
+    // fixed-function state as last set by a Pipeline
+    struct BoundState
+    {
+        bool valid = false;
+        DepthState depth;
+        BlendState blend;
+        CullState cull;
+    };
+    BoundState bound;
+
+    void setEnabled(const GLenum capability, const bool enabled)
+    {
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+}
+
+Pipeline::Pipeline(PipelineDesc desc, const Shader &fallback) : description(std::move(desc)), fallback(&fallback)
+{
+    // the VAO only records the attribute formats; the buffers are attached to bindings 0 and 1 per draw
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    description.layout.setup(0);
+    if (!description.instanceLayout.attributes().empty())
+    {
+        description.instanceLayout.setup(1);
+        glVertexBindingDivisor(1, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void Pipeline::bind() const
+{
+    bindWith(program());
+}
+
+void Pipeline::bindWith(const Shader &shader) const
+{
+    shader.use();
+    glBindVertexArray(VAO);
+
+    const DepthState &depth = description.depth;
+    if (!bound.valid || bound.depth.test != depth.test)
+        setEnabled(GL_DEPTH_TEST, depth.test);
+    if (!bound.valid || bound.depth.write != depth.write)
+        glDepthMask(depth.write ? GL_TRUE : GL_FALSE);
+    if (!bound.valid || bound.depth.func != depth.func)
+        glDepthFunc(depth.func);
+
+    const BlendState &blend = description.blend;
+    if (!bound.valid || bound.blend.enabled != blend.enabled)
+        setEnabled(GL_BLEND, blend.enabled);
+    if (!bound.valid || bound.blend.source != blend.source || bound.blend.destination != blend.destination)
+        glBlendFunc(blend.source, blend.destination);
+
+    const CullState &cull = description.cull;
+    if (!bound.valid || bound.cull.enabled != cull.enabled)
+        setEnabled(GL_CULL_FACE, cull.enabled);
+    if (!bound.valid || bound.cull.face != cull.face)
+        glCullFace(cull.face);
+
+    bound = {true, depth, blend, cull};
+}
+
+void Pipeline::setVertexBuffer(const unsigned int buffer, const GLintptr offset) const
+{
+    glBindVertexBuffer(0, buffer, offset, (int)description.layout.stride());
+}
+
+void Pipeline::setInstanceBuffer(const unsigned int buffer, const GLintptr offset) const
+{
+    glBindVertexBuffer(1, buffer, offset, (int)description.instanceLayout.stride());
+}
+
+void Pipeline::setIndexBuffer(const unsigned int buffer) const
+{
+    // recorded in the bound VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+}
+
+void Pipeline::release()
+{
+    glDeleteVertexArrays(1, &VAO);
+    VAO = 0;
+}
+
+void Pipeline::invalidateState()
+{
+    bound.valid = false;
+}
+
+void PipelineWarmup::add(const Pipeline &pipeline)
+{
+    const ShaderHandle &program = pipeline.desc().program;
+    if (!program.ready())
+        draw(pipeline, *pipeline.fallback);
+
+    program.onReady([this, &pipeline](const Shader &shader) { draw(pipeline, shader); });
+}
+
+void PipelineWarmup::draw(const Pipeline &pipeline, const Shader &shader)
+{
+    if (FBO == 0)
+    {
+        // same formats as the default framebuffer, the compiled variant can depend on them
+        glGenRenderbuffers(1, &colorTarget);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorTarget);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 1, 1);
+        glGenRenderbuffers(1, &depthTarget);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthTarget);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, 1, 1);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorTarget);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthTarget);
+
+        // three all-zero vertices: a degenerate triangle for any layout up to 256 bytes per vertex (and per instance)
+        const std::vector<unsigned char> zeros(3 * 256, 0);
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)zeros.size(), zeros.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if (pipeline.desc().layout.stride() > 256 || pipeline.desc().instanceLayout.stride() > 256)
+        return;
+
+    int framebuffer = 0, viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, 1, 1);
+    pipeline.bindWith(shader);
+    pipeline.setVertexBuffer(vertexBuffer);
+    pipeline.setInstanceBuffer(vertexBuffer);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 3, 1);
+    glBindVertexArray(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, (unsigned int)framebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    // hand the draw to the driver now, so the variant is built while we are still loading
+    glFlush();
+    draws++;
+}
+
+void PipelineWarmup::release()
+{
+    glDeleteFramebuffers(1, &FBO);
+    glDeleteRenderbuffers(1, &colorTarget);
+    glDeleteRenderbuffers(1, &depthTarget);
+    glDeleteBuffers(1, &vertexBuffer);
+    FBO = colorTarget = depthTarget = vertexBuffer = 0;
+}
@@ -0,0 +1,144 @@
+#include "program_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+    struct CacheFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t format;        // binary format returned by glGetProgramBinary
+        uint32_t length;        // size of the binary following the header
+        double compileMs;       // time the source compile + link blocked the caller for
+    };
+
+    constexpr uint32_t CACHE_MAGIC = 0x42504c47; // "GLPB"
+    constexpr uint32_t CACHE_VERSION = 2;   // 2: compileMs is blocking time, not wall time
+}
+
+ProgramCache& ProgramCache::get()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+uint64_t ProgramCache::makeKey(const std::initializer_list<std::string_view> sources)
+{
+    // the driver strings are hashed once, the first time a key is requested
+    if (driverHash == 0)
+    {
+        driverHash = hashString("program-cache");
+        for (const GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const auto *value = reinterpret_cast<const char*>(glGetString(name));
+            driverHash = hashString(value != nullptr ? value : "", driverHash);
+            driverHash = hashString("\n", driverHash);
+        }
+
+        // some drivers expose the entry points but no binary format
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats == 0)
+            enabled = false;
+    }
+
+    uint64_t key = driverHash;
+    for (const std::string_view source : sources)
+    {
+        // the length keeps ("ab", "c") and ("a", "bc") apart
+        const uint64_t length = source.size();
+        key = hashBytes(&length, sizeof(length), key);
+        key = hashString(source, key);
+    }
+    return key;
+}
+
+std::string ProgramCache::pathOf(const uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return std::string(DIRECTORY) + "/" + name;
+}
+
+bool ProgramCache::load(const unsigned int program, const uint64_t key)
+{
+    if (!enabled)
+        return false;
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::string path = pathOf(key);
+
+    std::ifstream file(path, std::ios::binary);
+    CacheFileHeader header{};
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION)
+    {
+        misses++;
+        return false;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), (std::streamsize)binary.size()))
+    {
+        misses++;
+        return false;
+    }
+    file.close();
+
+    glProgramBinary(program, header.format, binary.data(), (int)binary.size());
+
+    // the driver may reject binaries from another driver build, even with matching strings
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        std::filesystem::remove(path);
+        rejected++;
+        misses++;
+        return false;
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    hits++;
+    loadMs += elapsedMs;
+    savedMs += header.compileMs - elapsedMs;
+    return true;
+}
+
+void ProgramCache::store(const unsigned int program, const uint64_t key, const double compileMs)
+{
+    if (!enabled)
+        return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(DIRECTORY, error);
+
+    const CacheFileHeader header{CACHE_MAGIC, CACHE_VERSION, format, (uint32_t)length, compileMs};
+    std::ofstream file(pathOf(key), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file)
+        std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << pathOf(key) << std::endl;
+}
+
+void ProgramCache::report() const
+{
+    std::cout << "Program cache: " << hits << " hits, " << misses << " misses";
+    if (rejected > 0)
+        std::cout << " (" << rejected << " rejected by the driver)";
+    std::cout << ", " << loadMs << " ms loading, ~" << savedMs << " ms saved" << std::endl;
+}
@@ -1,90 +1,223 @@
 #include "shader.h"
+#include "shader_compiler.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+#include <algorithm>
+#include <filesystem>
 
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    try
+#ifndef OPENGL_SHADERS_FROM_DISK
+#include "embedded_shaders.h"
+#endif
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : ID(0) {
+    // submit and block right away; see ShaderCompiler to build several programs without stalling
+    ShaderCompiler compiler;
+    const ShaderHandle handle = compiler.submit(vertexPath, fragmentPath);
+    compiler.wait();
+    *this = handle.get();
+}
+
+Shader::Shader(const unsigned int program) : ID(program) {
+    // reflect the active uniforms, so the setters never have to query the driver
+    reflectUniforms();
+    reflectBlocks(false);
+    reflectBlocks(true);
+}
+
+#ifndef OPENGL_SHADERS_FROM_DISK
+namespace {
+    // the embedded source of a shader, by its path relative to the repository root
+    const EmbeddedShader* findEmbedded(const char* path)
     {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
+        const std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+        const auto found = std::lower_bound(std::begin(EMBEDDED_SHADERS), std::end(EMBEDDED_SHADERS), normalized,
+                                            [](const EmbeddedShader &shader, const std::string &key) { return shader.path < key; });
+        if (found == std::end(EMBEDDED_SHADERS) || found->path != normalized)
+            return nullptr;
+        return found;
+    }
+}
+
+std::string Shader::readSource(const char* path)
+{
+    // production builds never touch the disk, the sources are compiled into the executable
+    const EmbeddedShader *shader = findEmbedded(path);
+    if (shader == nullptr)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_EMBEDDED: " << path << std::endl;
+        return {};
+    }
+    return std::string(shader->source);
+}
 
-        // read file’s buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
+bool Shader::sourceExists(const char* path)
+{
+    return findEmbedded(path) != nullptr;
+}
+#else
+std::string Shader::readSource(const char* path)
+{
+    std::ifstream shaderFile;
 
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
+    // ensure ifstream objects can throw exceptions:
+    shaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        // open file and read its buffer contents into a stream
+        shaderFile.open(path);
+        std::stringstream shaderStream;
+        shaderStream << shaderFile.rdbuf();
+        shaderFile.close();
 
         // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        return shaderStream.str();
     }
-    catch(std::ifstream::failure e)
+    catch(const std::ifstream::failure &e)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
     }
+    return {};
+}
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    int success;
-    char infoLog[512];
+bool Shader::sourceExists(const char* path)
+{
+    return std::filesystem::exists(path);
+}
+#endif
 
-    // vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, nullptr);
-    glCompileShader(vertex);
+void Shader::reflectUniforms()
+{
+    int count = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
 
-    // print compile errors if any
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if(!success)
+    uniformTable.clear();
+    uniformTable.reserve(count);
+    std::string name(maxNameLength, '\0');
+    for (int i = 0; i < count; i++)
     {
-        glGetShaderInfoLog(vertex, 512, nullptr, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        int length = 0, size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, (unsigned int)i, maxNameLength, &length, &size, &type, name.data());
+
+        std::string uniformName = name.substr(0, length);
+        const int location = glGetUniformLocation(ID, uniformName.c_str());
+        // members of uniform blocks have no location
+        if (location < 0)
+            continue;
+
+        // arrays are reported as "name[0]"
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            uniformName.resize(uniformName.size() - 3);
+
+        uniformTable.push_back({uniformName, type, location, size});
     }
 
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, nullptr);
-    glCompileShader(fragment);
+    uniformShadows = std::make_shared<std::vector<UniformShadow>>(uniformTable.size());
+}
 
-    // print compile errors if any
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if(!success)
+void Shader::reflectBlocks(const bool storage)
+{
+    const GLenum blockInterface = storage ? GL_SHADER_STORAGE_BLOCK : GL_UNIFORM_BLOCK;
+    const GLenum memberInterface = storage ? GL_BUFFER_VARIABLE : GL_UNIFORM;
+
+    int count = 0;
+    glGetProgramInterfaceiv(ID, blockInterface, GL_ACTIVE_RESOURCES, &count);
+    for (int i = 0; i < count; i++)
     {
-        glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        char name[256];
+        glGetProgramResourceName(ID, blockInterface, (unsigned int)i, sizeof(name), nullptr, name);
+
+        const GLenum blockProperties[] = {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES};
+        int blockValues[3] = {};
+        glGetProgramResourceiv(ID, blockInterface, (unsigned int)i, 3, blockProperties, 3, nullptr, blockValues);
+
+        BlockInfo block{name, storage, blockValues[0], blockValues[1], {}};
+
+        std::vector<int> variables(blockValues[2]);
+        const GLenum activeVariables = GL_ACTIVE_VARIABLES;
+        glGetProgramResourceiv(ID, blockInterface, (unsigned int)i, 1, &activeVariables,
+                               (int)variables.size(), nullptr, variables.data());
+
+        for (const int variable : variables)
+        {
+            glGetProgramResourceName(ID, memberInterface, (unsigned int)variable, sizeof(name), nullptr, name);
+
+            const GLenum memberProperties[] = {GL_TYPE, GL_OFFSET, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE, GL_ARRAY_SIZE};
+            int memberValues[5] = {};
+            glGetProgramResourceiv(ID, memberInterface, (unsigned int)variable, 5, memberProperties, 5, nullptr, memberValues);
+
+            // "Block.member[0]" -> "member"
+            std::string memberName = name;
+            const size_t dot = memberName.rfind('.');
+            if (dot != std::string::npos)
+                memberName.erase(0, dot + 1);
+            if (memberName.size() > 3 && memberName.compare(memberName.size() - 3, 3, "[0]") == 0)
+                memberName.resize(memberName.size() - 3);
+
+            block.members.push_back({memberName, (GLenum)memberValues[0], memberValues[1], memberValues[2],
+                                     memberValues[3], memberValues[4]});
+        }
+
+        blockTable.push_back(std::move(block));
     }
+}
+
+const BlockInfo* Shader::findBlock(const std::string &name) const
+{
+    for (const BlockInfo &block : blockTable)
+        if (block.name == name)
+            return &block;
+    return nullptr;
+}
+
+bool Shader::verifyBlock(const BlockLayout &layout) const
+{
+    const BlockInfo *block = findBlock(layout.name);
+    if (block == nullptr || block->storage != layout.storage)
+        return true; // this program does not use the block
+
+    bool matches = true;
+    const auto mismatch = [&](const std::string &what) {
+        std::cout << "ERROR::SHADER::BLOCK_LAYOUT_MISMATCH " << layout.name << ": " << what << std::endl;
+        matches = false;
+    };
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
+    if (layout.size != 0 && (int)layout.size != block->dataSize)
+        mismatch("size " + std::to_string(block->dataSize) + ", C++ mirror has " + std::to_string(layout.size));
 
-    // print linking errors if any
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if(!success)
+    for (size_t i = 0; i < layout.memberCount; i++)
     {
-        glGetProgramInfoLog(ID, 512, nullptr, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        const BlockMemberLayout &expected = layout.members[i];
+        const auto member = std::find_if(block->members.begin(), block->members.end(),
+                                         [&](const BlockMemberInfo &m) { return m.name == expected.name; });
+        if (member == block->members.end())
+        {
+            mismatch(std::string(expected.name) + " is missing from the program");
+            continue;
+        }
+        if (member->offset != (int)expected.offset || member->arrayStride != (int)expected.arrayStride
+            || member->matrixStride != (int)expected.matrixStride)
+        {
+            mismatch(member->name + " at offset " + std::to_string(member->offset) + " (array stride "
+                     + std::to_string(member->arrayStride) + ", matrix stride " + std::to_string(member->matrixStride)
+                     + "), C++ mirror expects " + std::to_string(expected.offset) + " ("
+                     + std::to_string(expected.arrayStride) + ", " + std::to_string(expected.matrixStride) + ")");
+        }
     }
 
-    // delete shaders; they’re linked into our program and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-};
+    if (block->members.size() != layout.memberCount)
+        mismatch(std::to_string(block->members.size()) + " members, C++ mirror has " + std::to_string(layout.memberCount));
+
+    return matches;
+}
+
+const UniformInfo* Shader::findUniform(const std::string &name) const
+{
+    for (const UniformInfo &info : uniformTable)
+        if (info.name == name)
+            return &info;
+    return nullptr;
+}
 
 void Shader::use() const
 {
@@ -93,32 +226,32 @@ void Shader::use() const
 
 void Shader::setBool(const std::string &name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    handleOf<bool>(findUniform(name)).set(value);
 }
 void Shader::setInt(const std::string &name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    handleOf<int>(findUniform(name)).set(value);
 }
 void Shader::setFloat(const std::string &name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    handleOf<float>(findUniform(name)).set(value);
 }
 
 void Shader::setVec2(const std::string &name, const float x, const float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    handleOf<glm::vec2>(findUniform(name)).set(glm::vec2(x, y));
 }
 void Shader::setVec2(const std::string &name, const glm::vec2 &vec) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(vec));
+    handleOf<glm::vec2>(findUniform(name)).set(vec);
 }
 void Shader::setVec3(const std::string &name, const float x, const float y, const float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    handleOf<glm::vec3>(findUniform(name)).set(glm::vec3(x, y, z));
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &vec) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(vec));
+    handleOf<glm::vec3>(findUniform(name)).set(vec);
 }
 void Shader::setVec4(const std::string &name, const float x, const float y, const float z, const float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    handleOf<glm::vec4>(findUniform(name)).set(glm::vec4(x, y, z, w));
 }
 void Shader::setVec4(const std::string &name, const glm::vec4 &vec) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(vec));
-}
\ No newline at end of file
+    handleOf<glm::vec4>(findUniform(name)).set(vec);
+}
@@ -0,0 +1,273 @@
+#include "shader_compiler.h"
+#include "program_cache.h"
+#include "stage_cache.h"
+
+#include <cstring>
+#include <iostream>
+
+// GL_KHR_parallel_shader_compile is not part of our glad loader
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace {
+    bool hasExtension(const char *name)
+    {
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (int i = 0; i < count; i++)
+        {
+            const auto *extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, (unsigned int)i));
+            if (extension != nullptr && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+}
+
+void ShaderHandle::onReady(const std::function<void(const Shader&)> &callback) const
+{
+    if (ready())
+        callback(request->shader);
+    else if (request && !failed())
+        request->callbacks.push_back(callback);
+}
+
+ShaderCompiler::ShaderCompiler(const GLADloadproc loader)
+{
+    if (loader == nullptr)
+        return;
+
+    if (hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile"))
+    {
+        auto maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+        if (maxShaderCompilerThreads == nullptr)
+            maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+
+        if (maxShaderCompilerThreads != nullptr)
+        {
+            // 0xFFFFFFFF lets the driver pick its own thread count
+            maxShaderCompilerThreads(0xFFFFFFFF);
+            parallelCompile = true;
+        }
+    }
+}
+
+ShaderHandle ShaderCompiler::submit(const char* vertexPath, const char* fragmentPath, const std::vector<ShaderDefine> &defines)
+{
+    std::string label = std::string(vertexPath) + " + " + fragmentPath;
+    for (const ShaderDefine &define : defines)
+        label += " " + define.name;
+
+    return submitSource(ShaderPreprocessor::process(vertexPath, defines), ShaderPreprocessor::process(fragmentPath, defines),
+                        std::move(label));
+}
+
+ShaderHandle ShaderCompiler::submitSource(std::string vertexCode, std::string fragmentCode, std::string label)
+{
+    auto request = std::make_shared<ShaderRequest>();
+    request->label = std::move(label);
+    request->vertexCode = std::move(vertexCode);
+    request->fragmentCode = std::move(fragmentCode);
+    return submitRequest(std::move(request));
+}
+
+ShaderHandle ShaderCompiler::submitCompute(const char* computePath, const std::vector<ShaderDefine> &defines)
+{
+    auto request = std::make_shared<ShaderRequest>();
+    request->label = computePath;
+    for (const ShaderDefine &define : defines)
+        request->label += " " + define.name;
+    request->computeCode = ShaderPreprocessor::process(computePath, defines);
+    return submitRequest(std::move(request));
+}
+
+ShaderHandle ShaderCompiler::submitRequest(std::shared_ptr<ShaderRequest> request)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // 1. a cached binary resolves the request right away
+    ProgramCache &cache = ProgramCache::get();
+    request->cacheKey = request->computeCode.empty() ? cache.makeKey({request->vertexCode, request->fragmentCode})
+                                                     : cache.makeKey({request->computeCode});
+    request->program = glCreateProgram();
+    if (cache.load(request->program, request->cacheKey))
+    {
+        request->shader = Shader(request->program);
+        request->status = verifyLayouts(*request) ? ShaderRequest::READY : ShaderRequest::FAILED;
+        if (request->status == ShaderRequest::FAILED)
+            discard(*request);
+        return ShaderHandle(request);
+    }
+    // a rejected binary leaves the program in an undefined state, start over with a fresh one
+    glDeleteProgram(request->program);
+    request->program = glCreateProgram();
+
+    // 2. submit the compiles (only for stages no other program has) and the link, without asking for any status
+    StageCache &stages = StageCache::get();
+    if (request->computeCode.empty())
+    {
+        request->vertex = stages.acquire(GL_VERTEX_SHADER, request->vertexCode, request->label);
+        request->fragment = stages.acquire(GL_FRAGMENT_SHADER, request->fragmentCode, request->label);
+        glAttachShader(request->program, request->vertex);
+        glAttachShader(request->program, request->fragment);
+    }
+    else
+    {
+        request->compute = stages.acquire(GL_COMPUTE_SHADER, request->computeCode, request->label);
+        glAttachShader(request->program, request->compute);
+    }
+    glProgramParameteri(request->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(request->program);
+
+    request->blockingMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    requests.push_back(request);
+    return ShaderHandle(request);
+}
+
+size_t ShaderCompiler::poll()
+{
+    for (size_t i = 0; i < requests.size();)
+    {
+        ShaderRequest &request = *requests[i];
+        if (parallelCompile)
+        {
+            // non-blocking: GL_COMPLETION_STATUS_KHR only reports whether the driver is done
+            int done = GL_FALSE;
+            glGetProgramiv(request.program, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done)
+            {
+                i++;
+                continue;
+            }
+        }
+
+        finish(request);
+        requests.erase(requests.begin() + (long)i);
+    }
+    return requests.size();
+}
+
+void ShaderCompiler::wait()
+{
+    for (const std::shared_ptr<ShaderRequest> &request : requests)
+        finish(*request);
+    requests.clear();
+}
+
+bool ShaderCompiler::verifyLayouts(const ShaderRequest &request) const
+{
+    bool matches = true;
+    for (const BlockLayout *layout : expectedLayouts)
+        if (layout != nullptr)
+            matches &= request.shader.verifyBlock(*layout);
+
+    if (!matches)
+        std::cout << "ERROR::SHADER::PROGRAM::BLOCK_LAYOUT_MISMATCH " << request.label << std::endl;
+    return matches;
+}
+
+void ShaderCompiler::discard(ShaderRequest &request)
+{
+    // a failed program is never drawn with, only its fallback is
+    glDeleteProgram(request.program);
+    request.program = 0;
+    request.shader = Shader();
+    request.status = ShaderRequest::FAILED;
+}
+
+void ShaderCompiler::finish(ShaderRequest &request) const
+{
+    const auto start = std::chrono::steady_clock::now();
+    // these queries block until the driver has finished compiling and linking
+    StageCache &stages = StageCache::get();
+    bool success = true;
+    for (const unsigned int stage : {request.vertex, request.fragment, request.compute})
+        if (stage != 0)
+            success &= stages.check(stage);
+
+    int linked;
+    glGetProgramiv(request.program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(request.program, 512, nullptr, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED " << request.label << "\n" << infoLog << std::endl;
+    }
+    success &= linked != 0;
+
+    // the stages stay alive in the StageCache, ready for the next program that shares them
+    for (const unsigned int stage : {request.vertex, request.fragment, request.compute})
+        if (stage != 0)
+            glDetachShader(request.program, stage);
+    request.vertex = request.fragment = request.compute = 0;
+
+    request.shader = Shader(request.program);
+    success = success && verifyLayouts(request);
+    if (!success)
+    {
+        discard(request);
+        return;
+    }
+    request.status = ShaderRequest::READY;
+
+    // only the time spent blocked in submit and here, so a later cache hit is not credited with work that overlapped
+    request.blockingMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ProgramCache::get().store(request.program, request.cacheKey, request.blockingMs);
+
+    for (const auto &callback : request.callbacks)
+        callback(request.shader);
+    request.callbacks.clear();
+}
+
+const Shader& ShaderCompiler::fallback()
+{
+    if (fallbackShader == nullptr)
+    {
+        // compiled on its own so it never waits behind the batch
+        ShaderCompiler compiler;
+        compiler.expectLayouts(expectedLayouts);
+        const ShaderHandle handle = compiler.submit(FALLBACK_VERTEX_PATH, FALLBACK_FRAGMENT_PATH);
+        compiler.wait();
+        fallbackShader = std::make_unique<Shader>(handle.get());
+    }
+    return *fallbackShader;
+}
+
+ShaderVariants::ShaderVariants(ShaderCompiler &compiler, std::string vertexPath, std::string fragmentPath,
+                               std::vector<std::string> features)
+    : compiler(compiler), vertexPath(std::move(vertexPath)), fragmentPath(std::move(fragmentPath)), features(std::move(features))
+{
+}
+
+ShaderHandle ShaderVariants::variant(const uint32_t key)
+{
+    const auto found = byKey.find(key);
+    if (found != byKey.end())
+        return found->second;
+
+    const std::vector<ShaderDefine> defines = permutationDefines(features, key);
+    std::string vertexCode = ShaderPreprocessor::process(vertexPath, defines);
+    std::string fragmentCode = ShaderPreprocessor::process(fragmentPath, defines);
+
+    // keys whose features the shader never tests preprocess to the same text
+    const uint64_t sourceKey = hashString(fragmentCode, hashString(vertexCode));
+
+    ShaderHandle handle;
+    const auto same = bySource.find(sourceKey);
+    if (same != bySource.end())
+        handle = same->second;
+    else
+    {
+        std::string label = vertexPath + " + " + fragmentPath;
+        for (const ShaderDefine &define : defines)
+            label += " " + define.name;
+        handle = compiler.submitSource(std::move(vertexCode), std::move(fragmentCode), std::move(label));
+        bySource.emplace(sourceKey, handle);
+    }
+
+    byKey.emplace(key, handle);
+    return handle;
+}
@@ -0,0 +1,473 @@
+#include "shader_preprocessor.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+    // Evaluates the integer expression of an #if/#elif line, C preprocessor rules
+    class ExpressionParser
+    {
+    public:
+        ExpressionParser(const std::string &text, const std::unordered_map<std::string, std::string> &macros, const int depth)
+            : text(text), macros(macros), depth(depth) {}
+
+        bool parse(long long &result)
+        {
+            result = parseBinary(0);
+            skipSpaces();
+            return ok && pos == text.size();
+        }
+
+    private:
+        const std::string &text;
+        const std::unordered_map<std::string, std::string> &macros;
+        const int depth;
+        size_t pos = 0;
+        bool ok = true;
+
+        void skipSpaces()
+        {
+            while (pos < text.size() && std::isspace((unsigned char)text[pos]))
+                pos++;
+        }
+
+        bool match(const char *token)
+        {
+            skipSpaces();
+            const size_t length = std::char_traits<char>::length(token);
+            if (text.compare(pos, length, token) != 0)
+                return false;
+            pos += length;
+            return true;
+        }
+
+        std::string identifier()
+        {
+            skipSpaces();
+            const size_t start = pos;
+            while (pos < text.size() && (std::isalnum((unsigned char)text[pos]) || text[pos] == '_'))
+                pos++;
+            return text.substr(start, pos - start);
+        }
+
+        // binary operators by precedence, lowest first
+        static int precedence(const std::string &op)
+        {
+            if (op == "||") return 1;
+            if (op == "&&") return 2;
+            if (op == "|") return 3;
+            if (op == "^") return 4;
+            if (op == "&") return 5;
+            if (op == "==" || op == "!=") return 6;
+            if (op == "<" || op == ">" || op == "<=" || op == ">=") return 7;
+            if (op == "<<" || op == ">>") return 8;
+            if (op == "+" || op == "-") return 9;
+            if (op == "*" || op == "/" || op == "%") return 10;
+            return 0;
+        }
+
+        std::string peekOperator()
+        {
+            skipSpaces();
+            for (const char *op : {"||", "&&", "==", "!=", "<=", ">=", "<<", ">>", "|", "^", "&", "<", ">", "+", "-", "*", "/", "%"})
+                if (text.compare(pos, std::char_traits<char>::length(op), op) == 0)
+                    return op;
+            return {};
+        }
+
+        long long parseBinary(const int minPrecedence)
+        {
+            long long left = parseUnary();
+            for (;;)
+            {
+                const std::string op = peekOperator();
+                const int opPrecedence = op.empty() ? 0 : precedence(op);
+                if (opPrecedence == 0 || opPrecedence <= minPrecedence)
+                    return left;
+                pos += op.size();
+
+                const long long right = parseBinary(opPrecedence);
+                if (op == "||") left = left || right;
+                else if (op == "&&") left = left && right;
+                else if (op == "|") left |= right;
+                else if (op == "^") left ^= right;
+                else if (op == "&") left &= right;
+                else if (op == "==") left = left == right;
+                else if (op == "!=") left = left != right;
+                else if (op == "<") left = left < right;
+                else if (op == ">") left = left > right;
+                else if (op == "<=") left = left <= right;
+                else if (op == ">=") left = left >= right;
+                else if (op == "<<") left <<= right;
+                else if (op == ">>") left >>= right;
+                else if (op == "+") left += right;
+                else if (op == "-") left -= right;
+                else if (op == "*") left *= right;
+                else if (right == 0) ok = false;
+                else if (op == "/") left /= right;
+                else left %= right;
+            }
+        }
+
+        long long parseUnary()
+        {
+            if (match("!")) return !parseUnary();
+            if (match("~")) return ~parseUnary();
+            if (match("-")) return -parseUnary();
+            if (match("+")) return parseUnary();
+            return parsePrimary();
+        }
+
+        long long parsePrimary()
+        {
+            if (match("("))
+            {
+                const long long value = parseBinary(0);
+                ok &= match(")");
+                return value;
+            }
+
+            skipSpaces();
+            if (pos < text.size() && std::isdigit((unsigned char)text[pos]))
+            {
+                size_t used = 0;
+                const long long value = std::stoll(text.substr(pos), &used, 0);
+                pos += used;
+                // integer suffixes
+                while (pos < text.size() && (text[pos] == 'u' || text[pos] == 'U' || text[pos] == 'l' || text[pos] == 'L'))
+                    pos++;
+                return value;
+            }
+
+            const std::string name = identifier();
+            if (name.empty())
+            {
+                ok = false;
+                return 0;
+            }
+
+            if (name == "defined")
+            {
+                const bool parenthesized = match("(");
+                const std::string macro = identifier();
+                if (parenthesized)
+                    ok &= match(")");
+                ok &= !macro.empty();
+                return macros.count(macro);
+            }
+
+            // an undefined identifier is 0; a macro evaluates to its own expansion
+            const auto found = macros.find(name);
+            if (found == macros.end() || found->second.empty())
+                return 0;
+            if (depth > 16)
+            {
+                ok = false;
+                return 0;
+            }
+
+            long long value = 0;
+            ExpressionParser expansion(found->second, macros, depth + 1);
+            ok &= expansion.parse(value);
+            return value;
+        }
+    };
+
+    std::string trim(const std::string &text)
+    {
+        const size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+            return {};
+        const size_t last = text.find_last_not_of(" \t\r");
+        return text.substr(first, last - first + 1);
+    }
+
+    // removes // and /* */ comments from a directive line
+    std::string stripComments(const std::string &line)
+    {
+        std::string result;
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            if (line.compare(i, 2, "//") == 0)
+                break;
+            if (line.compare(i, 2, "/*") == 0)
+            {
+                const size_t end = line.find("*/", i + 2);
+                if (end == std::string::npos)
+                    break;
+                i = end + 1;
+                result += ' ';
+                continue;
+            }
+            result += line[i];
+        }
+        return result;
+    }
+
+    // updates the block comment state with the comments opened/closed on this line
+    bool endsInBlockComment(const std::string &line, bool inComment)
+    {
+        for (size_t i = 0; i + 1 < line.size(); i++)
+        {
+            if (inComment)
+            {
+                if (line[i] == '*' && line[i + 1] == '/')
+                {
+                    inComment = false;
+                    i++;
+                }
+            }
+            else if (line[i] == '/' && line[i + 1] == '/')
+                break;
+            else if (line[i] == '/' && line[i + 1] == '*')
+            {
+                inComment = true;
+                i++;
+            }
+        }
+        return inComment;
+    }
+
+    // whether text contains name as a whole identifier
+    bool mentions(const std::string &text, const std::string &name)
+    {
+        const auto isIdentifier = [](const char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+        for (size_t at = text.find(name); at != std::string::npos; at = text.find(name, at + 1))
+        {
+            const bool startsWord = at == 0 || !isIdentifier(text[at - 1]);
+            const bool endsWord = at + name.size() == text.size() || !isIdentifier(text[at + name.size()]);
+            if (startsWord && endsWord)
+                return true;
+        }
+        return false;
+    }
+
+    // one level of #if nesting
+    struct Conditional
+    {
+        bool parentActive;  // the enclosing block is emitted
+        bool active;        // the current branch is emitted
+        bool taken;         // a branch of this #if was already emitted
+        bool seenElse;
+    };
+}
+
+std::vector<ShaderDefine> permutationDefines(const std::vector<std::string> &features, const uint32_t key)
+{
+    std::vector<ShaderDefine> defines;
+    for (size_t bit = 0; bit < features.size() && bit < 32; bit++)
+        if (key & (1u << bit))
+            defines.push_back({features[bit], "1"});
+    return defines;
+}
+
+std::string ShaderPreprocessor::process(const std::string &path, const std::vector<ShaderDefine> &defines)
+{
+    ShaderPreprocessor preprocessor;
+    for (const ShaderDefine &define : defines)
+        preprocessor.macros[define.name] = define.value;
+
+    std::string body;
+    if (!preprocessor.processFile(path, body, 0))
+    {
+        std::cout << "ERROR::SHADER::PREPROCESSING_FAILED " << path << "\n" << preprocessor.error << std::endl;
+        return {};
+    }
+
+    // #version has to stay the first line, the injected defines go right after it. The conditionals are
+    // already resolved, so a define the remaining code never mentions is left out: permutations that only
+    // differ by an unused feature then preprocess to the same text. The files behind the #line ids follow, so
+    // that a driver's "1:12" can be read back.
+    std::string output = preprocessor.version;
+    for (const ShaderDefine &define : defines)
+        if (mentions(body, define.name))
+            output += "#define " + define.name + " " + define.value + "\n";
+    for (size_t id = 0; id < preprocessor.files.size(); id++)
+        output += "// file " + std::to_string(id) + ": " + preprocessor.files[id] + "\n";
+    return output + body;
+}
+
+bool ShaderPreprocessor::processFile(const std::string &path, std::string &output, const int depth)
+{
+    if (depth > 32)
+    {
+        error = path + ": #include nested too deeply";
+        return false;
+    }
+
+    const std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+    if (std::find(onceFiles.begin(), onceFiles.end(), normalized) != onceFiles.end())
+        return true;
+
+    if (!Shader::sourceExists(path.c_str()))
+    {
+        error = path + ": cannot be read";
+        return false;
+    }
+    const std::string source = Shader::readSource(path.c_str());
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    // the driver numbers lines by source string: every file gets an id, and a #line goes out whenever the lines
+    // emitted stop following the file's own (at its start, after an include and after the lines dropped)
+    const auto known = std::find(files.begin(), files.end(), normalized);
+    const size_t fileId = (size_t)(known - files.begin());
+    if (known == files.end())
+        files.push_back(normalized);
+    size_t nextLine = 0;    // the line the driver counts the next one emitted as, 0 when out of step
+    const auto emit = [&](const std::string &line, const size_t lineNumber) {
+        if (lineNumber != nextLine)
+            output += "#line " + std::to_string(lineNumber) + " " + std::to_string(fileId) + "\n";
+        output += line + "\n";
+        nextLine = lineNumber + 1;
+    };
+
+    std::vector<Conditional> conditionals;
+    bool inComment = false;
+    size_t lineNumber = 0;
+    size_t start = 0;
+    while (start < source.size())
+    {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos)
+            end = source.size();
+        const std::string line = source.substr(start, end - start);
+        start = end + 1;
+        lineNumber++;
+
+        const bool active = conditionals.empty() || conditionals.back().active;
+        const std::string trimmed = trim(line);
+        const bool isDirective = !inComment && !trimmed.empty() && trimmed[0] == '#';
+        inComment = endsInBlockComment(line, inComment);
+
+        if (!isDirective)
+        {
+            if (active)
+                emit(line, lineNumber);
+            continue;
+        }
+
+        // split "#  name  arguments"
+        const std::string directive = trim(stripComments(trimmed.substr(1)));
+        size_t nameEnd = 0;
+        while (nameEnd < directive.size() && (std::isalnum((unsigned char)directive[nameEnd]) || directive[nameEnd] == '_'))
+            nameEnd++;
+        const std::string name = directive.substr(0, nameEnd);
+        const std::string arguments = trim(directive.substr(nameEnd));
+        const std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+
+        if (name == "if" || name == "ifdef" || name == "ifndef")
+        {
+            bool condition = false;
+            if (active)
+            {
+                long long value = 0;
+                if (name == "if" && !evaluate(arguments, value))
+                {
+                    error = where + "invalid #if expression '" + arguments + "'";
+                    return false;
+                }
+                condition = name == "if" ? value != 0
+                          : name == "ifdef" ? macros.count(arguments) > 0
+                          : macros.count(arguments) == 0;
+            }
+            conditionals.push_back({active, condition, condition, false});
+        }
+        else if (name == "elif" || name == "else")
+        {
+            if (conditionals.empty() || conditionals.back().seenElse)
+            {
+                error = where + "unexpected #" + name;
+                return false;
+            }
+            Conditional &conditional = conditionals.back();
+            bool condition = !conditional.taken && conditional.parentActive;
+            if (condition && name == "elif")
+            {
+                long long value = 0;
+                if (!evaluate(arguments, value))
+                {
+                    error = where + "invalid #elif expression '" + arguments + "'";
+                    return false;
+                }
+                condition = value != 0;
+            }
+            conditional.seenElse = name == "else";
+            conditional.active = condition;
+            conditional.taken |= condition;
+        }
+        else if (name == "endif")
+        {
+            if (conditionals.empty())
+            {
+                error = where + "unexpected #endif";
+                return false;
+            }
+            conditionals.pop_back();
+        }
+        else if (!active)
+        {
+            // every other directive in a dead branch is dropped
+        }
+        else if (name == "include")
+        {
+            if (arguments.size() < 2 || arguments.front() != '"' || arguments.back() != '"')
+            {
+                error = where + "expected #include \"file\"";
+                return false;
+            }
+            const std::string file = arguments.substr(1, arguments.size() - 2);
+            std::filesystem::path includePath = directory / file;
+            if (!Shader::sourceExists(includePath.generic_string().c_str()))
+                includePath = std::filesystem::path(SHADER_ROOT) / file;
+            if (!processFile(includePath.generic_string(), output, depth + 1))
+            {
+                error = where + "in #include \"" + file + "\": " + error;
+                return false;
+            }
+            nextLine = 0;
+        }
+        else if (name == "version")
+        {
+            // only the first #version (the one of the root file) is kept
+            if (version.empty())
+                version = line + "\n";
+        }
+        else if (name == "pragma" && arguments == "once")
+        {
+            onceFiles.push_back(normalized);
+        }
+        else
+        {
+            if (name == "define")
+            {
+                size_t macroEnd = 0;
+                while (macroEnd < arguments.size() && (std::isalnum((unsigned char)arguments[macroEnd]) || arguments[macroEnd] == '_'))
+                    macroEnd++;
+                // function-like macros are left to the driver
+                if (macroEnd == arguments.size() || arguments[macroEnd] != '(')
+                    macros[arguments.substr(0, macroEnd)] = trim(arguments.substr(macroEnd));
+            }
+            else if (name == "undef")
+            {
+                macros.erase(arguments);
+            }
+            emit(line, lineNumber);
+        }
+    }
+
+    if (!conditionals.empty())
+    {
+        error = path + ": missing #endif";
+        return false;
+    }
+    return true;
+}
+
+bool ShaderPreprocessor::evaluate(const std::string &expression, long long &result) const
+{
+    ExpressionParser parser(expression, macros, 0);
+    return parser.parse(result);
+}
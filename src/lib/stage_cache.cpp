@@ -0,0 +1,71 @@
+#include "stage_cache.h"
+#include "program_cache.h"
+
+#include <iostream>
+
+StageCache& StageCache::get()
+{
+    static StageCache cache;
+    return cache;
+}
+
+unsigned int StageCache::acquire(const GLenum type, const std::string &source, const std::string &label)
+{
+    // the same text compiled as another stage type is a different object
+    const uint64_t key = hashString(source, hashBytes(&type, sizeof(type)));
+
+    const auto found = stages.find(key);
+    if (found != stages.end())
+    {
+        reuses++;
+        return found->second.shader;
+    }
+
+    const char *code = source.c_str();
+    const unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &code, nullptr);
+    glCompileShader(shader);
+    compiles++;
+
+    stages.emplace(key, Stage{shader, type, label, false, false});
+    keys.emplace(shader, key);
+    return shader;
+}
+
+bool StageCache::check(const unsigned int stage)
+{
+    const auto key = keys.find(stage);
+    if (key == keys.end())
+        return false;
+
+    Stage &cached = stages.at(key->second);
+    if (cached.checked)
+        return cached.compiled;
+
+    int success;
+    glGetShaderiv(cached.shader, GL_COMPILE_STATUS, &success);
+    cached.checked = true;
+    cached.compiled = success != 0;
+
+    if (!cached.compiled)
+    {
+        char infoLog[512];
+        glGetShaderInfoLog(cached.shader, 512, nullptr, infoLog);
+        const char *kind = cached.type == GL_VERTEX_SHADER ? "VERTEX" : cached.type == GL_COMPUTE_SHADER ? "COMPUTE" : "FRAGMENT";
+        std::cout << "ERROR::SHADER::" << kind << "::COMPILATION_FAILED " << cached.label << "\n" << infoLog << std::endl;
+    }
+    return cached.compiled;
+}
+
+void StageCache::clear()
+{
+    for (const auto &[key, stage] : stages)
+        glDeleteShader(stage.shader);
+    stages.clear();
+    keys.clear();
+}
+
+void StageCache::report() const
+{
+    std::cout << "Stage cache: " << compiles << " stages compiled, " << reuses << " reused" << std::endl;
+}
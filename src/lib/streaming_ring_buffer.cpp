@@ -0,0 +1,136 @@
+#include "streaming_ring_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    // regions start at a multiple of every offset alignment, so that offsets aligned within a region are aligned in
+    // the buffer, whichever region
+    size_t alignedRegionSize(const size_t frameSize)
+    {
+        const size_t alignment = std::max(StreamingRingBuffer::uniformAlignment(), StreamingRingBuffer::storageAlignment());
+        return (frameSize + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+StreamingRingBuffer::StreamingRingBuffer(const size_t frameSize, const unsigned int frameCount)
+    : regionSize(alignedRegionSize(frameSize)), fences(std::max(frameCount, 1u), nullptr)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr bytes = (GLsizeiptr)(regionSize * fences.size());
+    glGenBuffers(1, &ringBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, flags);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (mapped == nullptr)
+        std::cout << "ERROR::RING_BUFFER::MAP_FAILED: " << bytes << " bytes" << std::endl;
+
+    // beginFrame() moves to region 0 first
+    region = (unsigned int)fences.size() - 1;
+}
+
+void StreamingRingBuffer::beginFrame()
+{
+    region = (region + 1) % (unsigned int)fences.size();
+    used = 0;
+    stats.frames++;
+    stats.lastFrameMs = 0.0;
+
+    GLsync &fence = fences[region];
+    if (fence == nullptr)
+        return;
+
+    // the status query never blocks; a wait (even one that looks like a poll) may, so all of it is timed
+    int status = GL_UNSIGNALED;
+    glGetSynciv(fence, GL_SYNC_STATUS, 1, nullptr, &status);
+    if (status != GL_SIGNALED)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        // the first wait flushes, so that the fence is sure to be signaled eventually
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);     // 1 ms
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, 0, 1000000);
+        if (result == GL_WAIT_FAILED)
+            std::cout << "ERROR::RING_BUFFER::WAIT_FAILED" << std::endl;
+
+        stats.lastFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.totalMs += stats.lastFrameMs;
+        stats.maxMs = std::max(stats.maxMs, stats.lastFrameMs);
+        stats.waits++;
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamingRingBuffer::endFrame()
+{
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+RingAllocation StreamingRingBuffer::allocate(const size_t size, const size_t alignment)
+{
+    const size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (mapped == nullptr || start + size > regionSize)
+    {
+        if (!overflowReported)
+            std::cout << "ERROR::RING_BUFFER::FRAME_FULL: " << start + size << " bytes needed, "
+                      << regionSize << " per frame" << std::endl;
+        overflowReported = true;
+        return {};
+    }
+    used = start + size;
+    const size_t offset = region * regionSize + start;
+    return {mapped + offset, (GLintptr)offset, (GLsizeiptr)size};
+}
+
+RingAllocation StreamingRingBuffer::write(const void *data, const size_t size, const size_t alignment)
+{
+    const RingAllocation allocation = allocate(size, alignment);
+    if (allocation.data != nullptr)
+        std::memcpy(allocation.data, data, size);
+    return allocation;
+}
+
+size_t StreamingRingBuffer::uniformAlignment()
+{
+    int alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return (size_t)alignment;
+}
+
+size_t StreamingRingBuffer::storageAlignment()
+{
+    int alignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return (size_t)alignment;
+}
+
+void StreamingRingBuffer::report() const
+{
+    std::cout << "Ring buffer: " << fences.size() << " x " << regionSize / 1024 << " KiB, waited on the GPU in "
+              << stats.waits << " of " << stats.frames << " frames (" << stats.totalMs << " ms total, "
+              << stats.maxMs << " ms max)" << std::endl;
+}
+
+void StreamingRingBuffer::release()
+{
+    for (GLsync &fence : fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (ringBuffer != 0 && mapped != nullptr)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &ringBuffer);
+    ringBuffer = 0;
+    mapped = nullptr;
+}
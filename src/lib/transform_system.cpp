@@ -0,0 +1,130 @@
+#include "transform_system.h"
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace {
+    // below this many entities the matrices are computed on the calling thread alone
+    constexpr size_t PARALLEL_MIN = 16384;
+    // transforms per parallelFor task
+    constexpr size_t TASK_SIZE = 4096;
+
+    // translate * rotate * scale of the transforms from i on, as many as the lanes
+    template <typename L>
+    void computeMatrices(const size_t i, const float *px, const float *py, const float *pz, const float *qx,
+                         const float *qy, const float *qz, const float *qw, const float *scale, glm::mat4 *out)
+    {
+        using V = typename L::V;
+        const V x = L::load(qx + i), y = L::load(qy + i), z = L::load(qz + i), w = L::load(qw + i);
+        const V s = L::load(scale + i);
+        const V x2 = L::add(x, x), y2 = L::add(y, y), z2 = L::add(z, z);
+        const V xx = L::mul(x, x2), yy = L::mul(y, y2), zz = L::mul(z, z2);
+        const V xy = L::mul(x, y2), xz = L::mul(x, z2), yz = L::mul(y, z2);
+        const V wx = L::mul(w, x2), wy = L::mul(w, y2), wz = L::mul(w, z2);
+        const V one = L::set(1.0f), zero = L::set(0.0f);
+
+        L::storeColumn(out + i, 0, L::mul(L::sub(one, L::add(yy, zz)), s), L::mul(L::add(xy, wz), s),
+                       L::mul(L::sub(xz, wy), s), zero);
+        L::storeColumn(out + i, 1, L::mul(L::sub(xy, wz), s), L::mul(L::sub(one, L::add(xx, zz)), s),
+                       L::mul(L::add(yz, wx), s), zero);
+        L::storeColumn(out + i, 2, L::mul(L::add(xz, wy), s), L::mul(L::sub(yz, wx), s),
+                       L::mul(L::sub(one, L::add(xx, yy)), s), zero);
+        L::storeColumn(out + i, 3, L::load(px + i), L::load(py + i), L::load(pz + i), one);
+    }
+}
+
+size_t TransformSystem::add(const glm::vec3 &position, const glm::vec4 &rotation, const float scale)
+{
+    // a new block of identities
+    if (count % BLOCK == 0)
+    {
+        const size_t padded = count + BLOCK;
+        for (std::vector<float> *component : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ})
+            component->resize(padded, 0.0f);
+        rotationW.resize(padded, 1.0f);
+        scales.resize(padded, 1.0f);
+        changed.resize(padded, 0);
+        worlds.resize(padded, glm::mat4(1.0f));
+    }
+
+    const size_t index = count++;
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+    scales[index] = scale;
+    changed[index] = 1;
+    return index;
+}
+
+void TransformSystem::setPosition(const size_t index, const glm::vec3 &position)
+{
+    if (this->position(index) == position)
+        return;
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    changed[index] = 1;
+}
+
+void TransformSystem::setRotation(const size_t index, const glm::vec4 &rotation)
+{
+    if (this->rotation(index) == rotation)
+        return;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+    changed[index] = 1;
+}
+
+void TransformSystem::setScale(const size_t index, const float scale)
+{
+    if (scales[index] == scale)
+        return;
+    scales[index] = scale;
+    changed[index] = 1;
+}
+
+size_t TransformSystem::update()
+{
+    const size_t blocks = (count + BLOCK - 1) / BLOCK;
+    if (count < PARALLEL_MIN || workerCount() == 1)
+        return updateBlocks(0, blocks);
+
+    constexpr size_t TASK_BLOCKS = TASK_SIZE / BLOCK;
+    std::vector<size_t> updated((blocks + TASK_BLOCKS - 1) / TASK_BLOCKS);
+    parallelFor(updated.size(), [&](const size_t task) {
+        updated[task] = updateBlocks(task * TASK_BLOCKS, std::min(blocks, (task + 1) * TASK_BLOCKS));
+    });
+    size_t total = 0;
+    for (const size_t taskUpdated : updated)
+        total += taskUpdated;
+    return total;
+}
+
+size_t TransformSystem::updateBlocks(const size_t first, const size_t last)
+{
+    size_t updated = 0;
+    for (size_t block = first; block < last; block++)
+    {
+        const size_t i = block * BLOCK;
+        size_t blockChanged = 0;
+        for (size_t lane = 0; lane < BLOCK; lane++)
+            blockChanged += changed[i + lane];
+        if (blockChanged == 0)
+            continue;
+
+        // the unchanged lanes of the block come out as they were
+        computeMatrices<simd::Lanes>(i, positionX.data(), positionY.data(), positionZ.data(), rotationX.data(),
+                                     rotationY.data(), rotationZ.data(), rotationW.data(), scales.data(),
+                                     worlds.data());
+        std::fill_n(changed.begin() + (std::ptrdiff_t)i, BLOCK, 0);
+        updated += blockChanged;
+    }
+    return updated;
+}
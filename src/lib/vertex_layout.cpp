@@ -0,0 +1,195 @@
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/packing.hpp"
+
+namespace {
+    constexpr VertexFormatInfo FORMATS[] = {
+        {1, GL_FLOAT, false, 4},                        // FLOAT
+        {2, GL_FLOAT, false, 8},                        // FLOAT2
+        {3, GL_FLOAT, false, 12},                       // FLOAT3
+        {4, GL_FLOAT, false, 16},                       // FLOAT4
+        {2, GL_HALF_FLOAT, false, 4},                   // HALF2
+        {2, GL_UNSIGNED_SHORT, true, 4},                // UNORM16_2
+        {4, GL_SHORT, true, 8},                         // SNORM16_4
+        {4, GL_INT_2_10_10_10_REV, true, 4},            // OCT_10_10_10_2
+    };
+
+    int16_t snorm16(const float value)
+    {
+        return (int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+    }
+
+    uint32_t snorm10(const float value)
+    {
+        return (uint32_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f) & 0x3FFu;
+    }
+
+    // octahedral mapping of a unit vector onto [-1, 1]^2
+    glm::vec2 octEncode(glm::vec3 n)
+    {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (n.z >= 0.0f)
+            return {n.x, n.y};
+        return {(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)};
+    }
+
+    // value holds up to 4 floats read from the source attribute
+    void encode(const VertexFormat format, const float *value, const int components, const glm::vec3 &center,
+                const glm::vec3 &halfExtent, unsigned char *out)
+    {
+        switch (format)
+        {
+            case VertexFormat::FLOAT:
+            case VertexFormat::FLOAT2:
+            case VertexFormat::FLOAT3:
+            case VertexFormat::FLOAT4:
+            {
+                float padded[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+                std::memcpy(padded, value, sizeof(float) * (size_t)std::min(components, 4));
+                std::memcpy(out, padded, vertexFormatInfo(format).size);
+                break;
+            }
+            case VertexFormat::HALF2:
+            {
+                const uint16_t half[2] = {glm::packHalf1x16(value[0]), glm::packHalf1x16(value[1])};
+                std::memcpy(out, half, sizeof(half));
+                break;
+            }
+            case VertexFormat::UNORM16_2:
+            {
+                const uint16_t unorm[2] = {(uint16_t)std::lround(std::clamp(value[0], 0.0f, 1.0f) * 65535.0f),
+                                           (uint16_t)std::lround(std::clamp(value[1], 0.0f, 1.0f) * 65535.0f)};
+                std::memcpy(out, unorm, sizeof(unorm));
+                break;
+            }
+            case VertexFormat::SNORM16_4:
+            {
+                const int16_t snorm[4] = {snorm16((value[0] - center.x) / halfExtent.x),
+                                          snorm16((value[1] - center.y) / halfExtent.y),
+                                          snorm16((value[2] - center.z) / halfExtent.z), 32767};
+                std::memcpy(out, snorm, sizeof(snorm));
+                break;
+            }
+            case VertexFormat::OCT_10_10_10_2:
+            {
+                const glm::vec2 oct = octEncode(glm::vec3(value[0], value[1], value[2]));
+                const uint32_t handedness = components > 3 && value[3] < 0.0f ? 0x3u : 0x1u;   // -1 or 1 as 2-bit snorm
+                const uint32_t packed = snorm10(oct.x) | snorm10(oct.y) << 10 | handedness << 30;
+                std::memcpy(out, &packed, sizeof(packed));
+                break;
+            }
+        }
+    }
+}
+
+const VertexFormatInfo& vertexFormatInfo(const VertexFormat format)
+{
+    return FORMATS[(int)format];
+}
+
+VertexLayout::VertexLayout(const std::initializer_list<VertexAttribute> attributes)
+    : VertexLayout(std::vector<VertexAttribute>(attributes))
+{
+}
+
+VertexLayout::VertexLayout(std::vector<VertexAttribute> attributes) : attributeList(std::move(attributes))
+{
+    for (VertexAttribute &attribute : attributeList)
+    {
+        attribute.offset = vertexStride;
+        vertexStride += (vertexFormatInfo(attribute.format).size + 3) / 4 * 4;
+    }
+}
+
+const VertexAttribute* VertexLayout::find(const VertexSemantic semantic) const
+{
+    for (const VertexAttribute &attribute : attributeList)
+        if (attribute.semantic == semantic)
+            return &attribute;
+    return nullptr;
+}
+
+bool VertexLayout::operator==(const VertexLayout &other) const
+{
+    if (attributeList.size() != other.attributeList.size())
+        return false;
+    for (size_t i = 0; i < attributeList.size(); i++)
+    {
+        const VertexAttribute &a = attributeList[i], &b = other.attributeList[i];
+        if (a.semantic != b.semantic || a.location != b.location || a.format != b.format)
+            return false;
+    }
+    return true;
+}
+
+void VertexLayout::setup(const unsigned int binding) const
+{
+    for (const VertexAttribute &attribute : attributeList)
+    {
+        // like glVertexAttribPointer, integer formats are converted to float for the shader
+        const VertexFormatInfo &info = vertexFormatInfo(attribute.format);
+        glVertexAttribFormat(attribute.location, info.components, info.type, info.normalized ? GL_TRUE : GL_FALSE,
+                             attribute.offset);
+        glVertexAttribBinding(attribute.location, binding);
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+Mesh convertMesh(const Mesh &mesh, const VertexLayout &from, const VertexLayout &to)
+{
+    Mesh result = mesh;
+    result.vertexSize = to.stride();
+    const size_t vertexCount = mesh.vertexCount();
+    result.vertices.assign(vertexCount * to.stride(), 0);
+
+    // bounds of the positions, for the quantized formats
+    glm::vec3 center(0.0f), halfExtent(1.0f);
+    const VertexAttribute *position = from.find(VertexSemantic::POSITION);
+    if (position != nullptr && vertexCount > 0)
+    {
+        glm::vec3 low(INFINITY), high(-INFINITY);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 p;
+            std::memcpy(&p, mesh.vertices.data() + v * mesh.vertexSize + position->offset, sizeof(p));
+            low = glm::min(low, p);
+            high = glm::max(high, p);
+        }
+        center = (low + high) * 0.5f;
+        // a flat axis keeps a tiny extent, so it never divides by zero
+        halfExtent = glm::max((high - low) * 0.5f, glm::vec3(1e-6f));
+    }
+
+    const VertexAttribute *quantizedPosition = to.find(VertexSemantic::POSITION);
+    if (quantizedPosition != nullptr && quantizedPosition->format == VertexFormat::SNORM16_4)
+    {
+        result.positionTransform = mesh.positionTransform * glm::scale(glm::translate(glm::mat4(1.0f), center), halfExtent);
+        // rounding moves a position by up to half a step on each axis, which the meshlet spheres must still hold
+        for (Meshlet &meshlet : result.meshlets)
+            meshlet.radius += glm::length(halfExtent) * 0.5f / 32767.0f;
+    }
+
+    for (const VertexAttribute &attribute : to.attributes())
+    {
+        const VertexAttribute *source = from.find(attribute.semantic);
+        if (source == nullptr)
+            continue;
+        const int components = vertexFormatInfo(source->format).components;
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            float value[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+            std::memcpy(value, mesh.vertices.data() + v * mesh.vertexSize + source->offset, sizeof(float) * (size_t)components);
+            encode(attribute.format, value, components, center, halfExtent,
+                   result.vertices.data() + v * to.stride() + attribute.offset);
+        }
+    }
+    return result;
+}
@@ -1,5 +1,11 @@
 // Standard libraries
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
 
 // Included libraries
 #include <glad/glad.h>
@@ -12,6 +18,27 @@
 
 // Headers
 #include "shader.h"
+#include "shader_compiler.h"
+#include "program_cache.h"
+#include "stage_cache.h"
+#include "uniform_block.h"
+#include "pipeline.h"
+#include "mesh_builder.h"
+#include "vertex_layout.h"
+#include "mesh_registry.h"
+#include "mesh_importer.h"
+#include "mesh_file.h"
+#include "lod_selector.h"
+#include "frustum_culler.h"
+#include "bvh.h"
+#include "occlusion_culler.h"
+#include "hiz_culler.h"
+#include "meshlet_culler.h"
+#include "streaming_ring_buffer.h"
+#include "transform_system.h"
+#include "cube_field.h"
+#include "frame_timer.h"
+#include "shader_blocks.h"
 #include "camera.h"
 
 
@@ -81,13 +108,71 @@ void scroll_callback(GLFWwindow* window, const double xoffset, const double yoff
     camera.Camera::ProcessMouseScroll((float)yoffset);
 }
 
+// How much a quantized mesh (positionTransform from convertMesh) is scaled by to the size of the unit cube
+float cubeFitScale(const glm::mat4 &positionTransform)
+{
+    const glm::vec3 halfExtent(positionTransform[0][0], positionTransform[1][1], positionTransform[2][2]);
+    return 0.5f / glm::max(halfExtent.x, glm::max(halfExtent.y, halfExtent.z));
+}
+
+// The mesh scaled to the size of the unit cube, centered
+glm::mat4 fitToCube(const glm::mat4 &positionTransform)
+{
+    const glm::vec3 halfExtent(positionTransform[0][0], positionTransform[1][1], positionTransform[2][2]);
+    return glm::scale(glm::mat4(1.0f), halfExtent * cubeFitScale(positionTransform));
+}
+
+// The positions (SNORM16, first in each vertex) and indices of a quantized mesh, before its positionTransform
+void quantizedTriangles(const MeshView &mesh, std::vector<glm::vec3> &positions, std::vector<uint32_t> &indices)
+{
+    positions.resize(mesh.vertexCount);
+    for (size_t v = 0; v < mesh.vertexCount; v++)
+    {
+        int16_t packed[3];
+        std::memcpy(packed, mesh.vertices + v * mesh.vertexSize, sizeof(packed));
+        positions[v] = glm::max(glm::vec3(packed[0], packed[1], packed[2]) / 32767.0f, glm::vec3(-1.0f));
+    }
+    indices.resize(mesh.indexCount);
+    for (size_t i = 0; i < mesh.indexCount; i++)
+        indices[i] = mesh.indexType == GL_UNSIGNED_SHORT ? reinterpret_cast<const uint16_t*>(mesh.indices)[i]
+                                                          : reinterpret_cast<const uint32_t*>(mesh.indices)[i];
+}
 
-int main() {
+
+// Usage: OpenGL [cube count] [--per-draw] [--gpu-cull] [--occlusion-cull] [--hiz-cull] [--mesh file.obj|file.glb|file.mesh]
+// (10 instanced cubes by default, their meshlets culled on the CPU)
+int main(const int argc, char **argv) {
+
+    // Scene size and draw path
+    size_t cubeCount = 10;
+    bool instanced = true;
+    bool gpuCull = false;
+    bool occlusionCull = false;
+    bool hizCull = false;
+    const char *meshPath = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--per-draw") == 0)
+            instanced = false;
+        else if (std::strcmp(argv[i], "--gpu-cull") == 0)
+            gpuCull = true;
+        else if (std::strcmp(argv[i], "--occlusion-cull") == 0)
+            occlusionCull = true;
+        else if (std::strcmp(argv[i], "--hiz-cull") == 0)
+            hizCull = true;
+        else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            meshPath = argv[++i];
+        else if (std::atol(argv[i]) > 0)
+            cubeCount = (size_t)std::atol(argv[i]);
+    }
+    // both cull on the GPU; the Hi-Z culling takes over from the meshlet culling, and needs the instanced path
+    hizCull = hizCull && instanced;
+    gpuCull = gpuCull && !hizCull;
 
     // GLFW initialization:
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // Major OpenGL version
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // Minor OpenGL version
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); // Major OpenGL version
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5); // Minor OpenGL version (4.5 is what Mesa's llvmpipe exposes)
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Creating window object:
@@ -117,6 +202,32 @@ int main() {
     // Window input mode
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    // Submit every shader program up front: the driver compiles them while we load everything else,
+    // and the render loop picks them up as they finish
+    ShaderCompiler shaderCompiler((GLADloadproc)glfwGetProcAddress);
+    shaderCompiler.expectLayouts({std::begin(SHADER_BLOCK_LAYOUTS), std::end(SHADER_BLOCK_LAYOUTS)});
+    const ShaderHandle customShader = shaderCompiler.submit(
+        "src/shaders/default/default.vert",
+        "src/shaders/default/default.frag"
+    );
+
+    // The lamp and the lit objects are permutations of the same light shaders
+    enum LightFeatures : uint32_t { LIGHT_SOURCE = 1u << 0, INSTANCED = 1u << 1 };
+    ShaderVariants lightShaders(
+        shaderCompiler,
+        "src/shaders/light/lighting.vert",
+        "src/shaders/light/lighting.frag",
+        {"LIGHT_SOURCE", "INSTANCED"}
+    );
+    const ShaderHandle lightSourceShader = lightShaders.variant(LIGHT_SOURCE);
+    const ShaderHandle lightingShader = lightShaders.variant(instanced ? INSTANCED : 0);
+    const ShaderHandle meshletCullShader = gpuCull && instanced ? shaderCompiler.submitCompute(GpuMeshletCuller::PROGRAM_PATH)
+                                                                : ShaderHandle();
+    const ShaderHandle hizBuildShader = hizCull && instanced ? shaderCompiler.submitCompute(HizCuller::BUILD_PATH)
+                                                             : ShaderHandle();
+    const ShaderHandle hizCullShader = hizCull && instanced ? shaderCompiler.submitCompute(HizCuller::CULL_PATH)
+                                                            : ShaderHandle();
+
     /////////////////////////////////////////
 
     constexpr float vertices[] = {
@@ -163,77 +274,191 @@ int main() {
         -0.5f, 0.5f, -0.5f, 0.0f, 1.0f
     };
 
-    constexpr unsigned int indices[] = {};
-
-    glm::vec3 cubePositions[] = {
-        glm::vec3( 0.0f, -1.0f, 0.0f),
-        glm::vec3( 2.0f, 5.0f, -10.0f),
-        glm::vec3(-1.5f, -2.2f, -2.5f),
-        glm::vec3(-3.8f, -2.0f, -12.3f),
-        glm::vec3( 2.4f, -0.4f, -3.5f),
-        glm::vec3(-1.7f, 3.0f, -7.5f),
-        glm::vec3( 1.3f, -2.0f, -2.5f),
-        glm::vec3( 1.5f, 2.0f, -2.5f),
-        glm::vec3( 1.5f, 0.2f, -1.5f),
-        glm::vec3(-1.3f, 1.0f, -1.5f)
-    };
+    const CubeField cubes(cubeCount);
+    // their world matrices, computed in SIMD batches every frame
+    TransformSystem transforms;
+    const size_t firstCube = cubes.addTransforms(transforms);
+    std::cout << "Cube field: " << cubes.size() << " cubes, " << (instanced ? "instanced" : "one draw per cube") << std::endl;
 
     /////////////////////////////////////////
 
-    // 1. Generate and bind the default VAO (Vertex Array Object)
-    unsigned int defaultVAO;
-    glGenVertexArrays(1, &defaultVAO);
-    glBindVertexArray(defaultVAO);
-
-    // 2. Generate and bind the VBO (Vertex Buffer Object)
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // 3. Copy vertex data into the VBO:
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // 4. Set vertex attribute pointers
-    // First attribute (positions):
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)nullptr);
-    glEnableVertexAttribArray(0);
-    // Second attribute (colors):
-    //glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    //glEnableVertexAttribArray(1);
-    // Third attribute (texture coords):
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // 5. Generate and bind EBO (Element Buffer Object)
-    unsigned int EBO;
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    // 6. Unbind the VAO, VBO and EBO
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-
-    // 1. Generate and bind the light source VAO
-    unsigned int lightSourceVAO;
-    glGenVertexArrays(1, &lightSourceVAO);
-    glBindVertexArray(lightSourceVAO);
-
-    // 2. Bind the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // 3. Set vertex attribute pointers
-    // First attribute (positions):
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)nullptr);
-    glEnableVertexAttribArray(0);
-    // Second attribute (colors):
-    //glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    //glEnableVertexAttribArray(1);
-
-    // 4. Unbind the VAO, VBO and EBO
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // 1. Vertex layouts: the cube is authored as floats (20 bytes per vertex) and stored quantized (12 bytes)
+    const VertexLayout cubeSourceLayout = {
+        {VertexSemantic::POSITION, 0, VertexFormat::FLOAT3},
+        {VertexSemantic::TEXCOORD, 2, VertexFormat::FLOAT2}
+    };
+    const VertexLayout cubeLayout = {
+        {VertexSemantic::POSITION, 0, VertexFormat::SNORM16_4},
+        {VertexSemantic::TEXCOORD, 2, VertexFormat::UNORM16_2}
+    };
+
+    // 2. Weld the cube into unique vertices + indices, ordered for the vertex cache, overdraw and fetch, then quantize;
+    // or import the mesh given on the command line instead, quantized the same way and scaled to the cube's size.
+    // A .mesh cache (meshc) is already welded and quantized, and comes with its levels of detail: it is mapped and
+    // used as is
+    const double importStart = glfwGetTime();
+    const std::string meshFilePath = meshPath != nullptr ? meshPath : "";
+    const bool cachedMesh = meshFilePath.size() > 5 && meshFilePath.compare(meshFilePath.size() - 5, 5, ".mesh") == 0;
+    std::unique_ptr<MeshFile> meshFile;
+    if (cachedMesh)
+    {
+        meshFile = std::make_unique<MeshFile>(meshFilePath);
+        if (meshFile->valid() && (meshFile->layout() != cubeLayout || meshFile->submeshCount() == 0))
+            std::cout << "ERROR::MAIN::MESH_LAYOUT: " << meshFilePath << " is not in the cube's layout (convert it with meshc, "
+                      << "without --normals or --float)" << std::endl;
+        if (!meshFile->valid() || meshFile->layout() != cubeLayout || meshFile->submeshCount() == 0)
+            meshFile.reset();
+    }
+    const Mesh cube = [&]() {
+        ImportedMesh imported;
+        if (meshPath != nullptr && !cachedMesh && importMesh(meshPath, imported))
+        {
+            std::cout << "Imported " << meshPath << ": " << imported.mesh.indexCount / 3 << " triangles, "
+                      << imported.mesh.vertexCount() << " vertices in " << (glfwGetTime() - importStart) * 1000.0 << " ms"
+                      << " (no levels of detail, meshc makes them)" << std::endl;
+            buildMeshlets(imported.mesh, imported.layout.find(VertexSemantic::POSITION)->offset);
+            return convertMesh(imported.mesh, imported.layout, cubeLayout);
+        }
+        if (meshFile != nullptr)
+            return Mesh();
+        MeshBuilder cubeBuilder(cubeSourceLayout.stride());
+        cubeBuilder.addTriangles(vertices, std::size(vertices) / 5);
+        return convertMesh(cubeBuilder.build("cube"), cubeSourceLayout, cubeLayout);
+    }();
+
+    // every level of detail of the cube, with its error in model units
+    std::vector<MeshView> cubeLevels = {cube};
+    std::vector<float> lodErrors = {0.0f};
+    if (meshFile != nullptr)
+    {
+        cubeLevels.clear();
+        lodErrors.clear();
+        for (size_t level = 0; level < meshFile->lodCount(0); level++)
+        {
+            cubeLevels.push_back(meshFile->view(level));
+            lodErrors.push_back(meshFile->submesh(level).lodError);
+        }
+    }
+    const float lodScale = meshPath != nullptr ? cubeFitScale(cubeLevels[0].positionTransform) : 1.0f;
+    const glm::mat4 cubeTransform = meshPath != nullptr ? fitToCube(cubeLevels[0].positionTransform)
+                                                        : cubeLevels[0].positionTransform;
+    // the meshlet bounds are in the space the mesh's own positionTransform leads to
+    const glm::mat4 meshletTransform = cubeTransform * glm::inverse(cubeLevels[0].positionTransform);
+
+    // 3. Sub-allocate it into the shared vertex and index buffers of its layout (the vertex layouts live in the
+    // pipelines below, which the registry's buffers are attached to)
+    MeshRegistry meshRegistry(cubeLayout, cubeLevels[0].indexType);
+    // a level the registry refuses is left out, with its error; without the full detail one there is nothing to draw
+    std::vector<int> cubeLods;
+    std::vector<float> addedLodErrors;
+    for (size_t level = 0; level < cubeLevels.size(); level++)
+    {
+        cubeLevels[level].positionTransform = cubeTransform;
+        const int mesh = meshRegistry.add(cubeLevels[level]);
+        if (mesh < 0)
+        {
+            std::cout << "ERROR::MAIN::MESH_NOT_ADDED: level of detail " << level << std::endl;
+            if (level == 0)
+            {
+                glfwTerminate();
+                return -1;
+            }
+            continue;
+        }
+        cubeLods.push_back(mesh);
+        addedLodErrors.push_back(lodErrors[level]);
+    }
+    lodErrors = addedLodErrors;
+    const int cubeMesh = cubeLods[0];
+    if (meshFile != nullptr)
+        std::cout << "Loaded " << meshFilePath << ": " << cubeLevels[0].indexCount / 3 << " triangles, "
+                  << cubeLevels[0].vertexCount << " vertices, " << cubeLods.size() - 1 << " levels of detail in "
+                  << (glfwGetTime() - importStart) * 1000.0 << " ms" << std::endl;
+    // the occluders of the CPU occlusion culling below are the cubes' own triangles
+    std::vector<glm::vec3> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
+    quantizedTriangles(cubeLevels[0], occluderPositions, occluderIndices);
+    meshFile.reset();   // the buffers hold their own copy now
+
+    // 4. Each cube is drawn at the coarsest level whose error stays under a pixel; in world units the errors scale
+    // with the cube, whose bounding sphere they are measured from
+    LodSelector lodSelector;
+    lodSelector.resize(cubes.size());
+    std::vector<float> cubeLodErrors;
+    for (const float error : lodErrors)
+        cubeLodErrors.push_back(error * lodScale * CubeField::SCALE);
+    const float cubeRadius = glm::length(glm::vec3(cubeTransform[0][0], cubeTransform[1][1], cubeTransform[2][2]))
+                             * CubeField::SCALE;
+    std::vector<unsigned int> lodInstances(cubeLods.size()), lodFirst(cubeLods.size()), lodNext(cubeLods.size());
+    size_t lodTriangles = 0;    // drawn in the last frame
+
+    // 5. Cubes whose bounding sphere is outside the frustum are skipped before anything else
+    FrustumCuller frustumCuller;
+    for (size_t i = 0; i < cubes.size(); i++)
+        frustumCuller.addSphere(cubes.position(i), cubeRadius);
+    // and their boxes, refit as they spin, go in a bounding volume hierarchy the left mouse button casts the view
+    // ray into, to pick the cube in the middle of the screen
+    const Aabb cubeBox = {glm::vec3(-1.0f), glm::vec3(1.0f)};    // quantized positions, before cubeTransform
+    Bvh cubeTree;
+    std::vector<Aabb> cubeBoxes;
+    for (size_t i = 0; i < cubes.size(); i++)
+        cubeBoxes.push_back({cubes.position(i) - cubeRadius, cubes.position(i) + cubeRadius});
+    cubeTree.build(cubeBoxes);
+    bool picking = false;
+    // with --occlusion-cull, the nearest cubes in the frustum are drawn into a small depth buffer on the CPU, and
+    // those whose boxes are entirely behind them are skipped as well
+    constexpr size_t OCCLUDERS = 16;
+    OcclusionCuller occlusionCuller;
+    std::vector<uint32_t> nearestCubes;
+
+    // 6. The meshlets of each cube outside the frustum or facing away are not drawn: a cube kept whole is instanced
+    // with the others of its level, one with some meshlets culled gets a draw per run of kept ones, of its own
+    // instance. With --gpu-cull a compute shader culls the meshlets of every instance and writes the draws instead
+    MeshletCuller meshletCuller(meshRegistry);
+    std::vector<MeshletCoverage> cubeCoverage(cubes.size());
+    GpuMeshletCuller gpuMeshletCuller(meshRegistry, meshletCullShader);
+    gpuCull = gpuCull && instanced && meshRegistry.range(cubeMesh).meshletCount > 0;
+    size_t gpuCullDraws = 0;
+    for (const int lod : cubeLods)
+        gpuCullDraws = std::max<size_t>(gpuCullDraws, meshRegistry.range(lod).meshletCount);
+    gpuCullDraws *= cubes.size();
+
+    // 7. With --hiz-cull every cube goes to the GPU instead, which culls them against the frustum and against the
+    // depth of what it drew: the cubes visible last frame are drawn first, into an offscreen target whose depth is a
+    // texture, then the others are tested against its hierarchical Z and the newly visible ones drawn. Levels of
+    // detail are picked there as well; meshlets are not culled
+    HizCuller hizCuller(meshRegistry, hizBuildShader, hizCullShader);
+    std::vector<float> hizLodErrors;
+    for (const float error : lodErrors)
+        hizLodErrors.push_back(error * lodScale);
+    hizCuller.setLevels(cubeLods, hizLodErrors, cubeRadius / CubeField::SCALE);
+    unsigned int hizFramebuffer = 0, hizColor = 0, hizDepth = 0;
+    if (hizCull)
+    {
+        glGenFramebuffers(1, &hizFramebuffer);
+        glGenRenderbuffers(1, &hizColor);
+        glBindRenderbuffer(GL_RENDERBUFFER, hizColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glGenTextures(1, &hizDepth);
+        glBindTexture(GL_TEXTURE_2D, hizDepth);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, hizFramebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, hizColor);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, hizDepth, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER::HIZ_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        hizCuller.setDepth(hizDepth, SCR_WIDTH, SCR_HEIGHT);
+    }
+
+    // 8. Per-frame dynamic data (the PerFrame block, and the instances on the instanced path) is written straight
+    // into a persistently mapped ring of three frames; the culling shaders read the instances as shader storage
+    const size_t uniformAlignment = StreamingRingBuffer::uniformAlignment();
+    const size_t instanceAlignment = gpuCull || hizCull ? StreamingRingBuffer::storageAlignment() : 16;
+    StreamingRingBuffer frameData(sizeof(PerFrameBlock) + uniformAlignment
+                                  + (instanced ? cubes.size() * sizeof(CubeInstance) + instanceAlignment : 0));
 
 
     // 1. Generate textures
@@ -298,66 +523,85 @@ int main() {
     stbi_image_free(data[1]);
 
 
-    // 1. Model matrix
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    // 1. Model matrices come from the CubeField, one per cube
 
     // 2. View matrix
     glm::mat4 viewMatrix = glm::mat4(1.0f);
 
-    // 3. Perspective / Ortho projection matrix
-    glm::mat4 perspMatrix = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    // 3. Perspective / Ortho projection matrix, from the camera's field of view every frame
+    glm::mat4 perspMatrix = glm::mat4(1.0f);
     //glm::mat4 orthoMatrix = glm::ortho(0.0f, (float)SCR_WIDTH, 0.0f, (float)SCR_HEIGHT, 0.0f, 100.0f);
 
+    // 4. Uniform blocks, each bound once for every program (the structs are generated by blockgen);
+    // PerFrame is bound to its slice of the frame data ring every frame instead
+    UniformBlockBuffer<LightingBlock> lightingBuffer;
+    UniformBlockBuffer<MaterialBlock> materialBuffer;
+
+
+    // Until a program is linked we draw with the fallback one, so the uniform handles are resolved from
+    // the fallback first and once more when the real program is ready
+    const Shader &fallbackShader = shaderCompiler.fallback();
+
+    // Every program / vertex layout / state combination the render loop draws with, declared up front
+    Pipeline lightSourcePipeline({
+        "light source",
+        lightSourceShader,
+        cubeLayout,
+        DepthState{}, BlendState{}, CullState{}
+    }, fallbackShader);
+    Pipeline lightingPipeline({
+        "lighting",
+        lightingShader,
+        cubeLayout,
+        DepthState{}, BlendState{}, CullState{},
+        instanced ? CubeField::instanceLayout() : VertexLayout()
+    }, fallbackShader);
+
+    // Warm-up: the first draw of each combination happens now, offscreen, instead of in the first frames. Those
+    // draws read the PerFrame block as well, before the render loop binds its slice of the ring: a zeroed one is
+    // bound until then
+    UniformBlockBuffer<PerFrameBlock> warmupPerFrame;
+    warmupPerFrame.write(PerFrameBlock{});
+    PipelineWarmup pipelineWarmup;
+    pipelineWarmup.add(lightSourcePipeline);
+    pipelineWarmup.add(lightingPipeline);
 
     // Setup default shader
-    const Shader customShader(
-        "src/shaders/default/default.vert",
-        "src/shaders/default/default.frag"
-    );
-    customShader.use(); // First we use, then we set the values!
-    customShader.setInt("ourTexture1", 0);
-    customShader.setInt("ourTexture2", 1);
-
-    // Getting uniforms' locations
-    const unsigned int modelMatLocCustom = glGetUniformLocation(customShader.ID,"model");
-    const unsigned int viewMatLocCustom = glGetUniformLocation(customShader.ID,"view");
-    const unsigned int projMatLocCustom = glGetUniformLocation(customShader.ID,"projection");
-
+    customShader.onReady([&](const Shader &shader) {
+        shader.use(); // First we use, then we set the values!
+        shader.setInt("ourTexture1", 0);
+        shader.setInt("ourTexture2", 1);
+    });
 
     // Setup light source shader
-    const Shader lightSourceShader(
-        "src/shaders/light/lightSource.vert",
-        "src/shaders/light/lightSource.frag"
-    );
-    lightSourceShader.use();
-    lightSourceShader.setVec3("objectColor", glm::vec3(1.0f, 0.5f, 0.31f));
-    lightSourceShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-
-    const unsigned int modelMatLocLighting = glGetUniformLocation(customShader.ID,"model");
-    const unsigned int viewMatLocLighting = glGetUniformLocation(customShader.ID,"view");
-    const unsigned int projMatLocLighting = glGetUniformLocation(customShader.ID,"projection");
+    Uniform<glm::mat4> modelMatLightSource;
+    const auto setupLightSource = [&](const Shader &shader) {
+        modelMatLightSource = shader.uniform<glm::mat4>("model");
+    };
+    setupLightSource(fallbackShader);
+    lightSourceShader.onReady(setupLightSource);
 
     // Setup lighting shader
-    const Shader lightingShader(
-        "src/shaders/light/lighting.vert",
-        "src/shaders/light/lighting.frag"
-    );
-    lightingShader.use();
-    lightingShader.setVec3("objectColor", glm::vec3(1.0f, 0.5f, 0.31f));
-    lightingShader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-
-    const unsigned int modelMatLocLightSource = glGetUniformLocation(customShader.ID,"model");
-    const unsigned int viewMatLocLightSource = glGetUniformLocation(customShader.ID,"view");
-    const unsigned int projMatLocLightSource = glGetUniformLocation(customShader.ID,"projection");
-
+    // Resolving uniform handles once, outside the render loop
+    Uniform<glm::mat4> modelMatLighting;
+    Uniform<float> alphaLighting;
+    const auto setupLighting = [&](const Shader &shader) {
+        modelMatLighting = shader.uniform<glm::mat4>("model");
+        alphaLighting = shader.uniform<float>("alpha");
+    };
+    setupLighting(fallbackShader);
+    lightingShader.onReady(setupLighting);
 
-    // Enable Z-Buffer
-    glEnable(GL_DEPTH_TEST);
+    // Startup report of the shader caches, once every program is resolved
+    const auto reportShaderCaches = [] {
+        ProgramCache::get().report();
+        StageCache::get().report();
+    };
+    if (shaderCompiler.poll() == 0)
+        reportShaderCaches();
 
-    // Bind VAO
-    glBindVertexArray(defaultVAO);
 
-    // To draw, we use the shader program (VAO is already binded)
+    // Textures used by the default shader
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, textures[0]);
     glActiveTexture(GL_TEXTURE1);
@@ -366,19 +610,39 @@ int main() {
     // Light source
     glm::vec3 lightPos(0.0f, 0.0f, 0.0f);
 
+    // Light and material blocks are written whole, once, straight from their C++ mirrors
+    LightingBlock lighting{};
+    lighting.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    lighting.lightPosition = lightPos;
+    lightingBuffer.write(lighting);
+
+    MaterialBlock material{};
+    material.objectColor = glm::vec3(1.0f, 0.5f, 0.31f);
+    materialBuffer.write(material);
+
+    // Draws of the lighting pass, rebuilt every frame and submitted in one call
+    IndirectDrawList lightingDraws;
+
+    // Frame-time tracking, to catch hitches
+    FrameTimer frameTimer;
+
     // Render loop
     while(!glfwWindowShouldClose(window))
     {
         // Handle user input
         processInput(window);
 
-        // Render commands
+        // Render commands, offscreen with --hiz-cull
+        if (hizCull)
+            glBindFramebuffer(GL_FRAMEBUFFER, hizFramebuffer);
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         // Clear screen and Z-Buffer
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Time
-        const float currentFrame = (float)glfwGetTime();
+        // Time, sampled once for the frame
+        const double now = glfwGetTime();
+        const float currentFrame = (float)now;
+        frameTimer.frame(now);
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
@@ -387,6 +651,61 @@ int main() {
         glfwSetScrollCallback(window, scroll_callback);
 
         viewMatrix = camera.Camera::GetViewMatrix();
+        perspMatrix = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        lodSelector.setView(camera.Position, camera.Zoom, SCR_HEIGHT);
+        meshletCuller.setView(perspMatrix * viewMatrix, camera.Position);
+        frustumCuller.setView(perspMatrix * viewMatrix);
+        const std::vector<uint32_t> &frustumCubes = frustumCuller.cullSpheres();
+        cubes.animate(currentFrame, transforms, firstCube);
+        transforms.update();
+        for (size_t i = 0; i < cubes.size(); i++)
+            cubeTree.update((uint32_t)i, transformBox(cubeBox, transforms.world(firstCube + i) * cubeTransform));
+        cubeTree.rebuildIfDegraded();
+        const bool clicked = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (clicked && !picking)
+        {
+            const BvhHit hit = cubeTree.raycast(camera.Position, camera.Front, 100.0f);
+            if (hit.object != Bvh::NONE)
+                std::cout << "Picked cube " << hit.object << ", " << hit.distance << " units away" << std::endl;
+        }
+        picking = clicked;
+        if (occlusionCull)
+        {
+            const size_t occluders = std::min(OCCLUDERS, frustumCubes.size());
+            nearestCubes.assign(frustumCubes.begin(), frustumCubes.end());
+            std::partial_sort(nearestCubes.begin(), nearestCubes.begin() + occluders, nearestCubes.end(),
+                              [&](const uint32_t a, const uint32_t b) {
+                                  return glm::distance(cubes.position(a), camera.Position)
+                                         < glm::distance(cubes.position(b), camera.Position);
+                              });
+            occlusionCuller.begin(perspMatrix * viewMatrix);
+            for (size_t k = 0; k < occluders; k++)
+                occlusionCuller.addOccluder(occluderPositions, occluderIndices,
+                                            transforms.world(firstCube + nearestCubes[k]) * cubeTransform);
+            occlusionCuller.rasterize();
+        }
+        const std::vector<uint32_t> &visibleCubes = occlusionCull
+            ? occlusionCuller.cull(frustumCubes, [&](const uint32_t i) { return cubeTree.box(i); })
+            : frustumCubes;
+
+        // This frame's region of the ring; waits only if the GPU still reads it from three frames ago
+        frameData.beginFrame();
+
+        // Per-frame data, written once and read by every program through the PerFrame block
+        PerFrameBlock perFrame{};
+        perFrame.view = viewMatrix;
+        perFrame.projection = perspMatrix;
+        perFrame.viewProj = perspMatrix * viewMatrix;
+        perFrame.cameraPosition = glm::vec4(camera.Position, 1.0f);
+        perFrame.time = currentFrame;
+        perFrame.deltaTime = deltaTime;
+        const RingAllocation perFrameData = frameData.write(&perFrame, sizeof(perFrame), uniformAlignment);
+        glBindBufferRange(GL_UNIFORM_BUFFER, PerFrameBlock::BINDING, frameData.buffer(), perFrameData.offset,
+                          perFrameData.size);
+
+        // Pick up the programs the driver has finished compiling
+        if (shaderCompiler.pending() > 0 && shaderCompiler.poll() == 0)
+            reportShaderCaches();
 
 
         // Render light
@@ -394,55 +713,225 @@ int main() {
         model = glm::translate(model, lightPos);
         model = glm::scale(model, glm::vec3(0.2f));
 
-        lightSourceShader.use();
-        glBindVertexArray(lightSourceVAO);
+        lightSourcePipeline.bind();
+        meshRegistry.bind(lightSourcePipeline);
 
-        glUniformMatrix4fv((int)modelMatLocLightSource, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv((int)viewMatLocLightSource, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-        glUniformMatrix4fv((int)projMatLocLightSource, 1, GL_FALSE, glm::value_ptr(perspMatrix));
+        // quantized positions are relative to the cube bounds
+        modelMatLightSource.set(model * cubeTransform);
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        meshRegistry.draw(cubeMesh);
 
 
         // Render objects
-        lightingShader.use();
-        glBindVertexArray(defaultVAO);
-
-        // Apply matrix transformations
-        glUniformMatrix4fv((int)modelMatLocCustom, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix4fv((int)viewMatLocCustom, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-        glUniformMatrix4fv((int)projMatLocCustom, 1, GL_FALSE, glm::value_ptr(perspMatrix));
-
-        for (unsigned int i = 0; i < std::size(cubePositions); i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-
-            // Transform cube
-            model = glm::rotate(model, glm::radians(20 * (float)glfwGetTime() + (float)(i * i)), glm::vec3(0.0, 1.0, 0.0));
-            model = glm::rotate(model, glm::radians(20 * (float)glfwGetTime() + (float)(i * i)), glm::vec3(1.0, 0.0, 0.0));
-            model = glm::rotate(model, glm::radians(20 * (float)glfwGetTime() + (float)(i * i)), glm::vec3(0.0, 0.0, 1.0));
-
-            model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-
-            // Set shader uniforms
-            customShader.setFloat("alpha", (float)pow(sinf((float)glfwGetTime() + 100.0f * (float)i), 2));
-
-            glUniformMatrix4fv((int)modelMatLocCustom, 1, GL_FALSE, glm::value_ptr(model));
+        lightingPipeline.bind();
+        meshRegistry.bind(lightingPipeline);
+
+        // The instances of this frame, every cube for Hi-Z culling, those in view otherwise. When the ring cannot take
+        // them (it reported why) the instanced paths draw nothing this frame
+        const bool hizPass = hizCull && hizCuller.ready();
+        const RingAllocation instanceData = instanced
+            ? frameData.allocate((hizPass ? cubes.size() : visibleCubes.size()) * sizeof(CubeInstance), instanceAlignment)
+            : RingAllocation{};
+
+        if (instanced && instanceData.data == nullptr)
+            lodTriangles = 0;
+        else if (hizPass)
+        {
+            // Every cube into the ring, in the same order every frame; the GPU draws those visible last frame, then
+            // those that came out from behind them
+            cubes.instances(currentFrame, static_cast<CubeInstance*>(instanceData.data));
+            const float pixelsPerUnit = (float)SCR_HEIGHT / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f));
+            hizCuller.begin(perspMatrix * viewMatrix, camera.Position, pixelsPerUnit, frameData.buffer(),
+                            (GLintptr)instanceData.offset, cubes.size());
+
+            hizCuller.cullFirst();
+            lightingPipeline.bind();
+            lightingPipeline.setInstanceBuffer(hizCuller.instanceBuffer(), 0);
+            modelMatLighting.set(cubeTransform);
+            hizCuller.drawFirst();
+
+            hizCuller.cullSecond();
+            lightingPipeline.bind();
+            hizCuller.drawSecond();
+        }
+        else if (instanced && gpuCull && gpuMeshletCuller.ready())
+        {
+            // Every cube in view grouped by level into the ring, then culled meshlet by meshlet on the GPU, which writes the
+            // draws of the kept ones
+            std::fill(lodInstances.begin(), lodInstances.end(), 0u);
+            for (const uint32_t i : visibleCubes)
+                lodInstances[lodSelector.select(i, cubes.position(i), cubeRadius, cubeLodErrors.data(),
+                                                (unsigned int)cubeLods.size())]++;
+            for (size_t level = 1; level < cubeLods.size(); level++)
+                lodFirst[level] = lodFirst[level - 1] + lodInstances[level - 1];
+            lodNext = lodFirst;
+
+            auto *instances = static_cast<CubeInstance*>(instanceData.data);
+            for (const uint32_t i : visibleCubes)
+                instances[lodNext[lodSelector.level(i)]++] = cubes.instance(i, currentFrame);
+
+            gpuMeshletCuller.begin(perspMatrix * viewMatrix, camera.Position, gpuCullDraws);
+            lodTriangles = 0;   // before culling, which only the GPU knows of
+            for (size_t level = 0; level < cubeLods.size(); level++)
+            {
+                gpuMeshletCuller.cull(cubeLods[level], frameData.buffer(), (GLintptr)instanceData.offset, lodFirst[level],
+                                      lodInstances[level], meshletTransform);
+                lodTriangles += (size_t)lodInstances[level] * meshRegistry.range(cubeLods[level]).indexCount / 3;
+            }
+
+            lightingPipeline.bind();
+            lightingPipeline.setInstanceBuffer(frameData.buffer(), instanceData.offset);
+            modelMatLighting.set(cubeTransform);
+            gpuMeshletCuller.draw();
+        }
+        else if (instanced)
+        {
+            // Every cube in view in one multi-draw: one draw per level of detail for the cubes kept whole, first one draw per
+            // run of meshlets for those partly culled. The per-instance TRS and alpha are written straight into the
+            // ring, the partly culled cubes first, then the others grouped by the level they are drawn at
+            auto *instances = static_cast<CubeInstance*>(instanceData.data);
+            lightingDraws.clear();
+            lodTriangles = 0;
+            unsigned int partial = 0;
+            std::fill(lodInstances.begin(), lodInstances.end(), 0u);
+            for (const uint32_t i : visibleCubes)
+            {
+                const unsigned int level = lodSelector.select(i, cubes.position(i), cubeRadius, cubeLodErrors.data(),
+                                                              (unsigned int)cubeLods.size());
+                const size_t culledBefore = meshletCuller.stats().trianglesCulled;
+                cubeCoverage[i] = meshletCuller.cull(cubeLods[level],
+                                                     transforms.world(firstCube + i) * meshletTransform);
+                lodTriangles += meshRegistry.range(cubeLods[level]).indexCount / 3
+                                - (meshletCuller.stats().trianglesCulled - culledBefore);
+                if (cubeCoverage[i] == MeshletCoverage::ALL)
+                    lodInstances[level]++;
+                else if (cubeCoverage[i] == MeshletCoverage::SOME)
+                {
+                    instances[partial] = cubes.instance(i, currentFrame);
+                    meshletCuller.addVisible(lightingDraws, partial++);
+                }
+            }
+            lodFirst[0] = partial;
+            for (size_t level = 1; level < cubeLods.size(); level++)
+                lodFirst[level] = lodFirst[level - 1] + lodInstances[level - 1];
+            lodNext = lodFirst;
+            for (const uint32_t i : visibleCubes)
+                if (cubeCoverage[i] == MeshletCoverage::ALL)
+                    instances[lodNext[lodSelector.level(i)]++] = cubes.instance(i, currentFrame);
+
+            lightingPipeline.setInstanceBuffer(frameData.buffer(), instanceData.offset);
+            modelMatLighting.set(cubeTransform);
+            for (size_t level = 0; level < cubeLods.size(); level++)
+                if (lodInstances[level] > 0)
+                    lightingDraws.add(meshRegistry.command(cubeLods[level], lodInstances[level], lodFirst[level]));
+            lightingDraws.submit(meshRegistry);
+        }
+        else
+        {
+            lodTriangles = 0;
+            for (const uint32_t i : visibleCubes) {
+                const int lod = cubeLods[lodSelector.select(i, cubes.position(i), cubeRadius, cubeLodErrors.data(),
+                                                            (unsigned int)cubeLods.size())];
+                const size_t culledBefore = meshletCuller.stats().trianglesCulled;
+                const glm::mat4 &world = transforms.world(firstCube + i);
+                const MeshletCoverage coverage = meshletCuller.cull(lod, world * meshletTransform);
+                lodTriangles += meshRegistry.range(lod).indexCount / 3
+                                - (meshletCuller.stats().trianglesCulled - culledBefore);
+                if (coverage == MeshletCoverage::NONE)
+                    continue;
+
+                // Set shader uniforms
+                alphaLighting.set(cubes.alpha(i, currentFrame));
+
+                modelMatLighting.set(world * cubeTransform);
+
+                // Draw models, whole or the runs of meshlets kept
+                if (coverage == MeshletCoverage::ALL)
+                    meshRegistry.draw(lod);
+                else
+                {
+                    lightingDraws.clear();
+                    meshletCuller.addVisible(lightingDraws, 0);
+                    lightingDraws.submit(meshRegistry);
+                }
+            }
+        }
 
-            // Draw models
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        if (hizCull)
+        {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, hizFramebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
 
+        UniformUploadStats::get().endFrame();
+        meshletCuller.endFrame();
+        frustumCuller.endFrame();
+        occlusionCuller.endFrame();
+        frameData.endFrame();
+
         // Call events and swap buffer
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    frameTimer.report();
+    std::cout << "Pipelines warmed up: " << pipelineWarmup.warmed() << " draws" << std::endl;
+
+    // Driver traffic the uniform shadows saved
+    const UniformUploadStats::Counts uploads = UniformUploadStats::get().lastFrame;
+    std::cout << "Uniform uploads, last frame: " << uploads.issued << " issued, " << uploads.elided << " elided" << std::endl;
+    frameData.report();
+    const FrustumCullStats &frustumStats = frustumCuller.lastFrame();
+    std::cout << "Frustum culling, last frame: " << frustumStats.culled << " of " << frustumStats.tested
+              << " cubes culled in " << frustumStats.microseconds << " us" << std::endl;
+    if (occlusionCull)
+    {
+        const OcclusionCullStats &occlusionStats = occlusionCuller.lastFrame();
+        std::cout << "Occlusion culling, last frame: " << occlusionStats.occluded << " of " << occlusionStats.tested
+                  << " cubes occluded by " << occlusionStats.occluders << " (" << occlusionStats.triangles
+                  << " triangles), drawn in " << occlusionStats.rasterMicroseconds << " us, tested in "
+                  << occlusionStats.testMicroseconds << " us" << std::endl;
+    }
+    if (hizCull && hizCuller.ready())
+    {
+        const HizCullStats hizStats = hizCuller.readStats();
+        std::cout << "Hi-Z occlusion culling on the GPU, last frame: " << hizStats.frustumCulled << " of "
+                  << hizStats.objects << " cubes outside the frustum, " << hizStats.occluded << " occluded, "
+                  << hizStats.drawnFirst << " drawn visible from the frame before, " << hizStats.drawnSecond
+                  << " newly visible" << std::endl;
+        lodTriangles = hizStats.triangles;
+    }
+    std::cout << "Cube picking tree: " << cubeTree.nodeCount() << " nodes, " << cubeTree.refits() << " refits"
+              << std::endl;
+    const bool culledOnGpu = gpuCull && gpuMeshletCuller.ready();
+    const MeshletCullStats meshletStats = culledOnGpu ? gpuMeshletCuller.readStats() : meshletCuller.lastFrame();
+    if (culledOnGpu)
+        lodTriangles -= meshletStats.trianglesCulled;
+    std::cout << "Cube levels of detail, last frame: " << lodTriangles << " triangles drawn, "
+              << cubes.size() * (meshRegistry.range(cubeMesh).indexCount / 3) << " at full detail" << std::endl;
+    std::cout << "Meshlet culling" << (culledOnGpu ? " on the GPU" : "") << ", last frame: " << meshletStats.culled() << " of "
+              << meshletStats.meshlets << " meshlets culled (frustum " << meshletStats.frustumCulled << ", backface "
+              << meshletStats.backfaceCulled << "), " << meshletStats.trianglesCulled << " of " << meshletStats.triangles
+              << " triangles" << std::endl;
+
     // Clean up buffers
-    glDeleteVertexArrays(1, &defaultVAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    lightSourcePipeline.release();
+    lightingPipeline.release();
+    pipelineWarmup.release();
+    meshRegistry.release();
+    lightingDraws.release();
+    gpuMeshletCuller.release();
+    hizCuller.release();
+    glDeleteFramebuffers(1, &hizFramebuffer);
+    glDeleteRenderbuffers(1, &hizColor);
+    glDeleteTextures(1, &hizDepth);
+    frameData.release();
     glDeleteTextures(2, textures);
+    lightingBuffer.release();
+    warmupPerFrame.release();
+    materialBuffer.release();
     //glDeleteProgram(shaderProgram);
 
     // Terminate GLFW
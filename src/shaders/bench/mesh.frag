@@ -0,0 +1,12 @@
+#version 450 core
+
+in vec3 normal;
+in vec3 tangent;
+in vec2 texCoord;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(normal * 0.5 + 0.5 + tangent * 0.1, texCoord.x);
+}
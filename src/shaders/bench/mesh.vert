@@ -0,0 +1,26 @@
+#version 450 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aNormal;     // xyz, or octahedral in xy when QUANTIZED
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aTangent;    // xyz + handedness, or octahedral in xy + handedness when QUANTIZED
+
+#include "include/vertex_decode.glsl"
+
+uniform mat4 mvp;
+
+out vec3 normal;
+out vec3 tangent;
+out vec2 texCoord;
+
+void main()
+{
+#ifdef QUANTIZED
+    normal = octDecode(aNormal.xy);
+    tangent = octDecode(aTangent.xy) * aTangent.w;
+#else
+    normal = aNormal.xyz;
+    tangent = aTangent.xyz * aTangent.w;
+#endif
+    texCoord = aTexCoord;
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 450 core
 layout (location = 0) in vec3 aPos; // position has attribute position 0
 layout (location = 1) in vec3 aColor; // color has attribute position 1
 layout (location = 2) in vec2 aTexCoord; // texture coordinate has attribute position 2
@@ -6,13 +6,13 @@ layout (location = 2) in vec2 aTexCoord; // texture coordinate has attribute pos
 out vec3 ourColor; // output a color to the fragment shader
 out vec2 TexCoord; // output texture coordinates
 
+#include "include/per_frame.glsl"
+
 uniform mat4 model; // Model matrix
-uniform mat4 view; // View matrix
-uniform mat4 projection; // Projection matrix
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
     ourColor = aColor; // set ourColor to input color from the vertex data
     TexCoord = aTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450 core
+
+layout (location = 0) in vec3 aPos;
+
+#include "include/per_frame.glsl"
+
+uniform mat4 model;
+
+void main()
+{
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,26 @@
+#pragma once
+// The Hi-Z pyramid (see HizCuller in hiz_culler.h): level 0 is half the depth buffer's size, rounded up, and each
+// level after it half the one before; a texel is the farthest depth of the 2x2 under it (pixels for level 0), those
+// past the edge counting as 0. The levels are stored one after the other, each row by row
+
+layout (std430, binding = 5) coherent buffer HizPyramid
+{
+    float texels[];
+};
+
+uniform int hizWidth;       // of level 0
+uniform int hizHeight;
+uniform int hizLevelCount;
+
+// a level's size, and the index of its first texel
+ivec3 hizLevel(int level)
+{
+    ivec2 size = ivec2(hizWidth, hizHeight);
+    int first = 0;
+    for (int l = 0; l < level; l++)
+    {
+        first += size.x * size.y;
+        size = max((size + 1) / 2, ivec2(1));
+    }
+    return ivec3(size, first);
+}
@@ -0,0 +1,8 @@
+#pragma once
+// Scene light, written once when it changes (see LightingBlock in the generated shader_blocks.h)
+
+layout (std140, binding = 1) uniform Lighting
+{
+    vec3 lightColor;
+    vec3 lightPosition; // World space
+};
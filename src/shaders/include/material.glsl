@@ -0,0 +1,7 @@
+#pragma once
+// Surface parameters of the object being drawn (see MaterialBlock in the generated shader_blocks.h)
+
+layout (std140, binding = 2) uniform Material
+{
+    vec3 objectColor;
+};
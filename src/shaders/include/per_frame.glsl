@@ -0,0 +1,12 @@
+#pragma once
+// Per-frame data shared by every program, written once per frame (see PerFrameBlock, generated by blockgen)
+
+layout (std140, binding = 0) uniform PerFrame
+{
+    mat4 view; // View matrix
+    mat4 projection; // Projection matrix
+    mat4 viewProj; // projection * view
+    vec4 cameraPosition; // World space, w unused
+    float time; // Seconds since startup
+    float deltaTime; // Seconds since the last frame
+};
@@ -0,0 +1,12 @@
+// Decoding of the quantized vertex formats (see VertexFormat in vertex_layout.h)
+#pragma once
+
+// OCT_10_10_10_2: unit vector octahedral-encoded in xy
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
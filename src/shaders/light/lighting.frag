@@ -1,11 +1,26 @@
-#version 330 core
+#version 450 core
 
 out vec4 FragColor;
 
-uniform vec3 objectColor;
-uniform vec3 lightColor;
+#ifdef LIGHT_SOURCE
+// The lamp itself is always fully lit
+void main()
+{
+    FragColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+}
+#else
+#include "include/lighting.glsl"
+#include "include/material.glsl"
+
+// per instance when instanced, per draw otherwise
+#ifdef INSTANCED
+in float alpha;
+#else
+uniform float alpha;
+#endif
 
 void main()
 {
-    FragColor = vec4(lightColor * objectColor, 1.0);
-}
\ No newline at end of file
+    FragColor = vec4(lightColor * objectColor, alpha);
+}
+#endif
@@ -1,12 +1,32 @@
-#version 330 core
+#version 450 core
 
 layout (location = 0) in vec3 aPos;
 
+#include "include/per_frame.glsl"
+
+// the mesh's own transform; instanced draws place it with the per-instance TRS below
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#ifdef INSTANCED
+layout (location = 4) in vec4 instancePositionScale;   // translation, uniform scale
+layout (location = 5) in vec4 instanceRotation;        // quaternion
+layout (location = 6) in float instanceAlpha;
+
+out float alpha;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+#ifdef INSTANCED
+    vec3 local = (model * vec4(aPos, 1.0)).xyz * instancePositionScale.w;
+    alpha = instanceAlpha;
+    gl_Position = viewProj * vec4(instancePositionScale.xyz + rotate(instanceRotation, local), 1.0);
+#else
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
+#endif
+}
@@ -0,0 +1,277 @@
+// blockgen: generates C++ mirrors of the std140/std430 uniform and storage blocks declared in GLSL sources.
+// Usage: blockgen <output header> <shader files...>
+//
+// For every "layout (std140|std430 ...) uniform|buffer Name { ... };" it emits a NameBlock struct with explicit
+// padding, static_asserts on every offset and on the size, and a BlockLayout that Shader::verifyBlock() checks
+// against the linked program at startup. Blocks must not be declared inside #if branches.
+
+// Standard libraries
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+struct GlslType
+{
+    const char *glsl;
+    const char *cpp;
+    unsigned int cppSize;
+    unsigned int size;          // std140/std430 size (matrices: columns * column stride)
+    unsigned int align;         // base alignment
+    unsigned int matrixStride;  // 0 for non-matrices
+};
+
+// mat2 is left out: its std140 column stride (16) has no natural C++ type
+constexpr GlslType TYPES[] = {
+    {"float", "float", 4, 4, 4, 0},
+    {"int", "int32_t", 4, 4, 4, 0},
+    {"uint", "uint32_t", 4, 4, 4, 0},
+    {"bool", "uint32_t", 4, 4, 4, 0},
+    {"vec2", "glm::vec2", 8, 8, 8, 0},
+    {"vec3", "glm::vec3", 12, 12, 16, 0},
+    {"vec4", "glm::vec4", 16, 16, 16, 0},
+    {"ivec2", "glm::ivec2", 8, 8, 8, 0},
+    {"ivec3", "glm::ivec3", 12, 12, 16, 0},
+    {"ivec4", "glm::ivec4", 16, 16, 16, 0},
+    {"uvec2", "glm::uvec2", 8, 8, 8, 0},
+    {"uvec3", "glm::uvec3", 12, 12, 16, 0},
+    {"uvec4", "glm::uvec4", 16, 16, 16, 0},
+    {"mat3", "BlockMat3", 48, 48, 16, 16},
+    {"mat4", "glm::mat4", 64, 64, 16, 16},
+};
+
+struct Block
+{
+    std::string name;
+    std::string source;
+    std::string declaration;
+    std::string code;           // generated C++
+};
+
+unsigned int roundUp(const unsigned int value, const unsigned int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream file(path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return stream.str();
+}
+
+std::string stripComments(const std::string &source)
+{
+    static const std::regex comments(R"(//[^\n]*|/\*[\s\S]*?\*/)");
+    return std::regex_replace(source, comments, " ");
+}
+
+const GlslType* findType(const std::string &name)
+{
+    for (const GlslType &type : TYPES)
+        if (name == type.glsl)
+            return &type;
+    return nullptr;
+}
+
+bool generateBlock(Block &block, const std::string &layoutArgs, const bool storage, const std::string &body)
+{
+    const bool std430 = layoutArgs.find("std430") != std::string::npos;
+    if (!std430 && layoutArgs.find("std140") == std::string::npos)
+    {
+        std::cerr << block.source << ": block " << block.name << " needs an explicit std140 or std430 layout" << std::endl;
+        return false;
+    }
+    const char *layoutName = std430 ? "std430" : "std140";
+
+    std::smatch bindingMatch;
+    const bool hasBinding = std::regex_search(layoutArgs, bindingMatch, std::regex(R"(binding\s*=\s*(\d+))"));
+
+    const std::string structName = block.name + "Block";
+    std::ostringstream code, members, asserts;
+    code << "// " << block.declaration << "  (" << block.source << ")\n";
+    code << "struct " << structName << "\n{\n";
+    if (hasBinding)
+        code << "    static constexpr unsigned int BINDING = " << bindingMatch[1] << ";\n\n";
+
+    static const std::regex qualifiers(R"(\b(highp|mediump|lowp|readonly|writeonly|coherent|restrict|volatile|precise)\b)");
+    static const std::regex declarator(R"(^\s*(\w+)\s*(?:\[\s*(\d*)\s*\])?\s*$)");
+
+    unsigned int offset = 0, maxAlign = 4, padCount = 0, memberCount = 0;
+    bool runtimeArray = false;
+    std::stringstream statements(body);
+    std::string statement;
+    while (std::getline(statements, statement, ';'))
+    {
+        statement = std::regex_replace(statement, qualifiers, " ");
+        std::istringstream tokens(statement);
+        std::string typeName;
+        if (!(tokens >> typeName))
+            continue;
+
+        if (runtimeArray)
+        {
+            std::cerr << block.source << ": " << block.name << ": a runtime-sized array must be the last member" << std::endl;
+            return false;
+        }
+
+        const GlslType *type = findType(typeName);
+        if (type == nullptr)
+        {
+            std::cerr << block.source << ": " << block.name << ": unsupported member type '" << typeName << "'" << std::endl;
+            return false;
+        }
+
+        std::string rest;
+        std::getline(tokens, rest);
+        std::stringstream names(rest);
+        std::string item;
+        while (std::getline(names, item, ','))
+        {
+            std::smatch match;
+            if (!std::regex_match(item, match, declarator))
+            {
+                std::cerr << block.source << ": " << block.name << ": cannot parse member '" << item << "'" << std::endl;
+                return false;
+            }
+            const std::string name = match[1];
+            const bool isArray = match[2].matched || item.find('[') != std::string::npos;
+            const bool unsized = isArray && match[2].length() == 0;
+            const unsigned int count = isArray && !unsized ? (unsigned int)std::stoul(match[2]) : 1;
+
+            // arrays: std140 rounds alignment and stride up to a vec4, std430 keeps the element's
+            unsigned int align = type->align;
+            unsigned int stride = roundUp(type->size, type->align);
+            if (isArray && !std430)
+            {
+                align = roundUp(align, 16);
+                stride = roundUp(stride, 16);
+            }
+            maxAlign = std::max(maxAlign, align);
+
+            const unsigned int aligned = roundUp(offset, align);
+            if (aligned > offset)
+                code << "    uint8_t padding" << padCount++ << "[" << aligned - offset << "];\n";
+
+            if (unsized)
+            {
+                runtimeArray = true;
+                code << "    // " << typeName << " " << name << "[] follows, element stride " << stride << "\n";
+                code << "    static constexpr unsigned int " << name << "Offset = " << aligned << ";\n";
+                code << "    static constexpr unsigned int " << name << "Stride = " << stride << ";\n";
+                offset = aligned;
+            }
+            else if (isArray)
+            {
+                if (stride == type->cppSize)
+                    code << "    " << type->cpp << " " << name << "[" << count << "];\n";
+                else
+                    code << "    BlockElement<" << type->cpp << ", " << stride << "> " << name << "[" << count << "];\n";
+                offset = aligned + stride * count;
+            }
+            else
+            {
+                code << "    " << type->cpp << " " << name << ";\n";
+                offset = aligned + type->size;
+            }
+
+            if (!unsized)
+                asserts << "static_assert(offsetof(" << structName << ", " << name << ") == " << aligned
+                        << ", \"" << block.name << "." << name << ": " << layoutName << " offset\");\n";
+            members << "    {\"" << name << "\", " << aligned << ", " << (isArray ? stride : 0) << ", "
+                    << type->matrixStride << "},\n";
+            memberCount++;
+        }
+    }
+
+    // std140 rounds the block up to a vec4, std430 to its largest alignment
+    const unsigned int size = runtimeArray ? offset : roundUp(offset, std430 ? maxAlign : 16);
+    if (size > offset)
+        code << "    uint8_t padding" << padCount << "[" << size - offset << "];\n";
+    code << "};\n";
+    code << asserts.str();
+    // a block holding only a runtime array has no fixed part, while a C++ struct is never empty
+    if (size > 0)
+        code << "static_assert(sizeof(" << structName << ") == " << size << ", \"" << block.name << ": " << layoutName << " size\");\n";
+    code << "\n";
+
+    code << "inline constexpr BlockMemberLayout " << structName << "Members[] = {\n" << members.str() << "};\n";
+    code << "inline constexpr BlockLayout " << structName << "Layout = {\"" << block.name << "\", "
+         << (storage ? "true" : "false") << ", " << (runtimeArray ? 0 : size) << ", "
+         << structName << "Members, " << memberCount << "};\n\n";
+
+    block.code = code.str();
+    return true;
+}
+
+int main(const int argc, char **argv) {
+    if (argc < 2)
+    {
+        std::cerr << "Usage: blockgen <output header> <shader files...>" << std::endl;
+        return 1;
+    }
+
+    static const std::regex blockPattern(
+        R"(layout\s*\(([^)]*)\)\s*((?:(?:readonly|writeonly|coherent|restrict|volatile)\s+)*)(uniform|buffer)\s+(\w+)\s*\{([^}]*)\}\s*\w*\s*(?:\[[^\]]*\])?\s*;)");
+
+    std::map<std::string, Block> blocks;
+    for (int i = 2; i < argc; i++)
+    {
+        const std::string source = stripComments(readFile(argv[i]));
+        for (auto it = std::sregex_iterator(source.begin(), source.end(), blockPattern); it != std::sregex_iterator(); ++it)
+        {
+            const std::smatch &match = *it;
+            Block block;
+            block.name = match[4];
+            block.source = argv[i];
+            block.declaration = "layout (" + match[1].str() + ") " + match[3].str() + " " + block.name;
+            if (!generateBlock(block, match[1], match[3] == "buffer", match[5]))
+                return 1;
+
+            // a block shared through an #include is seen once per including file
+            const auto existing = blocks.find(block.name);
+            if (existing != blocks.end())
+            {
+                const std::string first = existing->second.code.substr(existing->second.code.find('\n'));
+                if (first != block.code.substr(block.code.find('\n')))
+                {
+                    std::cerr << block.source << ": block " << block.name << " is declared differently in "
+                              << existing->second.source << std::endl;
+                    return 1;
+                }
+                continue;
+            }
+            blocks.emplace(block.name, block);
+        }
+    }
+
+    std::ostringstream header;
+    header << "// Generated by blockgen from the GLSL sources under src/shaders. Do not edit.\n";
+    header << "#ifndef OPENGL_SHADER_BLOCKS_H\n#define OPENGL_SHADER_BLOCKS_H\n\n";
+    header << "#include <cstddef>\n#include <cstdint>\n#include \"glm/glm.hpp\"\n#include \"block_layout.h\"\n\n";
+    for (const auto &[name, block] : blocks)
+        header << block.code;
+
+    header << "// Every block above, for Shader::verifyBlock()\n";
+    header << "inline constexpr const BlockLayout *SHADER_BLOCK_LAYOUTS[] = {\n";
+    for (const auto &[name, block] : blocks)
+        header << "    &" << name << "BlockLayout,\n";
+    if (blocks.empty())
+        header << "    nullptr,\n";
+    header << "};\n\n#endif //OPENGL_SHADER_BLOCKS_H\n";
+
+    std::ofstream file(argv[1], std::ios::trunc);
+    file << header.str();
+    if (!file)
+    {
+        std::cerr << "blockgen: cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+    return 0;
+}
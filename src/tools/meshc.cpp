@@ -0,0 +1,127 @@
+// meshc: converts a content mesh (.obj or .glb) into a .mesh cache, which the application maps and uploads as is.
+// Usage: meshc <input.obj|input.glb> <output.mesh> [--normals] [--float] [--lods N]
+//
+// The mesh is welded and optimized (MeshBuilder), then quantized into the layout main.cpp draws meshes with:
+// SNORM16_4 position at location 0 and UNORM16_2 texcoord at 2, plus OCT_10_10_10_2 normal at 1 with --normals.
+// --float keeps the importer's float layout instead. Every primitive of the input ends up in one submesh, followed by
+// up to N - 1 simplified levels of detail (6 levels by default, --lods 1 for none).
+
+// Standard libraries
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Headers
+#include "mesh_builder.h"
+#include "mesh_file.h"
+#include "mesh_importer.h"
+#include "mesh_simplifier.h"
+#include "vertex_layout.h"
+
+
+// the layout to store, from the attributes the input has
+VertexLayout outputLayout(const VertexLayout &input, const bool normals)
+{
+    std::vector<VertexAttribute> attributes = {{VertexSemantic::POSITION, 0, VertexFormat::SNORM16_4}};
+    if (normals && input.find(VertexSemantic::NORMAL) != nullptr)
+        attributes.push_back({VertexSemantic::NORMAL, 1, VertexFormat::OCT_10_10_10_2});
+    if (input.find(VertexSemantic::TEXCOORD) != nullptr)
+        attributes.push_back({VertexSemantic::TEXCOORD, 2, VertexFormat::UNORM16_2});
+    return VertexLayout(std::move(attributes));
+}
+
+int main(const int argc, char **argv) {
+    bool normals = false, floats = false;
+    unsigned int lodLevels = 6;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--normals") == 0)
+            normals = true;
+        else if (std::strcmp(argv[i], "--float") == 0)
+            floats = true;
+        else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+            lodLevels = (unsigned int)std::max(std::atoi(argv[++i]), 1);
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2)
+    {
+        std::cerr << "Usage: meshc <input.obj|input.glb> <output.mesh> [--normals] [--float] [--lods N]" << std::endl;
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    ImportedMesh imported;
+    if (!importMesh(paths[0], imported))
+        return 1;
+
+    // the importer's indices are in file order
+    const std::vector<uint32_t> indices = unpackIndices(imported.mesh);
+
+    // bounds from the float positions, before quantization rounds them
+    MeshFileSubmesh submesh{};
+    const unsigned int stride = imported.layout.stride();
+    const unsigned int positionOffset = imported.layout.find(VertexSemantic::POSITION)->offset;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        submesh.boundsMin[axis] = 1e30f;
+        submesh.boundsMax[axis] = -1e30f;
+    }
+    bool texcoordsInRange = true;
+    const VertexAttribute *texcoord = imported.layout.find(VertexSemantic::TEXCOORD);
+    for (size_t v = 0; v < imported.mesh.vertexCount(); v++)
+    {
+        float position[3];
+        std::memcpy(position, imported.mesh.vertices.data() + v * stride + positionOffset, sizeof(position));
+        for (int axis = 0; axis < 3; axis++)
+        {
+            submesh.boundsMin[axis] = std::min(submesh.boundsMin[axis], position[axis]);
+            submesh.boundsMax[axis] = std::max(submesh.boundsMax[axis], position[axis]);
+        }
+        if (texcoord != nullptr)
+        {
+            float uv[2];
+            std::memcpy(uv, imported.mesh.vertices.data() + v * stride + texcoord->offset, sizeof(uv));
+            texcoordsInRange &= uv[0] >= 0.0f && uv[0] <= 1.0f && uv[1] >= 0.0f && uv[1] <= 1.0f;
+        }
+    }
+
+    MeshBuilder builder(stride, positionOffset);
+    builder.addIndexed(imported.mesh.vertices.data(), imported.mesh.vertexCount(), indices.data(), indices.size());
+    const Mesh optimized = builder.build();
+
+    // the levels are simplified on the float positions, and cut out of the quantized vertices, so that every level
+    // shares the full-detail mesh's positionTransform
+    const std::vector<MeshLod> lods = generateLods(optimized, positionOffset, lodLevels);
+
+    const VertexLayout layout = floats ? imported.layout : outputLayout(imported.layout, normals);
+    if (!floats && !texcoordsInRange)
+        std::cerr << "meshc: texture coordinates outside [0, 1] are clamped by UNORM16_2 (use --float to keep them)" << std::endl;
+    const Mesh mesh = floats ? optimized : convertMesh(optimized, imported.layout, layout);
+
+    std::vector<Mesh> parts = {mesh};
+    std::vector<MeshFileSubmesh> submeshes = {submesh};
+    const std::vector<glm::vec3> positions = meshPositions(optimized, positionOffset);
+    for (size_t level = 1; level < lods.size(); level++)
+    {
+        parts.push_back(extractLod(mesh, lods[level].indices, positions));
+        submesh.lod = (uint32_t)level;
+        submesh.lodError = lods[level].error;
+        submeshes.push_back(submesh);
+    }
+    if (!writeMeshFile(paths[1], parts, layout, submeshes))
+        return 1;
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << paths[0] << " -> " << paths[1] << ": " << mesh.indexCount / 3 << " triangles, " << mesh.vertexCount()
+              << " vertices of " << mesh.vertexSize << " bytes, " << ms << " ms" << std::endl;
+    for (size_t level = 1; level < lods.size(); level++)
+        std::cout << "  LOD " << level << ": " << parts[level].indexCount / 3 << " triangles, error " << lods[level].error
+                  << std::endl;
+    return 0;
+}
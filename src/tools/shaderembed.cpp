@@ -0,0 +1,115 @@
+// shaderembed: packs GLSL sources into a generated header, so the executable never opens a shader file.
+// Usage: shaderembed <output header> <shader files...>
+//
+// Every file is appended to a single read-only char array (EMBEDDED_SHADER_BLOB) and listed in EMBEDDED_SHADERS,
+// a constexpr table sorted by path that maps the path, as given on the command line, to a string_view into the blob.
+
+// Standard libraries
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+struct ShaderFile
+{
+    std::string path;
+    std::string source;
+    size_t offset;
+};
+
+// A C string literal for text, one literal per source line so the generated header stays readable
+std::string literal(const std::string &text)
+{
+    std::string result = "    \"";
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        const auto c = (unsigned char)text[i];
+        switch (c)
+        {
+            case '\\': result += "\\\\"; break;
+            case '"': result += "\\\""; break;
+            case '\t': result += "\\t"; break;
+            case '\r': result += "\\r"; break;
+            case '\n':
+                result += "\\n\"\n";
+                if (i + 1 < text.size())
+                    result += "    \"";
+                continue;
+            default:
+                if (c < 0x20 || c >= 0x7f)
+                {
+                    // always three digits, so a following digit is never read as part of the escape
+                    char escape[5];
+                    std::snprintf(escape, sizeof(escape), "\\%03o", c);
+                    result += escape;
+                }
+                else
+                    result += (char)c;
+        }
+    }
+    if (text.empty() || text.back() != '\n')
+        result += "\"\n";
+    return result;
+}
+
+int main(const int argc, char **argv) {
+    if (argc < 2)
+    {
+        std::cerr << "Usage: shaderembed <output header> <shader files...>" << std::endl;
+        return 1;
+    }
+
+    std::vector<ShaderFile> files;
+    for (int i = 2; i < argc; i++)
+    {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "shaderembed: cannot read " << argv[i] << std::endl;
+            return 1;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        files.push_back({argv[i], stream.str(), 0});
+    }
+    std::sort(files.begin(), files.end(), [](const ShaderFile &a, const ShaderFile &b) { return a.path < b.path; });
+
+    std::ostringstream header;
+    header << "// Generated by shaderembed from the GLSL sources under src/shaders. Do not edit.\n";
+    header << "#ifndef OPENGL_EMBEDDED_SHADERS_H\n#define OPENGL_EMBEDDED_SHADERS_H\n\n";
+    header << "#include <string_view>\n\n";
+    header << "struct EmbeddedShader\n{\n    std::string_view path;\n    std::string_view source;\n};\n\n";
+
+    header << "// Every shader source, back to back\n";
+    header << "inline constexpr char EMBEDDED_SHADER_BLOB[] =\n";
+    size_t offset = 0;
+    for (ShaderFile &file : files)
+    {
+        file.offset = offset;
+        offset += file.source.size();
+        header << "    // " << file.path << "\n" << literal(file.source);
+    }
+    header << "    \"\";\n\n";
+
+    header << "// Sorted by path\n";
+    header << "inline constexpr EmbeddedShader EMBEDDED_SHADERS[] = {\n";
+    for (const ShaderFile &file : files)
+        header << "    {\"" << file.path << "\", std::string_view(EMBEDDED_SHADER_BLOB + " << file.offset << ", "
+               << file.source.size() << ")},\n";
+    if (files.empty())
+        header << "    {\"\", \"\"},\n";
+    header << "};\n\n#endif //OPENGL_EMBEDDED_SHADERS_H\n";
+
+    std::ofstream file(argv[1], std::ios::trunc);
+    file << header.str();
+    if (!file)
+    {
+        std::cerr << "shaderembed: cannot write " << argv[1] << std::endl;
+        return 1;
+    }
+    return 0;
+}